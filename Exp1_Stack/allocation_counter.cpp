@@ -0,0 +1,71 @@
+#include "instrumentation.hpp"
+
+#include <cstdlib>
+#include <new>
+
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+// 滻ȫַ亯ͳƷֻ Benchmark ӡ
+//  nothrow 汾Ĭתʧʱ׼ new_handlerûʱ׳ bad_alloc
+
+namespace {
+	const bool registered = (chr::register_allocation_counter(), true);
+
+	void* aligned_malloc(std::size_t size, std::size_t alignment) {
+#ifdef _WIN32
+		return _aligned_malloc(size, alignment);
+#else
+		// aligned_alloc ҪСǶ
+		return std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+#endif
+	}
+
+	void aligned_free(void* p) {
+#ifdef _WIN32
+		_aligned_free(p);
+#else
+		std::free(p);
+#endif
+	}
+
+	template <typename Allocate>
+	void* allocate(Allocate allocate_once) {
+		chr::count_allocation();
+		while (true) {
+			if (void* p = allocate_once()) {
+				return p;
+			}
+			std::new_handler handler = std::get_new_handler();
+			if (!handler) {
+				throw std::bad_alloc();
+			}
+			handler();
+		}
+	}
+}
+
+void* operator new(std::size_t size) {
+	return allocate([size] { return std::malloc(size ? size : 1); });
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+	return allocate([size, alignment] { return aligned_malloc(size ? size : 1, static_cast<std::size_t>(alignment)); });
+}
+
+void operator delete(void* p) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::size_t) noexcept {
+	std::free(p);
+}
+
+void operator delete(void* p, std::align_val_t) noexcept {
+	aligned_free(p);
+}
+
+void operator delete(void* p, std::size_t, std::align_val_t) noexcept {
+	aligned_free(p);
+}
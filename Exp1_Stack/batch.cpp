@@ -0,0 +1,757 @@
+#include "compiler.hpp"
+#include "fast_math.hpp"
+
+namespace chr {
+	namespace {
+		// ÿδһȫջۣmax_depth  blockӦ L1/L2 
+		constexpr size_t batch_block = 256;
+		// ֵĿÿһ俪̯
+		constexpr size_t float_block = 1024;
+
+		template <typename T> struct simd_of;
+		template <> struct simd_of<double> { using type = vdouble; };
+		template <> struct simd_of<float> { using type = vfloat; };
+
+		// һԪںˣд x
+		template <typename T, typename Func>
+		inline void unary_kernel(T* x, size_t n, Func func) {
+			using V = typename simd_of<T>::type;
+			for (size_t i = 0; i < n; i += V::width) {
+				func(V::load(x + i)).store(x + i);
+			}
+		}
+		// ԪںˣдڵĲ
+		template <typename T, typename Func>
+		inline void binary_kernel(T* a, const T* b, size_t n, Func func) {
+			using V = typename simd_of<T>::type;
+			for (size_t i = 0; i < n; i += V::width) {
+				func(V::load(a + i), V::load(b + i)).store(a + i);
+			}
+		}
+		// Ԫ˼ںˣa * b + c д a
+		template <typename T>
+		inline void fma_kernel(T* a, const T* b, const T* c, size_t n) {
+			using V = typename simd_of<T>::type;
+			for (size_t i = 0; i < n; i += V::width) {
+				fma(V::load(a + i), V::load(b + i), V::load(c + i)).store(a + i);
+			}
+		}
+		// ȡģ׳Ԫؼ
+		template <typename Kernels, op_t Op>
+		inline void scalar_unary(double* x, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				x[i] = Kernels::template scalar<Op>(x[i]);
+			}
+		}
+		template <typename Kernels, op_t Op>
+		inline void scalar_binary(double* a, const double* b, size_t n) {
+			for (size_t i = 0; i < n; i++) {
+				a[i] = Kernels::template scalar<Op>(a[i], b[i]);
+			}
+		}
+		// ͨȷֵʱûʵֵ㣺ǡ
+		template <op_t Op>
+		inline vdouble lanewise(vdouble x) {
+			alignas(64) double v[vdouble::width];
+			x.store(v);
+			for (double& e : v) {
+				e = apply_operator<Op>(e);
+			}
+			return vdouble::load(v);
+		}
+
+		// ־¸ʵ֣ȡģ׳Ԫؼ㣨scalar
+		struct exact_kernels {
+			template <op_t Op>
+			static double scalar(double a, double b = 0) { return apply_operator<Op>(a, b); }
+			static vdouble sin(vdouble x) { return vmath::sin(x); }
+			static vdouble cos(vdouble x) { return vmath::cos(x); }
+			static vdouble tan(vdouble x) { return vmath::tan(x); }
+			static vdouble cot(vdouble x) { return 1.0 / vmath::tan(x); }
+			static vdouble sec(vdouble x) { return 1.0 / vmath::cos(x); }
+			static vdouble csc(vdouble x) { return 1.0 / vmath::sin(x); }
+			static vdouble asin(vdouble x) { return lanewise<op_t::arcsine>(x); }
+			static vdouble acos(vdouble x) { return lanewise<op_t::arccosine>(x); }
+			static vdouble atan(vdouble x) { return lanewise<op_t::arctangent>(x); }
+			static vdouble log(vdouble x) { return vmath::log(x); }
+			static vdouble log10(vdouble x) { return vmath::log(x) * 0.43429448190325182765; }
+			static vdouble cbrt(vdouble x) { return lanewise<op_t::cubic_root>(x); }
+			static vdouble pow(vdouble a, vdouble b) { return vmath::pow(a, b); }
+		};
+		struct fast_kernels {
+			template <op_t Op>
+			static double scalar(double a, double b = 0) { return fast::apply_operator<Op>(a, b); }
+			static vdouble sin(vdouble x) { return fast::sin(x); }
+			static vdouble cos(vdouble x) { return fast::cos(x); }
+			static vdouble tan(vdouble x) { return fast::tan(x); }
+			static vdouble cot(vdouble x) { return fast::cot(x); }
+			static vdouble sec(vdouble x) { return fast::sec(x); }
+			static vdouble csc(vdouble x) { return fast::csc(x); }
+			static vdouble asin(vdouble x) { return fast::asin(x); }
+			static vdouble acos(vdouble x) { return fast::acos(x); }
+			static vdouble atan(vdouble x) { return fast::atan(x); }
+			static vdouble log(vdouble x) { return fast::log(x); }
+			static vdouble log10(vdouble x) { return fast::log10(x); }
+			static vdouble cbrt(vdouble x) { return fast::cbrt(x); }
+			static vdouble pow(vdouble a, vdouble b) { return fast::pow(a, b); }
+		};
+
+		// ֵһ飬ջÿλһֵ
+		// ÿִָһΣָɵĿһڵȫз̯
+		// tiles ÿջۣǸʱλ batch_block Ų뵽ȵβ㣻
+		// inputs[i] ָ i ڱĵһУڵ 0 ջۣ
+		// arguments ԭõĲջϣmax_depth 㹻ɵ÷һԷ
+		template <typename Kernels>
+		void run_block(const program_view& program, double* tiles, double* arguments, const double* const* inputs, size_t rows) {
+			const size_t max_depth = program.max_depth;
+			const size_t n = (rows + vdouble::width - 1) / vdouble::width * vdouble::width;
+			size_t sp = 0;
+			auto slot = [&](size_t index) { return tiles + index * batch_block; };
+			for (const instruction& ins : program.code) {
+				switch (ins.code) {
+				case opcode::push_constant:
+					std::fill_n(slot(sp++), n, program.constants[ins.operand]);
+					break;
+				case opcode::load_variable: {
+					double* dst = slot(sp++);
+					std::copy_n(inputs[ins.operand], rows, dst);
+					std::fill(dst + rows, dst + n, 0.0);
+					break;
+				}
+				case opcode::store_temp:
+					std::copy_n(slot(sp - 1), n, slot(max_depth + ins.operand));
+					break;
+				case opcode::load_temp:
+					std::copy_n(slot(max_depth + ins.operand), n, slot(sp++));
+					break;
+				case opcode::add:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vdouble a, vdouble b) { return a + b; });
+					break;
+				case opcode::minus:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vdouble a, vdouble b) { return a - b; });
+					break;
+				case opcode::multiply:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vdouble a, vdouble b) { return a * b; });
+					break;
+				case opcode::divide:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vdouble a, vdouble b) { return a / b; });
+					break;
+				case opcode::exponent:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vdouble a, vdouble b) { return Kernels::pow(a, b); });
+					break;
+				case opcode::modulo:
+					sp--;
+					scalar_binary<Kernels, op_t::modulo>(slot(sp - 1), slot(sp), rows);
+					break;
+				case opcode::negate:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return -x; });
+					break;
+				case opcode::factorial:
+					scalar_unary<Kernels, op_t::factorial>(slot(sp - 1), rows);
+					break;
+				case opcode::sine:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::sin(x); });
+					break;
+				case opcode::cosine:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::cos(x); });
+					break;
+				case opcode::tangent:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::tan(x); });
+					break;
+				case opcode::cotangent:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::cot(x); });
+					break;
+				case opcode::secant:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::sec(x); });
+					break;
+				case opcode::cosecant:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::csc(x); });
+					break;
+				case opcode::arcsine:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::asin(x); });
+					break;
+				case opcode::arccosine:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::acos(x); });
+					break;
+				case opcode::arctangent:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::atan(x); });
+					break;
+				case opcode::arccotangent:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::atan(1.0 / x); });
+					break;
+				case opcode::arcsecant:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::acos(1.0 / x); });
+					break;
+				case opcode::arccosecant:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::asin(1.0 / x); });
+					break;
+				case opcode::common_logarithm:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::log10(x); });
+					break;
+				case opcode::natural_logarithm:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::log(x); });
+					break;
+				case opcode::square_root:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return sqrt(x); });
+					break;
+				case opcode::cubic_root:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return Kernels::cbrt(x); });
+					break;
+				case opcode::degree:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return x / CONSTANT_PI * 180.0; });
+					break;
+				case opcode::radian:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return x / 180.0 * CONSTANT_PI; });
+					break;
+				case opcode::square:
+					unary_kernel(slot(sp - 1), n, [](vdouble x) { return x * x; });
+					break;
+				case opcode::call: {
+					// ԭеãλڵջУдصһڵĲ
+					const native_function& function = *program.natives[ins.operand];
+					sp -= function.arity - 1;
+					for (size_t i = 0; i < rows; i++) {
+						for (size_t k = 0; k < function.arity; k++) {
+							arguments[k] = slot(sp - 1 + k)[i];
+						}
+						slot(sp - 1)[i] = function.callback({ arguments, function.arity });
+					}
+					break;
+				}
+				case opcode::multiply_add:
+					sp -= 2;
+					fma_kernel(slot(sp - 1), slot(sp), slot(sp + 1), n);
+					break;
+				}
+			}
+		}
+
+		template <typename Kernels>
+		void run_batch(const program_view& program, std::span<const std::span<const double>> columns, std::span<double> out) {
+			std::vector<double> tiles((std::max<size_t>(program.max_depth, 1) + program.temp_count) * batch_block);
+			std::vector<double> arguments(program.max_depth);
+			std::vector<const double*> inputs(program.variable_count);
+			for (size_t row = 0; row < out.size(); row += batch_block) {
+				const size_t rows = std::min(batch_block, out.size() - row);
+				for (size_t i = 0; i < inputs.size(); i++) {
+					inputs[i] = columns[i].data() + row;
+				}
+				run_block<Kernels>(program, tiles.data(), arguments.data(), inputs.data(), rows);
+				std::copy_n(tiles.data(), rows, out.data() + row);
+			}
+		}
+
+		// ·ƣÿֵȡֵ [lo, hi]Ƚ v' 뾫ȷֵ v 
+		// |v' - v|  relative  |v| + absoluteֻڳ˳ͬʱֱӴݣ
+		// ӣ sinln ȺתΪ absolute
+		struct value_bound {
+			double lo;
+			double hi;
+			double relative = 0;
+			double absolute = 0;
+			bool nonnegative = false; // ȽȻǸ벻ıţƽȿԷʹ
+			double magnitude() const { return std::max(std::abs(lo), std::abs(hi)); }
+			// ھֵ½磬京 0 ʱΪ 0
+			double floor_magnitude() const { return lo > 0 ? lo : hi < 0 ? -hi : 0; }
+			// Ƚֵ½磬 0 ʱΪ 0 
+			double computed_floor() const { return floor_magnitude() * (1 - relative) - absolute; }
+			double error() const { return relative * magnitude() + absolute; }
+		};
+		constexpr double float_rounding = 0x1p-24; // ȵĵλ
+		constexpr double float_tiny = 0x1p-149;    // Ϊǹʱľ
+		constexpr double float_limit = 0x1p126;    // мֵͿ
+		// Ϊȣv'' = v'(1 + )||  units  u
+		// Խ˫ȼ룬units ȡ 2 ԸǺ
+		inline void round_to_float(value_bound& r, double units = 1) {
+			const double d = units * float_rounding;
+			r.relative = r.relative * (1 + d) + d;
+			r.absolute = r.absolute * (1 + d) + float_tiny;
+		}
+		inline value_bound corners(double a, double b, double c, double d) {
+			return { std::min({ a, b, c, d }), std::max({ a, b, c, d }) };
+		}
+		// a + b δ룩ͬʱȡϴߣ򰴸ԵתΪ
+		inline value_bound sum(const value_bound& a, const value_bound& b) {
+			value_bound r{ a.lo + b.lo, a.hi + b.hi };
+			r.absolute = a.absolute + b.absolute;
+			if ((a.lo >= 0 && b.lo >= 0) || (a.hi <= 0 && b.hi <= 0)) {
+				r.relative = std::max(a.relative, b.relative);
+			}
+			else {
+				r.absolute += a.relative * a.magnitude() + b.relative * b.magnitude();
+			}
+			r.nonnegative = a.nonnegative && b.nonnegative;
+			return r;
+		}
+		inline value_bound product(const value_bound& a, const value_bound& b) {
+			value_bound r = corners(a.lo * b.lo, a.lo * b.hi, a.hi * b.lo, a.hi * b.hi);
+			r.relative = a.relative + b.relative + a.relative * b.relative;
+			r.absolute = a.absolute * b.magnitude() * (1 + b.relative) + b.absolute * a.magnitude() * (1 + a.relative)
+				+ a.absolute * b.absolute;
+			r.nonnegative = a.nonnegative && b.nonnegative;
+			return r;
+		}
+		inline value_bound negated(const value_bound& a) {
+			return { -a.hi, -a.lo, a.relative, a.absolute, false };
+		}
+		// ֻĺsincosarctan|f'|  1
+		inline void lipschitz(value_bound& r, const value_bound& a) {
+			r.relative = 0;
+			r.absolute = a.error();
+		}
+		// sin  [lo, hi] ϵֵ򣺶˵ֵںֵ /2 + 2k Сֵ -/2 + 2k ʱȡ 1
+		inline std::pair<double, double> sine_range(double lo, double hi) {
+			constexpr double period = 2 * CONSTANT_PI;
+			if (hi - lo >= period) {
+				return { -1, 1 };
+			}
+			double a = std::sin(lo), b = std::sin(hi);
+			double low = std::min(a, b), high = std::max(a, b);
+			if (std::floor((hi - CONSTANT_PI / 2) / period) >= std::ceil((lo - CONSTANT_PI / 2) / period)) {
+				high = 1;
+			}
+			if (std::floor((hi + CONSTANT_PI / 2) / period) >= std::ceil((lo + CONSTANT_PI / 2) / period)) {
+				low = -1;
+			}
+			return { low, high };
+		}
+		// ·ֵ֧㣻㣨ȡģ׳ˡࡢarcsin ࡢԭĳʹ˫
+		inline bool float_supported(opcode code) {
+			switch (code) {
+			case opcode::modulo: case opcode::factorial:
+			case opcode::tangent: case opcode::cotangent: case opcode::secant: case opcode::cosecant:
+			case opcode::arcsine: case opcode::arccosine: case opcode::arccotangent:
+			case opcode::arcsecant: case opcode::arccosecant:
+			case opcode::call:
+				return false;
+			default:
+				return true;
+			}
+		}
+
+		// һinputs ΪڱȡֵΧǾȷģ
+		// ȽϽ粻 tolerance  ֵʱ true
+		// κһֿܵԽ硢Ϊ 0 Ϊȫ
+		bool float_safe(const program_view& program, std::span<const value_bound> inputs, double tolerance,
+			std::vector<value_bound>& stack, std::vector<value_bound>& temps) {
+			stack.clear();
+			auto pop = [&stack] {
+				value_bound top = stack.back();
+				stack.pop_back();
+				return top;
+			};
+			for (const instruction& ins : program.code) {
+				value_bound r{};
+				switch (ins.code) {
+				case opcode::push_constant: {
+					const double c = program.constants[ins.operand];
+					r = { c, c, c == 0 ? 0 : std::abs(c - static_cast<float>(c)) / std::abs(c), 0, c >= 0 };
+					break;
+				}
+				case opcode::load_variable:
+					r = inputs[ins.operand];
+					break;
+				case opcode::store_temp:
+					temps[ins.operand] = stack.back();
+					continue;
+				case opcode::load_temp:
+					r = temps[ins.operand];
+					break;
+				case opcode::negate:
+					r = negated(pop());
+					break;
+				case opcode::add:
+				case opcode::minus: {
+					const value_bound b = pop();
+					const value_bound a = pop();
+					r = sum(a, ins.code == opcode::add ? b : negated(b));
+					round_to_float(r);
+					break;
+				}
+				case opcode::multiply: {
+					const value_bound b = pop();
+					const value_bound a = pop();
+					r = product(a, b);
+					round_to_float(r);
+					break;
+				}
+				case opcode::multiply_add: {
+					const value_bound c = pop();
+					const value_bound b = pop();
+					const value_bound a = pop();
+					r = sum(product(a, b), c);
+					round_to_float(r);
+					break;
+				}
+				case opcode::square: {
+					const value_bound a = pop();
+					const double low = a.floor_magnitude(), high = a.magnitude();
+					r = product(a, a);
+					r.lo = low * low;
+					r.hi = high * high;
+					r.nonnegative = true;
+					round_to_float(r);
+					break;
+				}
+				case opcode::divide: {
+					const value_bound b = pop();
+					const value_bound a = pop();
+					// 1 / b' = (1 / b)(1 + )||   / (1 - )
+					const double floor = b.floor_magnitude();
+					const double theta = floor > 0 ? b.relative + b.absolute / floor : INFINITY;
+					if (!(theta < 0.5)) {
+						return false;
+					}
+					const double eta = theta / (1 - theta);
+					r = corners(a.lo / b.lo, a.lo / b.hi, a.hi / b.lo, a.hi / b.hi);
+					r.relative = (1 + a.relative) * (1 + eta) - 1;
+					r.absolute = a.absolute / floor * (1 + eta);
+					r.nonnegative = a.nonnegative && b.nonnegative;
+					round_to_float(r);
+					break;
+				}
+				case opcode::square_root: {
+					const value_bound a = pop();
+					// Ҳ䵽ϣ򵥾ȽΪ NaN
+					const double floor = a.lo * (1 - a.relative) - a.absolute;
+					if (a.lo < 0 || !(a.nonnegative || floor >= 0) || a.relative > 1) {
+						return false;
+					}
+					r = { std::sqrt(a.lo), std::sqrt(a.hi) };
+					// |(1 + ) - 1|  R / (1 + (1 - R))|(b + e) - b|  min(|e|, |e| / b)
+					r.relative = a.relative / (1 + std::sqrt(1 - a.relative));
+					r.absolute = std::min(std::sqrt(a.absolute), floor > 0 ? a.absolute / std::sqrt(floor) : INFINITY);
+					r.nonnegative = true;
+					round_to_float(r);
+					break;
+				}
+				case opcode::cubic_root: {
+					const value_bound a = pop();
+					if (a.relative > 1) {
+						return false;
+					}
+					r = { std::cbrt(a.lo), std::cbrt(a.hi) };
+					// |cbrt(1 + ) - 1|  R|cbrt(b + e) - cbrt(b)|  min(2^(2/3) cbrt|e|, |e| / (3 cbrt(b)^2))
+					const double low = std::cbrt(std::max(a.computed_floor(), 0.0));
+					r.relative = a.relative;
+					r.absolute = std::min(1.5875 * std::cbrt(a.absolute), low > 0 ? a.absolute / (3 * low * low) : INFINITY);
+					r.nonnegative = a.nonnegative;
+					round_to_float(r, 2);
+					break;
+				}
+				case opcode::degree:
+				case opcode::radian: {
+					const value_bound a = pop();
+					const double scale = ins.code == opcode::degree ? 180 / CONSTANT_PI : CONSTANT_PI / 180;
+					r = { a.lo * scale, a.hi * scale, a.relative, a.absolute * scale, a.nonnegative };
+					// ȵ  һ
+					round_to_float(r, 3);
+					break;
+				}
+				case opcode::sine:
+				case opcode::cosine: {
+					const value_bound a = pop();
+					const double shift = ins.code == opcode::cosine ? CONSTANT_PI / 2 : 0;
+					auto [low, high] = sine_range(a.lo + shift, a.hi + shift);
+					r = { low, high };
+					lipschitz(r, a);
+					round_to_float(r, 2);
+					break;
+				}
+				case opcode::arctangent: {
+					const value_bound a = pop();
+					r = { std::atan(a.lo), std::atan(a.hi) };
+					lipschitz(r, a);
+					r.nonnegative = a.nonnegative;
+					round_to_float(r, 2);
+					break;
+				}
+				case opcode::natural_logarithm:
+				case opcode::common_logarithm: {
+					const value_bound a = pop();
+					if (!(a.lo > 0 && a.computed_floor() > 0)) {
+						return false;
+					}
+					// |ln a' - ln a| = |ln(1 +  +  / a)|  -ln(1 - R - A / lo)
+					const double scale = ins.code == opcode::common_logarithm ? 0.43429448190325182765 : 1;
+					r = { std::log(a.lo) * scale, std::log(a.hi) * scale };
+					r.absolute = -std::log1p(-a.relative - a.absolute / a.lo) * scale;
+					round_to_float(r, 2);
+					break;
+				}
+				case opcode::exponent: {
+					const value_bound b = pop();
+					const value_bound a = pop();
+					const double n = b.lo;
+					if (b.lo == b.hi && b.relative == 0 && b.absolute == 0 && n == std::floor(n) && std::abs(n) <= 64) {
+						// ݣΪa' = a(1 + ) + (1 + )^n 
+						// ֵ |(c + )^n - c^n|  |n| ||^(n-1) || 
+						if (n < 0 && !(a.computed_floor() > 0)) {
+							return false;
+						}
+						r = corners(std::pow(a.lo, n), std::pow(a.hi, n), std::pow(a.lo, n), std::pow(a.hi, n));
+						const bool even = std::fmod(n, 2) == 0;
+						if (n > 0 && even && a.lo < 0 && a.hi > 0) {
+							r.lo = 0;
+						}
+						if (n != 0) {
+							const double xi = n > 0 ? a.magnitude() * (1 + a.relative) + a.absolute : a.computed_floor();
+							r.relative = std::pow(n > 0 ? 1 + a.relative : 1 - a.relative, n) - 1;
+							r.absolute = std::abs(n) * std::pow(xi, n - 1) * a.absolute;
+						}
+						r.nonnegative = even || a.nonnegative;
+					}
+					else {
+						// һݣҪΪa^b = e^(b ln a)ָŶ  ʱ e^ - 1
+						if (!(a.lo > 0 && a.computed_floor() > 0)) {
+							return false;
+						}
+						r = corners(std::pow(a.lo, b.lo), std::pow(a.lo, b.hi), std::pow(a.hi, b.lo), std::pow(a.hi, b.hi));
+						const double log_error = -std::log1p(-a.relative - a.absolute / a.lo);
+						const double log_magnitude = std::max(std::abs(std::log(a.lo)), std::abs(std::log(a.hi)));
+						const double delta = (b.magnitude() + b.error()) * log_error + log_magnitude * b.error();
+						r.relative = std::expm1(delta);
+						r.nonnegative = true;
+					}
+					round_to_float(r, 2);
+					break;
+				}
+				default:
+					return false;
+				}
+				if (!(r.magnitude() * (1 + r.relative) + r.absolute <= float_limit)) {
+					return false; // Ҳų NaN
+				}
+				stack.push_back(r);
+			}
+			return stack.back().error() <= tolerance * stack.back().magnitude();
+		}
+
+		// ˫ȳԽڵȲλϵĵãչ wide˫ں˼ص
+		template <typename Func>
+		inline void widened(float* x, size_t n, double* wide, Func func) {
+			for (size_t i = 0; i < n; i++) {
+				wide[i] = x[i];
+			}
+			unary_kernel(wide, n, func);
+			for (size_t i = 0; i < n; i++) {
+				x[i] = static_cast<float>(wide[i]);
+			}
+		}
+		template <typename Func>
+		inline void widened(float* a, const float* b, size_t n, double* wide, Func func) {
+			for (size_t i = 0; i < n; i++) {
+				wide[i] = a[i];
+				wide[float_block + i] = b[i];
+			}
+			binary_kernel(wide, wide + float_block, n, func);
+			for (size_t i = 0; i < n; i++) {
+				a[i] = static_cast<float>(wide[i]);
+			}
+		}
+
+		// ֵһ飬 run_block ͬÿλ float_block Уֻ float_supported 㡣
+		// 㡢˼ƽֱõԽ widened ʹ˫ں
+		template <typename Kernels>
+		void run_block_float(const program_view& program, float* tiles, double* wide, const float* const* inputs, size_t rows) {
+			const size_t max_depth = program.max_depth;
+			const size_t n = (rows + vfloat::width - 1) / vfloat::width * vfloat::width;
+			size_t sp = 0;
+			auto slot = [&](size_t index) { return tiles + index * float_block; };
+			for (const instruction& ins : program.code) {
+				switch (ins.code) {
+				case opcode::push_constant:
+					std::fill_n(slot(sp++), n, static_cast<float>(program.constants[ins.operand]));
+					break;
+				case opcode::load_variable: {
+					float* dst = slot(sp++);
+					std::copy_n(inputs[ins.operand], rows, dst);
+					std::fill(dst + rows, dst + n, 0.0f);
+					break;
+				}
+				case opcode::store_temp:
+					std::copy_n(slot(sp - 1), n, slot(max_depth + ins.operand));
+					break;
+				case opcode::load_temp:
+					std::copy_n(slot(max_depth + ins.operand), n, slot(sp++));
+					break;
+				case opcode::add:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vfloat a, vfloat b) { return a + b; });
+					break;
+				case opcode::minus:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vfloat a, vfloat b) { return a - b; });
+					break;
+				case opcode::multiply:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vfloat a, vfloat b) { return a * b; });
+					break;
+				case opcode::divide:
+					sp--;
+					binary_kernel(slot(sp - 1), slot(sp), n, [](vfloat a, vfloat b) { return a / b; });
+					break;
+				case opcode::multiply_add:
+					sp -= 2;
+					fma_kernel(slot(sp - 1), slot(sp), slot(sp + 1), n);
+					break;
+				case opcode::negate:
+					unary_kernel(slot(sp - 1), n, [](vfloat x) { return -x; });
+					break;
+				case opcode::square:
+					unary_kernel(slot(sp - 1), n, [](vfloat x) { return x * x; });
+					break;
+				case opcode::square_root:
+					unary_kernel(slot(sp - 1), n, [](vfloat x) { return sqrt(x); });
+					break;
+				case opcode::degree: {
+					const vfloat pi = vfloat::broadcast(static_cast<float>(CONSTANT_PI));
+					unary_kernel(slot(sp - 1), n, [pi](vfloat x) { return x / pi * vfloat::broadcast(180); });
+					break;
+				}
+				case opcode::radian: {
+					const vfloat pi = vfloat::broadcast(static_cast<float>(CONSTANT_PI));
+					unary_kernel(slot(sp - 1), n, [pi](vfloat x) { return x / vfloat::broadcast(180) * pi; });
+					break;
+				}
+				case opcode::exponent:
+					sp--;
+					widened(slot(sp - 1), slot(sp), n, wide, [](vdouble a, vdouble b) { return Kernels::pow(a, b); });
+					break;
+				case opcode::sine:
+					widened(slot(sp - 1), n, wide, [](vdouble x) { return Kernels::sin(x); });
+					break;
+				case opcode::cosine:
+					widened(slot(sp - 1), n, wide, [](vdouble x) { return Kernels::cos(x); });
+					break;
+				case opcode::arctangent:
+					widened(slot(sp - 1), n, wide, [](vdouble x) { return Kernels::atan(x); });
+					break;
+				case opcode::natural_logarithm:
+					widened(slot(sp - 1), n, wide, [](vdouble x) { return Kernels::log(x); });
+					break;
+				case opcode::common_logarithm:
+					widened(slot(sp - 1), n, wide, [](vdouble x) { return Kernels::log10(x); });
+					break;
+				case opcode::cubic_root:
+					widened(slot(sp - 1), n, wide, [](vdouble x) { return Kernels::cbrt(x); });
+					break;
+				default:
+					break;
+				}
+			}
+		}
+
+		// һεݵСֵֵNaN ԣ־µĽ NaN
+		inline std::pair<float, float> column_range(const float* x, size_t n) {
+			size_t i = 0;
+			float low = INFINITY, high = -INFINITY;
+			if (n >= vfloat::width) {
+				vfloat vlow = vfloat::broadcast(low), vhigh = vfloat::broadcast(high);
+				for (; i + vfloat::width <= n; i += vfloat::width) {
+					const vfloat v = vfloat::load(x + i);
+					vlow = min(v, vlow);
+					vhigh = max(v, vhigh);
+				}
+				alignas(64) float lows[vfloat::width], highs[vfloat::width];
+				vlow.store(lows);
+				vhigh.store(highs);
+				low = *std::min_element(lows, lows + vfloat::width);
+				high = *std::max_element(highs, highs + vfloat::width);
+			}
+			for (; i < n; i++) {
+				low = x[i] < low ? x[i] : low;
+				high = x[i] > high ? x[i] : high;
+			}
+			return { low, high };
+		}
+
+		template <typename Kernels>
+		float_batch_stats run_batch_float(const program_view& program, std::span<const std::span<const float>> columns,
+			std::span<float> out, double tolerance) {
+			const size_t slots = std::max<size_t>(program.max_depth, 1) + program.temp_count;
+			const bool supported = std::all_of(program.code.begin(), program.code.end(),
+				[](const instruction& ins) { return float_supported(ins.code); });
+			std::vector<float> tiles(slots * float_block);
+			std::vector<double> wide(2 * float_block);
+			std::vector<const float*> inputs(program.variable_count);
+			std::vector<value_bound> ranges(program.variable_count), stack, temps(program.temp_count);
+			stack.reserve(program.max_depth);
+			// ʱѱչΪ˫ȣٰ batch_block ֶ˫·ֵڵһλʱŷ
+			std::vector<double> fallback_tiles, fallback_columns, arguments;
+			std::vector<const double*> fallback_inputs(program.variable_count);
+			float_batch_stats stats;
+			for (size_t row = 0; row < out.size(); row += float_block) {
+				const size_t rows = std::min(float_block, out.size() - row);
+				for (size_t i = 0; i < inputs.size(); i++) {
+					inputs[i] = columns[i].data() + row;
+					auto [low, high] = column_range(inputs[i], rows);
+					ranges[i] = { low, high, 0, 0, low >= 0 };
+				}
+				stats.blocks++;
+				if (supported && float_safe(program, ranges, tolerance, stack, temps)) {
+					run_block_float<Kernels>(program, tiles.data(), wide.data(), inputs.data(), rows);
+					std::copy_n(tiles.data(), rows, out.data() + row);
+					continue;
+				}
+				stats.double_blocks++;
+				fallback_tiles.resize(slots * batch_block);
+				arguments.resize(program.max_depth);
+				fallback_columns.resize(program.variable_count * float_block);
+				for (size_t i = 0; i < inputs.size(); i++) {
+					std::copy_n(inputs[i], rows, fallback_columns.data() + i * float_block);
+				}
+				for (size_t part = 0; part < rows; part += batch_block) {
+					const size_t part_rows = std::min(batch_block, rows - part);
+					for (size_t i = 0; i < inputs.size(); i++) {
+						fallback_inputs[i] = fallback_columns.data() + i * float_block + part;
+					}
+					run_block<Kernels>(program, fallback_tiles.data(), arguments.data(), fallback_inputs.data(), part_rows);
+					for (size_t i = 0; i < part_rows; i++) {
+						out[row + part + i] = static_cast<float>(fallback_tiles[i]);
+					}
+				}
+			}
+			return stats;
+		}
+	}
+
+	void compiled_expression::evaluate_batch(std::span<const std::span<const double>> columns, std::span<double> out,
+		precision mode) const {
+		if (columns.size() < m_variables.size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		for (size_t i = 0; i < m_variables.size(); i++) {
+			if (columns[i].size() < out.size()) {
+				throw std::runtime_error("" + m_variables[i] + "ȡֵгȲ");
+			}
+		}
+		if (mode == precision::fast) {
+			run_batch<fast_kernels>(view(), columns, out);
+		}
+		else {
+			run_batch<exact_kernels>(view(), columns, out);
+		}
+	}
+
+	float_batch_stats compiled_expression::evaluate_batch(std::span<const std::span<const float>> columns, std::span<float> out,
+		precision mode, double tolerance) const {
+		if (columns.size() < m_variables.size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		for (size_t i = 0; i < m_variables.size(); i++) {
+			if (columns[i].size() < out.size()) {
+				throw std::runtime_error("" + m_variables[i] + "ȡֵгȲ");
+			}
+		}
+		if (mode == precision::fast) {
+			return run_batch_float<fast_kernels>(view(), columns, out, tolerance);
+		}
+		return run_batch_float<exact_kernels>(view(), columns, out, tolerance);
+	}
+}
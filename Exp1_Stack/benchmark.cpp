@@ -0,0 +1,380 @@
+#include "compiler.hpp"
+#include "static_expression.hpp"
+#include "big_number.hpp"
+
+#include <chrono>
+
+// ׼ԣģǶȷϷʽֱʱˮ߸׶Σ
+// ÿ, ׶Σһ JSONڽűȽϲͬ汾֮Ļع
+
+namespace {
+	// 
+	enum class operator_mix { arithmetic, power, function, mixed };
+
+	struct generator_config {
+		const char* name;
+		size_t tokens;      // Ŀ token ƣ
+		size_t max_depth;   // Ƕ
+		operator_mix mix;
+		bool variables;     // Ƿ񺬱 xyʱ׺ֵ׺ֵΪ󶨲λֵ
+	};
+
+	// ȷԵʽsplitmix64 ֻ㣬ͬ׼ʵͬ
+	class expression_generator {
+		std::uint64_t m_state;
+		generator_config m_config;
+		size_t m_budget;
+	public:
+		expression_generator(std::uint64_t seed, const generator_config& config) :m_state(seed), m_config(config), m_budget(0) {}
+		std::string next() {
+			m_budget = m_config.tokens;
+			std::string text;
+			term(text, 0);
+			while (m_budget > 2) {
+				text += binary_operator();
+				term(text, 0);
+			}
+			return text;
+		}
+	private:
+		std::uint64_t random() {
+			std::uint64_t z = (m_state += 0x9E3779B97F4A7C15ull);
+			z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+			z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+			return z ^ (z >> 31);
+		}
+		size_t below(size_t n) { return static_cast<size_t>(random() % n); }
+		std::string_view binary_operator() {
+			static constexpr std::string_view arithmetic[] = { "+", "-", "*", "/" };
+			static constexpr std::string_view power[] = { "+", "-", "*", "/", "^", "%" };
+			m_budget--;
+			return m_config.mix == operator_mix::power || (m_config.mix == operator_mix::mixed && below(3) == 0)
+				? power[below(std::size(power))] : arithmetic[below(std::size(arithmetic))];
+		}
+		void number(std::string& text) {
+			static constexpr std::string_view literals[] = { "1", "2", "3.5", "0.25", "7", "1e2", "0x1F", "0b101", "PI", "E" };
+			static constexpr std::string_view variables[] = { "x", "y" };
+			if (m_config.variables && below(2) == 0) {
+				text += variables[below(std::size(variables))];
+			}
+			else {
+				text += literals[below(std::size(literals))];
+			}
+			m_budget = m_budget > 0 ? m_budget - 1 : 0;
+		}
+		// ֡ӱʽãɵ
+		void term(std::string& text, size_t depth) {
+			static constexpr std::string_view functions[] = { "sin", "cos", "tan", "ln", "lg", "sqrt", "cbrt", "arctan" };
+			size_t choice = below(10);
+			bool can_nest = depth < m_config.max_depth && m_budget > 4;
+			bool prefer_function = m_config.mix == operator_mix::function || (m_config.mix == operator_mix::mixed && choice < 2);
+			if (can_nest && prefer_function && choice < 6) {
+				text += functions[below(std::size(functions))];
+				group(text, depth);
+			}
+			else if (can_nest && choice < 3) {
+				group(text, depth);
+			}
+			else {
+				number(text);
+			}
+			if (m_config.mix == operator_mix::power && below(20) == 0) {
+				text += '!';
+			}
+		}
+		void group(std::string& text, size_t depth) {
+			size_t inner = 2 + below(std::min<size_t>(m_budget / 2, 8));
+			size_t outer = m_budget > inner ? m_budget - inner : 0;
+			text += '(';
+			m_budget = inner;
+			term(text, depth + 1);
+			while (m_budget > 2) {
+				text += binary_operator();
+				term(text, depth + 1);
+			}
+			text += ')';
+			m_budget = outer;
+		}
+	};
+
+	struct phase_result {
+		double seconds;
+		size_t iterations;   // ɵıʽ
+		size_t allocations;
+	};
+
+	// ظִ bodyÿδȫʽֱۼʱ䲻 min_seconds
+	template <typename Body>
+	phase_result measure(size_t expressions, double min_seconds, Body body) {
+		using clock = std::chrono::steady_clock;
+		body(); // Ԥ
+		size_t allocations_before = chr::thread_allocation_count();
+		auto start = clock::now();
+		size_t rounds = 0;
+		double elapsed = 0;
+		do {
+			body();
+			rounds++;
+			elapsed = std::chrono::duration<double>(clock::now() - start).count();
+		} while (elapsed < min_seconds);
+		return { elapsed, rounds * expressions, chr::thread_allocation_count() - allocations_before };
+	}
+
+	void report(const generator_config& config, const char* phase, size_t expressions, size_t tokens, const phase_result& r) {
+		double rounds = static_cast<double>(r.iterations) / expressions;
+		double ns = r.seconds * 1e9;
+		std::printf("{\"config\":\"%s\",\"phase\":\"%s\",\"expressions\":%zu,\"tokens\":%zu,"
+			"\"ns_per_token\":%.3f,\"ns_per_expression\":%.3f,\"allocations_per_expression\":%.3f,"
+			"\"expressions_per_second\":%.1f}\n",
+			config.name, phase, expressions, tokens,
+			ns / (rounds * tokens), ns / r.iterations, static_cast<double>(r.allocations) / r.iterations,
+			r.iterations / r.seconds);
+	}
+}
+
+// ÷Benchmark [--seed N] [--count N] [--min-time ]
+int main(int argc, char* argv[]) {
+	std::uint64_t seed = 20240901;
+	size_t count = 1000;
+	double min_seconds = 0.2;
+	for (int i = 1; i + 1 < argc; i += 2) {
+		std::string arg = argv[i];
+		if (arg == "--seed") {
+			seed = std::stoull(argv[i + 1]);
+		}
+		else if (arg == "--count") {
+			count = std::stoul(argv[i + 1]);
+		}
+		else if (arg == "--min-time") {
+			min_seconds = std::stod(argv[i + 1]);
+		}
+	}
+	const generator_config configs[] = {
+		{ "small_arithmetic", 8, 1, operator_mix::arithmetic, false },
+		{ "medium_mixed", 40, 3, operator_mix::mixed, false },
+		{ "medium_power", 40, 2, operator_mix::power, false },
+		{ "medium_function", 40, 4, operator_mix::function, false },
+		{ "large_mixed", 400, 6, operator_mix::mixed, false },
+		{ "deep_mixed", 200, 24, operator_mix::mixed, false },
+		// ʽڹʱѱ۵ºòܷӳֵĿ
+		{ "medium_variables", 40, 3, operator_mix::mixed, true },
+		{ "large_variables", 400, 6, operator_mix::mixed, true },
+	};
+	for (const auto& config : configs) {
+		// ɲɸѡֻ֤ͨɹıʽ
+		expression_generator generator(seed, config);
+		std::vector<std::string> texts;
+		size_t tokens = 0;
+		chr::expression_tokenizer tokenizer;
+		while (texts.size() < count) {
+			std::string text = generator.next();
+			try {
+				if (tokenizer.validate(text)) {
+					chr::expression check(text);
+					tokens += tokenizer.lexemes().size();
+					texts.push_back(std::move(text));
+				}
+			}
+			catch (const std::exception&) {
+			}
+		}
+		std::vector<chr::expression> expressions;
+		std::vector<chr::compiled_expression> programs;
+		for (const auto& text : texts) {
+			expressions.emplace_back(text);
+			programs.emplace_back(expressions.back());
+		}
+		volatile double sink = 0;
+
+		report(config, "tokenize", count, tokens, measure(count, min_seconds, [&] {
+			for (const auto& text : texts) {
+				tokenizer.tokenize(text);
+			}
+		}));
+		report(config, "validate", count, tokens, measure(count, min_seconds, [&] {
+			for (const auto& text : texts) {
+				tokenizer.validate(text);
+			}
+		}));
+		report(config, "construct", count, tokens, measure(count, min_seconds, [&] {
+			for (const auto& text : texts) {
+				chr::expression e(text);
+				sink = sink + static_cast<double>(e.postfix().size());
+			}
+		}));
+		const double slots[] = { 1.25, 0.75 };
+		if (config.variables) {
+			report(config, "evaluate_bound", count, tokens, measure(count, min_seconds, [&] {
+				for (const auto& e : expressions) {
+					sink = sink + e.evaluate(slots);
+				}
+			}));
+		}
+		else {
+			report(config, "evaluate_from_postfix", count, tokens, measure(count, min_seconds, [&] {
+				for (const auto& e : expressions) {
+					sink = sink + e.evaluate_from_postfix();
+				}
+			}));
+			report(config, "evaluate_from_infix", count, tokens, measure(count, min_seconds, [&] {
+				for (const auto& e : expressions) {
+					sink = sink + e.evaluate_from_infix();
+				}
+			}));
+		}
+		report(config, "compile", count, tokens, measure(count, min_seconds, [&] {
+			for (const auto& e : expressions) {
+				chr::compiled_expression program(e);
+				sink = sink + static_cast<double>(program.code().size());
+			}
+		}));
+		report(config, "evaluate_compiled", count, tokens, measure(count, min_seconds, [&] {
+			for (const auto& program : programs) {
+				sink = sink + program.evaluate(slots);
+			}
+		}));
+		report(config, "evaluate_compiled_fast", count, tokens, measure(count, min_seconds, [&] {
+			for (const auto& program : programs) {
+				sink = sink + program.evaluate(slots, chr::precision::fast);
+			}
+		}));
+	}
+	// ̶ʽڽ static_expr д롢ʱĳԱȣȡֵα仯ⱻ۵
+	{
+		constexpr chr::static_expr<"2*sin(x)+y^2-x/3+sqrt(x*y)"> formula;
+		chr::compiled_expression program{ chr::expression(std::string(formula.text())) };
+		chr::expression_tokenizer tokenizer;
+		tokenizer.tokenize(std::string(formula.text()));
+		const generator_config config{ "fixed_formula", tokenizer.lexemes().size(), 0, operator_mix::mixed, true };
+		std::vector<double> xs(count);
+		for (size_t i = 0; i < count; i++) {
+			xs[i] = 0.5 + static_cast<double>(i) / count;
+		}
+		volatile double sink = 0;
+		report(config, "evaluate_static", count, config.tokens * count, measure(count, min_seconds, [&] {
+			for (double x : xs) {
+				sink = sink + formula(x, 1.5);
+			}
+		}));
+		report(config, "evaluate_handwritten", count, config.tokens * count, measure(count, min_seconds, [&] {
+			for (double x : xs) {
+				sink = sink + (2 * std::sin(x) + std::pow(1.5, 2) - x / 3 + std::sqrt(x * 1.5));
+			}
+		}));
+		report(config, "evaluate_compiled", count, config.tokens * count, measure(count, min_seconds, [&] {
+			for (double x : xs) {
+				const double slots[] = { x, 1.5 };
+				sink = sink + program.evaluate(slots);
+			}
+		}));
+		report(config, "evaluate_compiled_fast", count, config.tokens * count, measure(count, min_seconds, [&] {
+			for (double x : xs) {
+				const double slots[] = { x, 1.5 };
+				sink = sink + program.evaluate(slots, chr::precision::fast);
+			}
+		}));
+	}
+	// ؿʽֵͬһʽԴʽֵȽ־
+	{
+		const std::string text = "sqrt(-2*ln(x))*cos(2*PI*y)+arctan(x/y)+x^3-cbrt(x+y)";
+		chr::compiled_expression program{ chr::expression(text) };
+		chr::expression_tokenizer tokenizer;
+		tokenizer.tokenize(text);
+		const generator_config config{ "monte_carlo", tokenizer.lexemes().size(), 0, operator_mix::mixed, true };
+		std::vector<double> xs(count), ys(count), out(count);
+		for (size_t i = 0; i < count; i++) {
+			xs[i] = (i + 0.5) / count;
+			ys[i] = (count - i - 0.5) / count;
+		}
+		const std::span<const double> columns[] = { xs, ys };
+		volatile double sink = 0;
+		report(config, "evaluate_batch", count, config.tokens * count, measure(count, min_seconds, [&] {
+			program.evaluate_batch(columns, out);
+			sink = sink + out[0];
+		}));
+		report(config, "evaluate_batch_fast", count, config.tokens * count, measure(count, min_seconds, [&] {
+			program.evaluate_batch(columns, out, chr::precision::fast);
+			sink = sink + out[0];
+		}));
+	}
+	// 򣺱ж󰴴 64 λֵ double ֵͬǿư double ֵȽ
+	{
+		const std::string text = "0x1F*x+0b101*y-0o17+x^5%0x3F+(y%10)!";
+		chr::compiled_expression program{ chr::expression(text) };
+		chr::expression_tokenizer tokenizer;
+		tokenizer.tokenize(text);
+		const generator_config config{ "integer", tokenizer.lexemes().size(), 0, operator_mix::mixed, true };
+		std::vector<double> xs(count), ys(count);
+		for (size_t i = 0; i < count; i++) {
+			xs[i] = static_cast<double>(i % 1000);
+			ys[i] = static_cast<double>(i % 97);
+		}
+		volatile double sink = 0;
+		report(config, "evaluate_double", count, config.tokens * count, measure(count, min_seconds, [&] {
+			for (size_t i = 0; i < count; i++) {
+				const double slots[] = { xs[i], ys[i] };
+				sink = sink + program.view().evaluate(slots);
+			}
+		}));
+		report(config, "evaluate_integer", count, config.tokens * count, measure(count, min_seconds, [&] {
+			for (size_t i = 0; i < count; i++) {
+				const double slots[] = { xs[i], ys[i] };
+				sink = sink + program.evaluate(slots);
+			}
+		}));
+	}
+	// 궨ʽֵ뱾ǵȶȽ˫뵥ȣǷˣ·
+	{
+		const std::string text = "((0.0012*x-0.35)*x+12.5)*x/(y+273.15)+sqrt(x*y)";
+		chr::compiled_expression program{ chr::expression(text) };
+		chr::expression_tokenizer tokenizer;
+		tokenizer.tokenize(text);
+		const generator_config config{ "sensor", tokenizer.lexemes().size(), 0, operator_mix::mixed, true };
+		std::vector<float> xs(count), ys(count), out(count);
+		std::vector<double> xd(count), yd(count), outd(count);
+		for (size_t i = 0; i < count; i++) {
+			xs[i] = static_cast<float>(100.0 * (i + 0.5) / count);
+			ys[i] = static_cast<float>(50.0 * (count - i - 0.5) / count);
+			xd[i] = xs[i];
+			yd[i] = ys[i];
+		}
+		const std::span<const double> columns[] = { xd, yd };
+		const std::span<const float> float_columns[] = { xs, ys };
+		volatile double sink = 0;
+		report(config, "evaluate_batch", count, config.tokens * count, measure(count, min_seconds, [&] {
+			program.evaluate_batch(columns, outd);
+			sink = sink + outd[0];
+		}));
+		report(config, "evaluate_batch_float", count, config.tokens * count, measure(count, min_seconds, [&] {
+			program.evaluate_batch(float_columns, out);
+			sink = sink + out[0];
+		}));
+	}
+	// ȷģʽֵԼ 20000! Ķֳ˻ˡʮ
+	{
+		const std::string text = "5000!/(2500!*2500!)";
+		chr::exact_expression program(text);
+		chr::expression_tokenizer tokenizer;
+		tokenizer.tokenize(text);
+		const generator_config config{ "exact", tokenizer.lexemes().size(), 1, operator_mix::mixed, false };
+		volatile size_t sink = 0;
+		report(config, "evaluate_exact", 1, config.tokens, measure(1, min_seconds, [&] {
+			sink = sink + program.evaluate().numerator().limbs().size();
+		}));
+		report(config, "factorial_sequential", 1, config.tokens, measure(1, min_seconds, [&] {
+			chr::big_integer product(1);
+			for (std::int64_t k = 2; k <= 20000; k++) {
+				product *= k;
+			}
+			sink = sink + product.limbs().size();
+		}));
+		report(config, "factorial_split", 1, config.tokens, measure(1, min_seconds, [&] {
+			sink = sink + chr::big_integer::factorial(20000).limbs().size();
+		}));
+		const chr::big_integer factorial = chr::big_integer::factorial(20000);
+		report(config, "to_decimal", 1, config.tokens, measure(1, min_seconds, [&] {
+			sink = sink + factorial.to_string().size();
+		}));
+	}
+	return 0;
+}
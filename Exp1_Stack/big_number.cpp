@@ -0,0 +1,952 @@
+#include "big_number.hpp"
+
+#include <bit>
+
+namespace chr {
+	namespace {
+		using limb = std::uint32_t;
+		using wide = std::uint64_t;
+
+		// Ӷڴ˶ʱ Karatsuba
+		constexpr size_t karatsuba_threshold = 40;
+
+		[[noreturn]] void too_large() {
+			throw std::runtime_error("ȷ");
+		}
+
+		// ֵȽϣλβӰ
+		int compare_magnitude(const limb* a, size_t na, const limb* b, size_t nb) {
+			while (na > 0 && a[na - 1] == 0) {
+				na--;
+			}
+			while (nb > 0 && b[nb - 1] == 0) {
+				nb--;
+			}
+			if (na != nb) {
+				return na < nb ? -1 : 1;
+			}
+			for (size_t i = na; i-- > 0;) {
+				if (a[i] != b[i]) {
+					return a[i] < b[i] ? -1 : 1;
+				}
+			}
+			return 0;
+		}
+		int compare_magnitude(const std::vector<limb>& a, const std::vector<limb>& b) {
+			return compare_magnitude(a.data(), a.size(), b.data(), b.size());
+		}
+
+		// r[0, n) += a[0, n)ؽλ
+		limb add_into(limb* r, const limb* a, size_t n) {
+			wide carry = 0;
+			for (size_t i = 0; i < n; i++) {
+				carry += static_cast<wide>(r[i]) + a[i];
+				r[i] = static_cast<limb>(carry);
+				carry >>= 32;
+			}
+			return static_cast<limb>(carry);
+		}
+		// r[0, n) -= a[0, n)ؽλ
+		limb subtract_into(limb* r, const limb* a, size_t n) {
+			wide borrow = 0;
+			for (size_t i = 0; i < n; i++) {
+				wide d = static_cast<wide>(r[i]) - a[i] - borrow;
+				r[i] = static_cast<limb>(d);
+				borrow = d >> 63;
+			}
+			return static_cast<limb>(borrow);
+		}
+		// ѽλ/λ r[0, n)÷֤Խ r ĩβ
+		void propagate_carry(limb* r, size_t n, limb carry) {
+			for (size_t i = 0; carry != 0 && i < n; i++) {
+				r[i] += 1;
+				carry = r[i] == 0;
+			}
+		}
+		void propagate_borrow(limb* r, size_t n, limb borrow) {
+			for (size_t i = 0; borrow != 0 && i < n; i++) {
+				borrow = r[i] == 0;
+				r[i] -= 1;
+			}
+		}
+		// r[0, size)  a[0, n)  offset 
+		void add_shifted(limb* r, size_t size, const limb* a, size_t n, size_t offset) {
+			limb carry = add_into(r + offset, a, n);
+			propagate_carry(r + offset + n, size - offset - n, carry);
+		}
+
+		// r[0, na + nb) = ab
+		void schoolbook(const limb* a, size_t na, const limb* b, size_t nb, limb* r) {
+			std::fill(r, r + na + nb, 0);
+			for (size_t i = 0; i < na; i++) {
+				wide ai = a[i];
+				if (ai == 0) {
+					continue;
+				}
+				wide carry = 0;
+				for (size_t j = 0; j < nb; j++) {
+					carry += ai * b[j] + r[i + j];
+					r[i + j] = static_cast<limb>(carry);
+					carry >>= 32;
+				}
+				r[i + nb] = static_cast<limb>(carry);
+			}
+		}
+
+		// out[0, nx) = |x - y|Ҫ ny <= nxx < y ʱ true
+		bool absolute_difference(const limb* x, size_t nx, const limb* y, size_t ny, limb* out) {
+			if (compare_magnitude(x, nx, y, ny) >= 0) {
+				std::copy(x, x + nx, out);
+				propagate_borrow(out + ny, nx - ny, subtract_into(out, y, ny));
+				return false;
+			}
+			// x < y ʱ x  ny ĸλζ
+			std::copy(y, y + ny, out);
+			std::fill(out + ny, out + nx, 0);
+			subtract_into(out, x, ny);
+			return true;
+		}
+
+		// r[0, 2n) = a[0, n)b[0, n)Ϊ l  m Σl >= m
+		//   ab = z0 + (z0 + z2 - (a0 - a1)(b0 - b1))B^l + z2B^2lz0 = a0b0z2 = a1b1
+		// ΰ볤˷ĴΣscratch Ҫ karatsuba_scratch(n) 
+		void karatsuba(const limb* a, const limb* b, size_t n, limb* r, limb* scratch) {
+			if (n < karatsuba_threshold) {
+				schoolbook(a, n, b, n, r);
+				return;
+			}
+			size_t l = (n + 1) / 2, m = n - l;
+			karatsuba(a, b, l, r, scratch);
+			karatsuba(a + l, b + l, m, r + 2 * l, scratch);
+			limb* da = scratch;
+			limb* db = scratch + l;
+			limb* t = scratch + 2 * l;
+			bool negative_a = absolute_difference(a, l, a + l, m, da);
+			bool negative_b = absolute_difference(b, l, b + l, m, db);
+			karatsuba(da, db, l, t, scratch + 4 * l);
+			// м a0b1 + a1b0 Ǹ 2l + 1 Σ dadb ֮Ŀռ
+			limb* middle = scratch + 4 * l;
+			std::copy(r, r + 2 * l, middle);
+			middle[2 * l] = 0;
+			add_shifted(middle, 2 * l + 1, r + 2 * l, 2 * m, 0);
+			if (negative_a == negative_b) {
+				propagate_borrow(middle + 2 * l, 1, subtract_into(middle, t, 2 * l));
+			}
+			else {
+				add_shifted(middle, 2 * l + 1, t, 2 * l, 0);
+			}
+			size_t length = std::min(2 * l + 1, 2 * n - l);
+			add_shifted(r, 2 * n, middle, length, l);
+		}
+		// ÿڵݹ֮ʹ 4l Σl ԼΪ n/2ۼӲ 4n ÿȡ
+		size_t karatsuba_scratch(size_t n) {
+			return 6 * n + 64;
+		}
+
+		std::vector<limb> multiply_magnitude(const std::vector<limb>& a, const std::vector<limb>& b) {
+			if (a.empty() || b.empty()) {
+				return {};
+			}
+			const std::vector<limb>& x = a.size() >= b.size() ? a : b;
+			const std::vector<limb>& y = a.size() >= b.size() ? b : a;
+			std::vector<limb> r(x.size() + y.size());
+			if (y.size() < karatsuba_threshold) {
+				schoolbook(x.data(), x.size(), y.data(), y.size(), r.data());
+				return r;
+			}
+			// ʱѳһг̵һȳɶΣֱ Karatsuba λ
+			size_t n = y.size();
+			std::vector<limb> scratch(karatsuba_scratch(n)), piece(2 * n);
+			for (size_t offset = 0; offset < x.size(); offset += n) {
+				size_t length = std::min(n, x.size() - offset);
+				if (length == n) {
+					karatsuba(x.data() + offset, y.data(), n, piece.data(), scratch.data());
+					add_shifted(r.data(), r.size(), piece.data(), 2 * n, offset);
+				}
+				else {
+					std::vector<limb> rest = multiply_magnitude(y, std::vector<limb>(x.begin() + offset, x.end()));
+					add_shifted(r.data(), r.size(), rest.data(), rest.size(), offset);
+				}
+			}
+			return r;
+		}
+
+		// a = afactor + addend
+		void multiply_add_small(std::vector<limb>& a, limb factor, limb addend) {
+			wide carry = addend;
+			for (limb& x : a) {
+				carry += static_cast<wide>(x) * factor;
+				x = static_cast<limb>(carry);
+				carry >>= 32;
+			}
+			if (carry != 0) {
+				a.push_back(static_cast<limb>(carry));
+			}
+		}
+
+		// Knuth 㷨 Da = qb + rb 㣻ȰѳƵλΪ 1ÿһλ̹ƫ 1
+		void divide_magnitude(const std::vector<limb>& a, const std::vector<limb>& b, std::vector<limb>& q, std::vector<limb>& r) {
+			if (compare_magnitude(a, b) < 0) {
+				q.clear();
+				r = a;
+				return;
+			}
+			if (b.size() == 1) {
+				q.assign(a.size(), 0);
+				wide rest = 0;
+				for (size_t i = a.size(); i-- > 0;) {
+					wide current = rest << 32 | a[i];
+					q[i] = static_cast<limb>(current / b[0]);
+					rest = current % b[0];
+				}
+				r.assign(1, static_cast<limb>(rest));
+				return;
+			}
+			int shift = std::countl_zero(b.back());
+			auto shifted = [shift](const std::vector<limb>& x, size_t extra) {
+				std::vector<limb> y(x.size() + extra);
+				for (size_t i = 0; i < x.size(); i++) {
+					y[i] |= x[i] << shift;
+					if (shift != 0 && i + 1 < y.size()) {
+						y[i + 1] |= x[i] >> (32 - shift);
+					}
+				}
+				return y;
+			};
+			std::vector<limb> u = shifted(a, 1), v = shifted(b, 0);
+			size_t n = v.size(), m = u.size() - n;
+			q.assign(m, 0);
+			for (size_t j = m; j-- > 0;) {
+				wide numerator = static_cast<wide>(u[j + n]) << 32 | u[j + n - 1];
+				wide qhat = numerator / v[n - 1], rhat = numerator % v[n - 1];
+				while (qhat >> 32 || qhat * v[n - 2] > (rhat << 32 | u[j + n - 2])) {
+					qhat--;
+					rhat += v[n - 1];
+					if (rhat >> 32) {
+						break;
+					}
+				}
+				// u[j, j + n] -= qhatvзŵ k ͬʱЯ˷λλ
+				std::int64_t k = 0, t = 0;
+				for (size_t i = 0; i < n; i++) {
+					wide p = qhat * v[i];
+					t = static_cast<std::int64_t>(u[i + j]) - k - static_cast<std::int64_t>(p & 0xFFFFFFFF);
+					u[i + j] = static_cast<limb>(t);
+					k = static_cast<std::int64_t>(p >> 32) - (t >> 32);
+				}
+				t = static_cast<std::int64_t>(u[j + n]) - k;
+				u[j + n] = static_cast<limb>(t);
+				if (t < 0) {
+					// ƫ 1Լ 2/2^32ӻһ
+					qhat--;
+					u[j + n] += add_into(u.data() + j, v.data(), n);
+				}
+				q[j] = static_cast<limb>(qhat);
+			}
+			r.assign(n, 0);
+			for (size_t i = 0; i < n; i++) {
+				r[i] = u[i] >> shift;
+				if (shift != 0) {
+					r[i] |= u[i + 1] << (32 - shift);
+				}
+			}
+		}
+
+		void trim_magnitude(std::vector<limb>& a) {
+			while (!a.empty() && a.back() == 0) {
+				a.pop_back();
+			}
+		}
+
+		// ʮת̵ 10^9 10^(92^k) ֣ߵֱݹ飬
+		// ܴԼΪ 10^9 һ룬ûĳӳ
+		constexpr size_t decimal_threshold = 60;
+
+		//  value ʮд out[0, width)λ㣻width Ϊ 9 ı㹻 value
+		void write_decimal(std::vector<limb> value, char* out, size_t width) {
+			constexpr wide chunk = 1000000000; // ǳѳɳ˷
+			std::fill(out, out + width, '0');
+			for (size_t end = width; !value.empty(); end -= 9) {
+				wide remainder = 0;
+				for (size_t i = value.size(); i-- > 0;) {
+					wide current = remainder << 32 | value[i];
+					value[i] = static_cast<limb>(current / chunk);
+					remainder = current % chunk;
+				}
+				trim_magnitude(value);
+				for (size_t k = end; remainder != 0; remainder /= 10) {
+					out[--k] = static_cast<char>('0' + remainder % 10);
+				}
+			}
+		}
+		// powers[k] = 10^(92^k)value < powers[level] ʱд 92^level λ
+		void write_decimal(const std::vector<limb>& value, const std::vector<std::vector<limb>>& powers, size_t level, char* out) {
+			size_t width = size_t(9) << level;
+			if (level == 0 || value.size() < decimal_threshold) {
+				write_decimal(value, out, width);
+				return;
+			}
+			std::vector<limb> high, low;
+			divide_magnitude(value, powers[level - 1], high, low);
+			trim_magnitude(high);
+			trim_magnitude(low);
+			write_decimal(high, powers, level - 1, out);
+			write_decimal(low, powers, level - 1, out + width / 2);
+		}
+
+		// [first, last] ȫĳ˻firstlast ֵݹ飬
+		// ÿ˵ӳ˷ Karatsuba
+		big_integer odd_product(std::uint64_t first, std::uint64_t last) {
+			std::uint64_t count = (last - first) / 2 + 1;
+			if (count <= 16) {
+				big_integer result(1);
+				std::int64_t partial = 1;
+				for (std::uint64_t k = first; k <= last; k += 2) {
+					if (partial > INT64_MAX / static_cast<std::int64_t>(k)) {
+						result *= partial;
+						partial = 1;
+					}
+					partial *= static_cast<std::int64_t>(k);
+				}
+				return result * partial;
+			}
+			std::uint64_t middle = first + count / 2 * 2;
+			return odd_product(first, middle - 2) * odd_product(middle, last);
+		}
+	}
+
+	big_integer::big_integer(std::vector<std::uint32_t> limbs, bool negative) :m_limbs(std::move(limbs)), m_negative(negative) {
+		trim();
+	}
+
+	big_integer::big_integer(std::int64_t value) :m_negative(value < 0) {
+		// ȡֵʱתΪ޷INT64_MIN 
+		std::uint64_t magnitude = value < 0 ? 0 - static_cast<std::uint64_t>(value) : static_cast<std::uint64_t>(value);
+		while (magnitude != 0) {
+			m_limbs.push_back(static_cast<limb>(magnitude));
+			magnitude >>= 32;
+		}
+	}
+
+	void big_integer::trim() {
+		trim_magnitude(m_limbs);
+		if (m_limbs.empty()) {
+			m_negative = false;
+		}
+	}
+
+	big_integer big_integer::parse(std::string_view digits, int radix) {
+		if (digits.empty()) {
+			throw std::runtime_error("ִΪ");
+		}
+		auto value_of = [radix](char c) {
+			int d = c >= '0' && c <= '9' ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 : c >= 'a' && c <= 'f' ? c - 'a' + 10 : radix;
+			if (d >= radix) {
+				throw std::runtime_error("ִкзǷַ " + std::string(1, c));
+			}
+			return static_cast<limb>(d);
+		};
+		std::vector<limb> limbs;
+		if (radix == 10) {
+			// ÿ 9 λʮһ飬 10^9 
+			size_t head = digits.size() % 9 == 0 ? 9 : digits.size() % 9;
+			for (size_t pos = 0; pos < digits.size(); pos += head, head = 9) {
+				limb chunk = 0, scale = 1;
+				for (char c : digits.substr(pos, head)) {
+					chunk = chunk * 10 + value_of(c);
+					scale *= 10;
+				}
+				multiply_add_small(limbs, scale, chunk);
+			}
+		}
+		else {
+			// 2 ݽƣλʼλƴ
+			const int width = std::countr_zero(static_cast<unsigned>(radix));
+			std::uint64_t position = 0;
+			limbs.assign((digits.size() * width + 31) / 32, 0);
+			for (size_t i = digits.size(); i-- > 0; position += width) {
+				limb d = value_of(digits[i]);
+				limbs[position / 32] |= d << (position % 32);
+				if (position % 32 + width > 32) {
+					limbs[position / 32 + 1] |= d >> (32 - position % 32);
+				}
+			}
+		}
+		return big_integer(std::move(limbs), false);
+	}
+
+	std::uint64_t big_integer::bits() const {
+		return m_limbs.empty() ? 0 : 32 * (m_limbs.size() - 1) + std::bit_width(m_limbs.back());
+	}
+
+	std::optional<std::int64_t> big_integer::to_int64() const {
+		if (m_limbs.size() > 2) {
+			return std::nullopt;
+		}
+		std::uint64_t magnitude = 0;
+		for (size_t i = m_limbs.size(); i-- > 0;) {
+			magnitude = magnitude << 32 | m_limbs[i];
+		}
+		if (magnitude > static_cast<std::uint64_t>(INT64_MAX) + m_negative) {
+			return std::nullopt;
+		}
+		return m_negative ? static_cast<std::int64_t>(0 - magnitude) : static_cast<std::int64_t>(magnitude);
+	}
+
+	double big_integer::to_double() const {
+		std::uint64_t length = bits();
+		if (length <= 64) {
+			std::uint64_t magnitude = 0;
+			for (size_t i = m_limbs.size(); i-- > 0;) {
+				magnitude = magnitude << 32 | m_limbs[i];
+			}
+			return m_negative ? -static_cast<double>(magnitude) : static_cast<double>(magnitude);
+		}
+		// ȡ 64 λλǷ㲢λճλתʱֻһ
+		std::uint64_t shift = length - 64;
+		big_integer top = *this >> shift;
+		std::uint64_t head = static_cast<std::uint64_t>(top.m_limbs[1]) << 32 | top.m_limbs[0];
+		bool sticky = false;
+		for (std::uint64_t i = 0; i < shift / 32 && !sticky; i++) {
+			sticky = m_limbs[i] != 0;
+		}
+		if (shift % 32 != 0 && (m_limbs[shift / 32] & ((limb(1) << (shift % 32)) - 1)) != 0) {
+			sticky = true;
+		}
+		double value = std::ldexp(static_cast<double>(head | sticky), static_cast<int>(std::min<std::uint64_t>(shift, 4096)));
+		return m_negative ? -value : value;
+	}
+
+	std::string big_integer::to_string(int radix) const {
+		std::string digits;
+		if (radix == 10) {
+			std::vector<std::vector<limb>> powers{ { 1000000000 } };
+			while (compare_magnitude(powers.back(), m_limbs) <= 0) {
+				powers.push_back(multiply_magnitude(powers.back(), powers.back()));
+				trim_magnitude(powers.back());
+			}
+			digits.assign(size_t(9) << (powers.size() - 1), '0');
+			write_decimal(m_limbs, powers, powers.size() - 1, digits.data());
+			digits.erase(0, std::min(digits.find_first_not_of('0'), digits.size() - 1));
+		}
+		else if (radix == 2 || radix == 8 || radix == 16) {
+			constexpr char symbols[] = "0123456789ABCDEF";
+			const int width = std::countr_zero(static_cast<unsigned>(radix));
+			std::uint64_t count = std::max<std::uint64_t>(1, (bits() + width - 1) / width);
+			digits.reserve(count + 2);
+			digits = radix == 2 ? "0b" : radix == 8 ? "0o" : "0x";
+			for (std::uint64_t i = count; i-- > 0;) {
+				std::uint64_t position = i * width;
+				wide window = m_limbs.empty() ? 0 : m_limbs[position / 32];
+				if (position / 32 + 1 < m_limbs.size()) {
+					window |= static_cast<wide>(m_limbs[position / 32 + 1]) << 32;
+				}
+				digits += symbols[(window >> (position % 32)) & (radix - 1)];
+			}
+		}
+		else {
+			throw std::runtime_error("ֵ֧Ľƣ" + std::to_string(radix));
+		}
+		return m_negative ? "-" + digits : digits;
+	}
+
+	big_integer big_integer::operator-() const {
+		big_integer r = *this;
+		r.m_negative = !r.m_negative;
+		r.trim();
+		return r;
+	}
+
+	big_integer big_integer::abs() const {
+		big_integer r = *this;
+		r.m_negative = false;
+		return r;
+	}
+
+	big_integer operator+(const big_integer& a, const big_integer& b) {
+		if (a.m_negative == b.m_negative) {
+			std::vector<limb> r(std::max(a.m_limbs.size(), b.m_limbs.size()) + 1);
+			std::copy(a.m_limbs.begin(), a.m_limbs.end(), r.begin());
+			add_shifted(r.data(), r.size(), b.m_limbs.data(), b.m_limbs.size(), 0);
+			return big_integer(std::move(r), a.m_negative);
+		}
+		// ţľֵȥСģֵһ
+		bool a_larger = compare_magnitude(a.m_limbs, b.m_limbs) >= 0;
+		const big_integer& x = a_larger ? a : b;
+		const big_integer& y = a_larger ? b : a;
+		std::vector<limb> r = x.m_limbs;
+		propagate_borrow(r.data() + y.m_limbs.size(), r.size() - y.m_limbs.size(), subtract_into(r.data(), y.m_limbs.data(), y.m_limbs.size()));
+		return big_integer(std::move(r), x.m_negative);
+	}
+
+	big_integer operator-(const big_integer& a, const big_integer& b) {
+		return a + -b;
+	}
+
+	big_integer operator*(const big_integer& a, const big_integer& b) {
+		return big_integer(multiply_magnitude(a.m_limbs, b.m_limbs), a.m_negative != b.m_negative);
+	}
+
+	big_integer big_integer::operator<<(std::uint64_t shift) const {
+		if (m_limbs.empty()) {
+			return *this;
+		}
+		if (bits() + shift > big_bit_limit) {
+			too_large();
+		}
+		size_t whole = shift / 32, part = shift % 32;
+		std::vector<limb> r(m_limbs.size() + whole + 1);
+		for (size_t i = 0; i < m_limbs.size(); i++) {
+			r[i + whole] |= m_limbs[i] << part;
+			if (part != 0) {
+				r[i + whole + 1] |= m_limbs[i] >> (32 - part);
+			}
+		}
+		return big_integer(std::move(r), m_negative);
+	}
+
+	big_integer big_integer::operator>>(std::uint64_t shift) const {
+		if (shift >= bits()) {
+			return big_integer();
+		}
+		size_t whole = shift / 32, part = shift % 32;
+		std::vector<limb> r(m_limbs.size() - whole);
+		for (size_t i = 0; i < r.size(); i++) {
+			r[i] = m_limbs[i + whole] >> part;
+			if (part != 0 && i + whole + 1 < m_limbs.size()) {
+				r[i] |= m_limbs[i + whole + 1] << (32 - part);
+			}
+		}
+		return big_integer(std::move(r), m_negative);
+	}
+
+	void big_integer::divide(const big_integer& a, const big_integer& b, big_integer& quotient, big_integer& remainder) {
+		if (b.is_zero()) {
+			throw std::runtime_error("Ϊ");
+		}
+		std::vector<limb> q, r;
+		divide_magnitude(a.m_limbs, b.m_limbs, q, r);
+		quotient = big_integer(std::move(q), a.m_negative != b.m_negative);
+		remainder = big_integer(std::move(r), a.m_negative);
+	}
+
+	big_integer big_integer::gcd(big_integer a, big_integer b) {
+		a.m_negative = b.m_negative = false;
+		big_integer q, r;
+		while (!b.is_zero()) {
+			divide(a, b, q, r);
+			a = std::move(b);
+			b = std::move(r);
+		}
+		return a;
+	}
+
+	std::strong_ordering operator<=>(const big_integer& a, const big_integer& b) {
+		if (a.m_negative != b.m_negative) {
+			return a.m_negative ? std::strong_ordering::less : std::strong_ordering::greater;
+		}
+		int order = compare_magnitude(a.m_limbs, b.m_limbs);
+		if (a.m_negative) {
+			order = -order;
+		}
+		return order < 0 ? std::strong_ordering::less : order > 0 ? std::strong_ordering::greater : std::strong_ordering::equal;
+	}
+
+	// n! = 2^(n - popcount(n)) ( n/2^i ֮)Ը³ֵ䣬
+	// ÿĳ˻ֵݹ㣻2 һλ
+	big_integer big_integer::factorial(std::uint64_t n) {
+		if (n > 1 && std::lgamma(static_cast<double>(n) + 1) / std::log(2.0) > static_cast<double>(big_bit_limit)) {
+			too_large();
+		}
+		big_integer result(1), odd(1);
+		for (int i = std::bit_width(n) - 1; i >= 0; i--) {
+			std::uint64_t low = (n >> (i + 1)) + 1, high = n >> i;
+			std::uint64_t first = low | 1, last = high & 1 ? high : high - 1;
+			if (first <= last) {
+				odd *= odd_product(first, last);
+			}
+			result *= odd;
+		}
+		return result << (n - std::popcount(n));
+	}
+
+	// Ը͵ƽݣ 2^k ʱƳݺһλ
+	big_integer big_integer::power(const big_integer& base, std::uint64_t exponent) {
+		if (exponent == 0) {
+			return big_integer(1);
+		}
+		if (base.is_zero()) {
+			return base;
+		}
+		std::uint64_t twos = 0;
+		while (base.m_limbs[twos / 32] == 0) {
+			twos += 32;
+		}
+		twos += std::countr_zero(base.m_limbs[twos / 32]);
+		big_integer odd = base.abs() >> twos;
+		std::uint64_t odd_bits = odd.bits() - 1; //  odd_bitsexponent λ
+		if ((odd_bits != 0 && exponent > big_bit_limit / odd_bits) || (twos != 0 && exponent > big_bit_limit / twos)) {
+			too_large();
+		}
+		big_integer result(1);
+		for (int i = std::bit_width(exponent) - 1; i >= 0; i--) {
+			result *= result;
+			if (exponent >> i & 1) {
+				result *= odd;
+			}
+		}
+		result = result << twos * exponent;
+		result.m_negative = base.m_negative && (exponent & 1);
+		return result;
+	}
+
+	big_rational::big_rational(big_integer numerator, big_integer denominator) :m_numerator(std::move(numerator)), m_denominator(std::move(denominator)) {
+		if (m_denominator.is_zero()) {
+			throw std::runtime_error("Ϊ");
+		}
+		normalize();
+	}
+
+	void big_rational::normalize() {
+		if (m_denominator.is_negative()) {
+			m_numerator = -m_numerator;
+			m_denominator = -m_denominator;
+		}
+		if (is_integer()) {
+			return;
+		}
+		big_integer g = big_integer::gcd(m_numerator, m_denominator);
+		if (!(g == big_integer(1))) {
+			big_integer rest;
+			big_integer::divide(m_numerator, g, m_numerator, rest);
+			big_integer::divide(m_denominator, g, m_denominator, rest);
+		}
+	}
+
+	double big_rational::to_double() const {
+		if (is_integer()) {
+			return m_numerator.to_double();
+		}
+		// ȡ 65 λʱλճλתΪ double ʱֻһ
+		std::int64_t shift = static_cast<std::int64_t>(m_denominator.bits()) - static_cast<std::int64_t>(m_numerator.bits()) + 65;
+		shift = std::max<std::int64_t>(shift, 0);
+		big_integer quotient, remainder;
+		big_integer::divide(m_numerator << shift, m_denominator, quotient, remainder);
+		if (!remainder.is_zero()) {
+			quotient = quotient.is_odd() ? quotient : quotient + big_integer(quotient.is_negative() ? -1 : 1);
+		}
+		return std::ldexp(quotient.to_double(), -static_cast<int>(std::min<std::int64_t>(shift, 4096)));
+	}
+
+	std::string big_rational::to_string(int radix) const {
+		if (is_integer()) {
+			return m_numerator.to_string(radix);
+		}
+		// ĸֻ 22/8/16 ƣֻ 2  5ʮƣʱСӳ radix^k ʹĸ
+		big_integer rest = m_denominator, q, r;
+		const big_integer five(5);
+		std::uint64_t twos = 0, fives = 0;
+		for (; !rest.is_odd(); twos++) {
+			rest = rest >> 1;
+		}
+		if (radix == 10) {
+			for (big_integer::divide(rest, five, q, r); r.is_zero() && !(rest == big_integer(1)); big_integer::divide(rest, five, q, r)) {
+				rest = q;
+				fives++;
+			}
+		}
+		if (!(rest == big_integer(1))) {
+			return m_numerator.to_string(radix) + "/" + m_denominator.abs().to_string(radix);
+		}
+		const std::uint64_t width = radix == 10 ? 0 : std::countr_zero(static_cast<unsigned>(radix));
+		std::uint64_t places = radix == 10 ? std::max(twos, fives) : (twos + width - 1) / width;
+		big_integer scaled;
+		if (radix == 10) {
+			// ӡ10^k / (2^twos5^fives) = ӡ2^(k-twos)5^(k-fives)
+			scaled = (m_numerator * big_integer::power(five, places - fives)) << (places - twos);
+		}
+		else {
+			scaled = m_numerator << (places * width - twos);
+		}
+		std::string digits = scaled.abs().to_string(radix);
+		size_t prefix = radix == 10 ? 0 : 2;
+		if (digits.size() - prefix <= places) {
+			digits.insert(prefix, places - (digits.size() - prefix) + 1, '0');
+		}
+		digits.insert(digits.size() - places, ".");
+		return m_numerator.is_negative() ? "-" + digits : digits;
+	}
+
+	big_rational operator+(const big_rational& a, const big_rational& b) {
+		if (a.is_integer() && b.is_integer()) {
+			return big_rational(a.m_numerator + b.m_numerator);
+		}
+		if (a.m_denominator == b.m_denominator) {
+			return big_rational(a.m_numerator + b.m_numerator, a.m_denominator);
+		}
+		return big_rational(a.m_numerator * b.m_denominator + b.m_numerator * a.m_denominator, a.m_denominator * b.m_denominator);
+	}
+
+	big_rational operator-(const big_rational& a, const big_rational& b) {
+		return a + -b;
+	}
+
+	big_rational operator*(const big_rational& a, const big_rational& b) {
+		if (a.is_integer() && b.is_integer()) {
+			return big_rational(a.m_numerator * b.m_numerator);
+		}
+		return big_rational(a.m_numerator * b.m_numerator, a.m_denominator * b.m_denominator);
+	}
+
+	big_rational operator/(const big_rational& a, const big_rational& b) {
+		if (b.is_zero()) {
+			throw std::runtime_error("Ϊ");
+		}
+		if (a.is_integer() && b.is_integer()) {
+			// ʱһļͨˣһγýԼ
+			big_integer q, r;
+			big_integer::divide(a.m_numerator, b.m_numerator, q, r);
+			if (r.is_zero()) {
+				return big_rational(std::move(q));
+			}
+			return big_rational(a.m_numerator, b.m_numerator);
+		}
+		return big_rational(a.m_numerator * b.m_denominator, a.m_denominator * b.m_numerator);
+	}
+
+	big_rational operator%(const big_rational& a, const big_rational& b) {
+		if (b.is_zero()) {
+			throw std::runtime_error("Ϊ");
+		}
+		big_integer q, r;
+		if (a.is_integer() && b.is_integer()) {
+			big_integer::divide(a.m_numerator, b.m_numerator, q, r);
+			return big_rational(std::move(r));
+		}
+		big_integer::divide(a.m_numerator * b.m_denominator, a.m_denominator * b.m_numerator, q, r);
+		return a - big_rational(std::move(q)) * b;
+	}
+
+	big_rational big_rational::power(const big_rational& base, const big_integer& exponent) {
+		// Ϊ 0  1 ʱָ
+		if (base.is_zero()) {
+			if (exponent.is_negative()) {
+				throw std::runtime_error("ĸ");
+			}
+			return exponent.is_zero() ? big_rational(1) : base;
+		}
+		if (base.is_integer() && base.m_numerator.abs() == big_integer(1)) {
+			return base.is_negative() && exponent.is_odd() ? big_rational(-1) : big_rational(1);
+		}
+		auto count = exponent.abs().to_int64();
+		if (!count) {
+			too_large();
+		}
+		// ӷĸأԳ˷Ȼ
+		big_integer numerator = big_integer::power(base.m_numerator, static_cast<std::uint64_t>(*count));
+		big_integer denominator = big_integer::power(base.m_denominator, static_cast<std::uint64_t>(*count));
+		if (!exponent.is_negative()) {
+			return big_rational(std::move(numerator), std::move(denominator), 0);
+		}
+		if (numerator.is_negative()) {
+			return big_rational(-denominator, -numerator, 0);
+		}
+		return big_rational(std::move(denominator), std::move(numerator), 0);
+	}
+
+	namespace {
+		// ľȷֵʮưִʮݴΣ//ʮƵС 2 ݷ֮һ
+		big_rational literal_value(std::string_view str, token_t type) {
+			if (type == token_t::decimal_number) {
+				size_t e = str.find_first_of("eE");
+				std::string_view mantissa = str.substr(0, e);
+				std::int64_t exponent = 0;
+				if (e != std::string_view::npos) {
+					std::string_view text = str.substr(e + 1);
+					if (text.starts_with('+')) {
+						text.remove_prefix(1);
+					}
+					if (std::from_chars(text.data(), text.data() + text.size(), exponent).ec != std::errc()) {
+						too_large();
+					}
+				}
+				size_t dot = mantissa.find('.');
+				std::string digits(mantissa.substr(0, dot));
+				if (dot != std::string_view::npos) {
+					digits += mantissa.substr(dot + 1);
+					exponent -= static_cast<std::int64_t>(mantissa.size() - dot - 1);
+				}
+				big_integer value = big_integer::parse(digits, 10);
+				if (value.is_zero()) {
+					return big_rational();
+				}
+				// 10^k Լ 3.32k λ
+				if (exponent > static_cast<std::int64_t>(big_bit_limit / 3) || exponent < -static_cast<std::int64_t>(big_bit_limit / 3)) {
+					too_large();
+				}
+				big_integer scale = big_integer::power(10, static_cast<std::uint64_t>(exponent < 0 ? -exponent : exponent));
+				return exponent >= 0 ? big_rational(value * scale) : big_rational(std::move(value), std::move(scale));
+			}
+			if (type == token_t::constant_number) {
+				throw std::runtime_error("ȷģʽֳ֧ " + std::string(str) + "");
+			}
+			const int radix = type == token_t::binary_number ? 2 : type == token_t::octal_number ? 8 : 16;
+			const std::uint64_t width = std::countr_zero(static_cast<unsigned>(radix));
+			size_t dot = str.find('.');
+			std::string digits(str.substr(2, dot == std::string_view::npos ? std::string_view::npos : dot - 2));
+			std::uint64_t places = 0;
+			if (dot != std::string_view::npos) {
+				digits += str.substr(dot + 1);
+				places = str.size() - dot - 1;
+			}
+			return big_rational(big_integer::parse(digits, radix), big_integer(1) << places * width);
+		}
+
+		big_rational apply_exact(op_t op, const big_rational& a, const big_rational& b) {
+			switch (op) {
+			case op_t::add: return a + b;
+			case op_t::minus: return a - b;
+			case op_t::multiply: return a * b;
+			case op_t::divide: return a / b;
+			case op_t::modulo: return a % b;
+			case op_t::posite: return a;
+			case op_t::negate: return -a;
+			case op_t::exponent:
+				if (!b.is_integer()) {
+					throw std::runtime_error("ȷģʽ ^ ָΪ");
+				}
+				return big_rational::power(a, b.numerator());
+			case op_t::factorial: {
+				auto n = a.is_integer() ? a.numerator().to_int64() : std::nullopt;
+				if (!n || *n < 0) {
+					throw std::runtime_error("ȷģʽ ! ĲΪǸ");
+				}
+				return big_integer::factorial(static_cast<std::uint64_t>(*n));
+			}
+			default:
+				throw std::runtime_error("ȷģʽ֧ " + std::string(operator_info(op).symbol));
+			}
+		}
+	}
+
+	//  expression  Pratt ṹֻͬ﷨ѾУ
+	// ɲκθдĺ׺ָԭתΪ
+	class exact_expression::parser {
+		std::string_view m_source;
+		expression_lexer m_lexer;
+		std::optional<lexeme> m_current;
+		exact_expression& m_target;
+	public:
+		parser(std::string_view source, exact_expression& target) :m_source(source), m_lexer(source), m_target(target) {}
+		void parse() {
+			advance();
+			parse_expression(0);
+		}
+	private:
+		void advance() {
+			m_current = m_lexer.next();
+		}
+		std::string_view text() const {
+			return m_current ? m_source.substr(m_current->offset, m_current->length) : std::string_view();
+		}
+		void emit(step::kind_t kind, op_t op, size_t operand = 0) {
+			m_target.m_code.push_back({ op, static_cast<std::uint32_t>(operand), kind });
+		}
+		void parse_prefix() {
+			token_t type = m_current->type;
+			std::string_view str = text();
+			if (type == token_t::variable_number) {
+				auto it = std::find(m_target.m_variables.begin(), m_target.m_variables.end(), str);
+				emit(step::variable, op_t::add, it - m_target.m_variables.begin());
+				advance();
+			}
+			else if (token_t::number_token & type) {
+				m_target.m_literals.push_back(literal_value(str, type));
+				emit(step::literal, op_t::add, m_target.m_literals.size() - 1);
+				advance();
+			}
+			else if (str == "(") {
+				advance();
+				parse_expression(0);
+				advance();
+			}
+			else if (str == "+" || str == "-") {
+				op_t sign = str == "+" ? op_t::posite : op_t::negate;
+				advance();
+				parse_expression(operator_info(sign).priority);
+				emit(step::apply, sign);
+			}
+			else {
+				throw std::runtime_error("ȷģʽֺ֧ " + std::string(str) + "һ㲻");
+			}
+		}
+		void parse_expression(byte min_priority) {
+			parse_prefix();
+			while (m_current && m_current->type == token_t::normal_operator) {
+				std::string_view str = text();
+				if (str == "(" || str == ")") {
+					break;
+				}
+				op_t op = token::try_parse_operator(str)->operator_id();
+				if (operator_info(op).priority <= min_priority) {
+					break;
+				}
+				advance();
+				if (operator_info(op).operand_num == 2) {
+					parse_expression(operator_info(op).priority);
+				}
+				emit(step::apply, op);
+			}
+		}
+	};
+
+	exact_expression::exact_expression(const std::string& infix_expression) {
+		// Ȱ expression ﷨飬ʱ쳣ֵͨȫͬ
+		m_variables = expression(infix_expression).variables();
+		parser(infix_expression, *this).parse();
+	}
+
+	big_rational exact_expression::evaluate(std::span<const big_rational> slots) const {
+		if (slots.size() < m_variables.size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		std::vector<big_rational> stack;
+		for (const step& s : m_code) {
+			if (s.kind == step::literal) {
+				stack.push_back(m_literals[s.operand]);
+			}
+			else if (s.kind == step::variable) {
+				stack.push_back(slots[s.operand]);
+			}
+			else if (operator_info(s.op).operand_num == 1) {
+				stack.back() = apply_exact(s.op, stack.back(), big_rational());
+			}
+			else {
+				big_rational b = std::move(stack.back());
+				stack.pop_back();
+				stack.back() = apply_exact(s.op, stack.back(), b);
+			}
+		}
+		return std::move(stack.back());
+	}
+
+	big_rational exact_expression::parse_literal(std::string_view text) {
+		while (!text.empty() && std::isspace(static_cast<unsigned char>(text.front()))) {
+			text.remove_prefix(1);
+		}
+		while (!text.empty() && std::isspace(static_cast<unsigned char>(text.back()))) {
+			text.remove_suffix(1);
+		}
+		bool negative = !text.empty() && text.front() == '-';
+		if (!text.empty() && (text.front() == '-' || text.front() == '+')) {
+			text.remove_prefix(1);
+		}
+		token_t type = token_t::invalid_token;
+		if (text.empty() || expression_lexer::match(text, 0, type) != text.size()
+			|| !(token_t::number_token & type) || type == token_t::variable_number) {
+			throw std::runtime_error("޷ֵ" + std::string(text));
+		}
+		big_rational value = literal_value(text, type);
+		return negative ? -value : value;
+	}
+}
@@ -0,0 +1,111 @@
+#ifndef BIG_NUMBER_HPP
+#define BIG_NUMBER_HPP
+
+#include "calculator.hpp"
+
+#include <compare>
+
+namespace chr {
+
+	// ȷλޣԼ 1.6 λʮ֣ʱ׳쳣 2^(10^12) ֮ľڴ
+	constexpr std::uint64_t big_bit_limit = std::uint64_t(1) << 29;
+
+	// ⾫ + 32 λεľֵС߶η㣬ûκζΣ
+	// ˷ֵʱ Karatsuban! ֵĶֳ˻÷ƽ
+	class big_integer {
+		std::vector<std::uint32_t> m_limbs;
+		bool m_negative;
+	private:
+		big_integer(std::vector<std::uint32_t> limbs, bool negative);
+		void trim();
+	public:
+		big_integer() :m_negative(false) {}
+		big_integer(std::int64_t value);
+		// digits Ϊǰ׺ŵִradix Ϊ 2/8/10/16Ƿʱ׳쳣
+		static big_integer parse(std::string_view digits, int radix);
+		static big_integer factorial(std::uint64_t n);
+		static big_integer power(const big_integer& base, std::uint64_t exponent);
+		bool is_zero() const { return m_limbs.empty(); }
+		bool is_negative() const { return m_negative; }
+		bool is_odd() const { return !m_limbs.empty() && (m_limbs[0] & 1); }
+		std::uint64_t bits() const; // ֵĶλΪ 0
+		std::span<const std::uint32_t> limbs() const { return m_limbs; }
+		//  int64 ʾʱֵ
+		std::optional<std::int64_t> to_int64() const;
+		double to_double() const; // ȷ룬ΧʱΪ inf
+		// 2/8/16  0b/0o/0x ǰ׺﷨һ£Ϊ룩10 ǰ׺
+		std::string to_string(int radix = 10) const;
+		big_integer operator-() const;
+		big_integer abs() const;
+		friend big_integer operator+(const big_integer& a, const big_integer& b);
+		friend big_integer operator-(const big_integer& a, const big_integer& b);
+		friend big_integer operator*(const big_integer& a, const big_integer& b);
+		big_integer& operator+=(const big_integer& other) { return *this = *this + other; }
+		big_integer& operator-=(const big_integer& other) { return *this = *this - other; }
+		big_integer& operator*=(const big_integer& other) { return *this = *this * other; }
+		big_integer operator<<(std::uint64_t shift) const;
+		big_integer operator>>(std::uint64_t shift) const; // Ծֵƣضϣ
+		// ضϳquotient ȡremainder 뱻ͬţΪʱ׳쳣
+		static void divide(const big_integer& a, const big_integer& b, big_integer& quotient, big_integer& remainder);
+		static big_integer gcd(big_integer a, big_integer b); // Ǹ
+		friend bool operator==(const big_integer& a, const big_integer& b) = default;
+		friend std::strong_ordering operator<=>(const big_integer& a, const big_integer& b);
+	};
+
+	// ĸΪӻأ֮㲻Լֻ֣гʱԼ
+	class big_rational {
+		big_integer m_numerator;
+		big_integer m_denominator;
+	private:
+		void normalize();
+	public:
+		big_rational() :m_denominator(1) {}
+		big_rational(big_integer value) :m_numerator(std::move(value)), m_denominator(1) {}
+		big_rational(std::int64_t value) :m_numerator(value), m_denominator(1) {}
+		// ĸΪʱ׳쳣
+		big_rational(big_integer numerator, big_integer denominator);
+		const big_integer& numerator() const { return m_numerator; }
+		const big_integer& denominator() const { return m_denominator; }
+		bool is_integer() const { return m_denominator == big_integer(1); }
+		bool is_zero() const { return m_numerator.is_zero(); }
+		bool is_negative() const { return m_numerator.is_negative(); }
+		double to_double() const;
+		// ĸֻӵʽ 0x1.812.375Ϊ "/ĸ"
+		std::string to_string(int radix = 10) const;
+		big_rational operator-() const { return big_rational(-m_numerator, m_denominator, 0); }
+		friend big_rational operator+(const big_rational& a, const big_rational& b);
+		friend big_rational operator-(const big_rational& a, const big_rational& b);
+		friend big_rational operator*(const big_rational& a, const big_rational& b);
+		friend big_rational operator/(const big_rational& a, const big_rational& b);
+		//  fmod ͬ壺a - trunc(a/b)b뱻ͬ
+		friend big_rational operator%(const big_rational& a, const big_rational& b);
+		friend bool operator==(const big_rational& a, const big_rational& b) = default;
+		static big_rational power(const big_rational& base, const big_integer& exponent);
+	private:
+		// ѾԼֹķӷĸֱʹ
+		big_rational(big_integer numerator, big_integer denominator, int) :m_numerator(std::move(numerator)), m_denominator(std::move(denominator)) {}
+	};
+
+	// ȷֵ﷨ expression ͬԭʼıõȷ0.1  1/10 2^53 ʧλ
+	// κθ۵֧ + - * / % ^ ! ţ^ ָΪ! ĲΪǸ
+	// PIEPHIѧĽʱ׳쳣֧Զ庯
+	class exact_expression {
+		struct step {
+			op_t op;               // ѹջָʱ
+			std::uint32_t operand; // ±λ
+			enum kind_t : byte { literal, variable, apply } kind;
+		};
+		std::vector<step> m_code;
+		std::vector<big_rational> m_literals;
+		std::vector<std::string> m_variables;
+		class parser;
+	public:
+		explicit exact_expression(const std::string& infix_expression);
+		const std::vector<std::string>& variables() const { return m_variables; }
+		big_rational evaluate(std::span<const big_rational> slots = {}) const;
+		// ɴţתΪȷֵ "-0x1.8""2.5e-3"ֵ
+		static big_rational parse_literal(std::string_view text);
+	};
+}
+
+#endif // !BIG_NUMBER_HPP
@@ -0,0 +1,100 @@
+#include "bulk_evaluator.hpp"
+#include "thread_pool.hpp"
+
+#include <map>
+
+namespace chr {
+	namespace {
+		struct batch_result {
+			std::string output;
+			std::string errors;
+			size_t error_count = 0;
+		};
+
+		// һֱֵƴӳıдʱֻһ
+		batch_result evaluate_lines(const std::vector<std::string>& lines, size_t first_line, expression_cache& cache) {
+			batch_result result;
+			result.output.reserve(lines.size() * 16);
+			for (size_t i = 0; i < lines.size(); i++) {
+				const std::string& line = lines[i];
+				if (line.find_first_not_of(" \t\r") != std::string::npos) {
+					try {
+						char buffer[32];
+						auto [end, ec] = std::to_chars(buffer, buffer + sizeof(buffer), cache.get(line)->evaluate());
+						result.output.append(buffer, end);
+					}
+					catch (const std::exception& e) {
+						// ϢܺлУϸϣѹһԱ֤һռһ
+						std::string message = e.what();
+						std::replace(message.begin(), message.end(), '\n', ' ');
+						result.errors += std::to_string(first_line + i) + "" + message + '\n';
+						result.error_count++;
+					}
+				}
+				result.output += '\n';
+			}
+			return result;
+		}
+	}
+
+	bulk_summary evaluate_bulk(std::istream& in, std::ostream& out, std::ostream& errors, const bulk_options& options) {
+		// ͬ״̬뻺Ҫ̳߳ػþã̳߳ʱȴ
+		std::mutex mutex;
+		std::condition_variable ready;
+		std::map<size_t, batch_result> finished; // Ż壺ɵδֵдĿ
+		expression_cache cache(options.cache_capacity, options.functions);
+		thread_pool pool(options.threads);
+		const size_t batch_lines = std::max<size_t>(options.batch_lines, 1);
+		const size_t max_inflight = options.max_inflight != 0 ? options.max_inflight : pool.size() * 4;
+		size_t submitted = 0, written = 0;
+		bulk_summary summary{ 0, 0 };
+
+		// дѾĿ飻wait Ϊʱٵȵһ
+		auto flush = [&](bool wait) {
+			std::unique_lock<std::mutex> lock(mutex);
+			if (wait) {
+				ready.wait(lock, [&] { return finished.count(written) != 0; });
+			}
+			for (auto it = finished.find(written); it != finished.end(); it = finished.find(written)) {
+				batch_result result = std::move(it->second);
+				finished.erase(it);
+				lock.unlock();
+				out << result.output;
+				errors << result.errors;
+				summary.errors += result.error_count;
+				lock.lock();
+				written++;
+			}
+		};
+
+		std::string line;
+		while (in) {
+			auto lines = std::make_shared<std::vector<std::string>>();
+			lines->reserve(batch_lines);
+			while (lines->size() < batch_lines && std::getline(in, line)) {
+				lines->push_back(std::move(line));
+			}
+			if (lines->empty()) {
+				break;
+			}
+			size_t sequence = submitted++;
+			size_t first_line = summary.lines + 1;
+			summary.lines += lines->size();
+			pool.submit([&, lines, sequence, first_line] {
+				batch_result result = evaluate_lines(*lines, first_line, cache);
+				std::lock_guard<std::mutex> lock(mutex);
+				finished.emplace(sequence, std::move(result));
+				ready.notify_one();
+			});
+			flush(false);
+			while (submitted - written >= max_inflight) {
+				flush(true);
+			}
+		}
+		while (written < submitted) {
+			flush(true);
+		}
+		out.flush();
+		return summary;
+	}
+}
@@ -0,0 +1,27 @@
+#ifndef BULK_EVALUATOR_HPP
+#define BULK_EVALUATOR_HPP
+
+#include "expression_cache.hpp"
+
+namespace chr {
+
+	// ֵ
+	struct bulk_options {
+		size_t threads = 0;            // ߳0 ʾȡӲ
+		size_t batch_lines = 4096;     // ÿ
+		size_t max_inflight = 0;       // ͬʱ;ޣڴ棩0 ʾ߳ 4 
+		size_t cache_capacity = 4096;  // ظֵıʽֻһΣ
+		const function_table* functions = nullptr; // ɵõԶ庯ֵڼҲ޸
+	};
+
+	struct bulk_summary {
+		size_t lines;
+		size_t errors;
+	};
+
+	// ֵÿһʽַ̳߳ؽֵŻ尴˳д
+	// out ÿжӦһндУerrors ÿдһ "кţϢ"
+	bulk_summary evaluate_bulk(std::istream& in, std::ostream& out, std::ostream& errors, const bulk_options& options = {});
+}
+
+#endif // !BULK_EVALUATOR_HPP
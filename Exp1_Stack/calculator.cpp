@@ -2,26 +2,138 @@
 
 namespace chr {
 	namespace {
-		// ʽģʽ
-		// ƣ0b1010  0b11.01С㣩
-		const std::string binary_pattern = R"((0b[01]+(\.[01]*)?))";
-		// ˽ƣ0o755  0o7.3
-		const std::string octal_pattern = R"((0o[0-7]+(\.[0-7]*)?))";
-		// ʮƣ0x1A3F  0x1A.F
-		const std::string hexadecimal_pattern = R"((0x[0-9A-Fa-f]+(\.[0-9A-Fa-f]*)?))";
-		// ʮƣСѧ
-		const std::string decimal_pattern = R"(((\d+\.?\d*|\.\d+)([eE][-+]?\d+)?))";
-		// ֵ֧ĳ
-		const std::string constant_pattern = R"(PI|E|PHI)";
-		// ͨ׳ˡȡȵַ
-		const std::string normal_pattern = R"([+\-*/^()!%])";
-		// ڲʹõһԪpos/neg
-		const std::string signal_pattern = R"(pos|neg)";
-		// ֵ֧ĺбƥ䵥ʣ
-		const std::string function_pattern =
-			R"(sin|cos|tan|cot|sec|csc|)"
-			R"(arcsin|arccos|arctan|arccot|arcsec|arccsc|)"
-			R"(ln|lg|deg|rad|sqrt|cbrt)";
+		// ַλ룩ڱĴʷ
+		enum char_class : byte {
+			class_binary = 0x01,      // 0-1
+			class_octal = 0x02,       // 0-7
+			class_decimal = 0x04,     // 0-9
+			class_hexadecimal = 0x08, // 0-9 A-F a-f
+			class_operator = 0x10,    // ͨ׳ˡȡȵַ
+			class_space = 0x20,       // հף isspace  C һ£
+			class_word_head = 0x40,   // ʶַ A-Z a-z _
+			class_word = 0x80         // ʶַ A-Z a-z 0-9 _
+		};
+
+		constexpr std::array<byte, 256> make_char_table() {
+			std::array<byte, 256> table{};
+			for (int c = '0'; c <= '9'; c++) {
+				table[c] |= class_decimal | class_hexadecimal;
+				if (c <= '7') {
+					table[c] |= class_octal;
+				}
+				if (c <= '1') {
+					table[c] |= class_binary;
+				}
+			}
+			for (int c = 'A'; c <= 'F'; c++) {
+				table[c] |= class_hexadecimal;
+				table[c + 'a' - 'A'] |= class_hexadecimal;
+			}
+			for (int c = 'A'; c <= 'Z'; c++) {
+				table[c] |= class_word_head | class_word;
+				table[c + 'a' - 'A'] |= class_word_head | class_word;
+			}
+			for (int c = '0'; c <= '9'; c++) {
+				table[c] |= class_word;
+			}
+			table['_'] |= class_word_head | class_word;
+			for (char c : std::string_view("+-*/^()!%,")) {
+				table[static_cast<byte>(c)] |= class_operator;
+			}
+			for (char c : std::string_view(" \t\n\v\f\r")) {
+				table[static_cast<byte>(c)] |= class_space;
+			}
+			return table;
+		}
+		constexpr std::array<byte, 256> char_table = make_char_table();
+
+		inline bool char_is(char c, byte cls) noexcept {
+			return char_table[static_cast<byte>(c)] & cls;
+		}
+
+		// ؼֱ뺯ʶȫͬΪؼ֣
+		// ʶƥȡPIEE2sinx Ǳ PIEE2sin(x)
+		// ֵĽǰ׺ 0b0x  0  bx֤
+		struct keyword {
+			std::string_view text;
+			token_t type;
+		};
+		constexpr keyword keywords[] = {
+			{ "PI", token_t::constant_number }, { "E", token_t::constant_number }, { "PHI", token_t::constant_number },
+			{ "sin", token_t::function_operator }, { "cos", token_t::function_operator },
+			{ "tan", token_t::function_operator }, { "cot", token_t::function_operator },
+			{ "sec", token_t::function_operator }, { "csc", token_t::function_operator },
+			{ "arcsin", token_t::function_operator }, { "arccos", token_t::function_operator },
+			{ "arctan", token_t::function_operator }, { "arccot", token_t::function_operator },
+			{ "arcsec", token_t::function_operator }, { "arccsc", token_t::function_operator },
+			{ "ln", token_t::function_operator }, { "lg", token_t::function_operator },
+			{ "deg", token_t::function_operator }, { "rad", token_t::function_operator },
+			{ "sqrt", token_t::function_operator }, { "cbrt", token_t::function_operator },
+		};
+
+		// ǰ׺Ľ0b1010 / 0o7.3 / 0x1A.FһλС㣩
+		size_t match_radix(std::string_view src, size_t pos, char prefix, byte digit_class) noexcept {
+			if (pos + 2 >= src.size() || src[pos] != '0' || src[pos + 1] != prefix || !char_is(src[pos + 2], digit_class)) {
+				return 0;
+			}
+			size_t end = pos + 3;
+			while (end < src.size() && char_is(src[end], digit_class)) {
+				end++;
+			}
+			if (end < src.size() && src[end] == '.') {
+				end++;
+				while (end < src.size() && char_is(src[end], digit_class)) {
+					end++;
+				}
+			}
+			return end - pos;
+		}
+		// һλֵֵ0-9A-Fa-f
+		inline int digit_value(char t) noexcept {
+			return t <= '9' ? t - '0' : t <= 'Z' ? t - 'A' + 10 : t - 'a' + 10;
+		}
+
+		// ʮ1 / 1. / 1.5 / .5ɴĿѧָ
+		size_t match_decimal(std::string_view src, size_t pos) noexcept {
+			size_t end = pos;
+			auto skip_digits = [&]() {
+				while (end < src.size() && char_is(src[end], class_decimal)) {
+					end++;
+				}
+			};
+			if (char_is(src[end], class_decimal)) {
+				skip_digits();
+				if (end < src.size() && src[end] == '.') {
+					end++;
+					skip_digits();
+				}
+			}
+			else if (src[end] == '.' && end + 1 < src.size() && char_is(src[end + 1], class_decimal)) {
+				end++;
+				skip_digits();
+			}
+			else {
+				return 0;
+			}
+			// ֲָ "1e""1e+"ʱ
+			if (end < src.size() && (src[end] == 'e' || src[end] == 'E')) {
+				size_t exp = end + 1;
+				if (exp < src.size() && (src[exp] == '+' || src[exp] == '-')) {
+					exp++;
+				}
+				if (exp < src.size() && char_is(src[exp], class_decimal)) {
+					end = exp;
+					skip_digits();
+				}
+			}
+			return end - pos;
+		}
+
+		// жַǷΪĳһ͵ڸʽ飩
+		bool is_whole(const std::string& str, token_t type) noexcept {
+			token_t matched;
+			return !str.empty() && expression_lexer::match(str, 0, matched) == str.size() && matched == type;
+		}
 	}
 
 	// λж token_t İλʵ֣ is_number / is_operator ȣ
@@ -30,216 +142,271 @@ namespace chr {
 		return static_cast<byte>(a) & static_cast<byte>(b);
 	}
 
-	// ַж token ͣʹȼƥ䣩
-	token_t token_type(const std::string& str) noexcept {
-		if (std::regex_match(str, std::regex(binary_pattern))) {
-			return token_t::binary_number;
+	// ȼγԸ tokenơ˽ơʮơʮơǱʶ
+	size_t expression_lexer::match(std::string_view source, size_t pos, token_t& type) noexcept {
+		if (pos >= source.size()) {
+			return 0;
+		}
+		if (size_t len = match_radix(source, pos, 'b', class_binary)) {
+			type = token_t::binary_number;
+			return len;
+		}
+		if (size_t len = match_radix(source, pos, 'o', class_octal)) {
+			type = token_t::octal_number;
+			return len;
 		}
-		else if (std::regex_match(str, std::regex(octal_pattern))) {
-			return token_t::octal_number;
+		if (size_t len = match_radix(source, pos, 'x', class_hexadecimal)) {
+			type = token_t::hexadecimal_number;
+			return len;
 		}
-		else if (std::regex_match(str, std::regex(hexadecimal_pattern))) {
-			return token_t::hexadecimal_number;
+		if (size_t len = match_decimal(source, pos)) {
+			type = token_t::decimal_number;
+			return len;
 		}
-		else if (std::regex_match(str, std::regex(decimal_pattern))) {
-			return token_t::decimal_number;
+		if (char_is(source[pos], class_operator)) {
+			type = token_t::normal_operator;
+			return 1;
+		}
+		if (char_is(source[pos], class_word_head)) {
+			size_t end = pos + 1;
+			while (end < source.size() && char_is(source[end], class_word)) {
+				end++;
+			}
+			std::string_view word = source.substr(pos, end - pos);
+			type = token_t::variable_number;
+			for (const auto& kw : keywords) {
+				if (word == kw.text) {
+					type = kw.type;
+					break;
+				}
+			}
+			return word.size();
 		}
-		else if (std::regex_match(str, std::regex(normal_pattern))) {
-			return token_t::normal_operator;
+		return 0;
+	}
+
+	// ɨ裺ȫհ׵ļ϶ǿհ׵δƥƬΪһ invalid_token 
+	std::optional<lexeme> expression_lexer::next() noexcept {
+		size_t start = m_pos;
+		bool blank = true;
+		token_t type = token_t::invalid_token;
+		size_t len = 0;
+		while (m_pos < m_source.size() && (len = match(m_source, m_pos, type)) == 0) {
+			blank = blank && char_is(m_source[m_pos], class_space);
+			m_pos++;
 		}
-		else if (std::regex_match(str, std::regex(constant_pattern))) {
-			return token_t::constant_number;
+		if (!blank) {
+			return lexeme{ token_t::invalid_token, start, m_pos - start };
 		}
-		else if (std::regex_match(str, std::regex(function_pattern))) {
-			return token_t::function_operator;
+		if (m_pos >= m_source.size()) {
+			return std::nullopt;
 		}
-		else if (std::regex_match(str, std::regex(signal_pattern))) {
+		lexeme lex{ type, m_pos, len };
+		m_pos += len;
+		return lex;
+	}
+
+	// ַж token ͣڲ pos/neg ԴУжϣ
+	token_t token_type(const std::string& str) noexcept {
+		if (str == "pos" || str == "neg") {
 			return token_t::signal_operator;
 		}
+		token_t type;
+		if (!str.empty() && expression_lexer::match(str, 0, type) == str.size()) {
+			return type;
+		}
 		return token_t::invalid_token;
 	}
 
-	// ִʣʹƥ֪ token ģʽͬʱδַ֪Ϊ
+	// ִʣȡʷԪͬʱ¼Դƫƣδ֪ƬμΪ
+	// һԪ + / - ͬһаǰһ token ʶΪڲ pos/neg֤
 	bool expression_tokenizer::tokenize(const std::string& expression) {
 		m_tokens.clear();
+		m_lexemes.clear();
 		m_errors.clear();
-		std::regex pattern(binary_pattern + "|" + octal_pattern + "|" + hexadecimal_pattern + "|" +
-			decimal_pattern + "|" + constant_pattern + "|" + normal_pattern + "|" + function_pattern);
-		size_t pos = 0;
-		auto words_begin = std::sregex_iterator(expression.begin(), expression.end(), pattern);
-		auto words_end = std::sregex_iterator();
-		for (auto& it = words_begin; it != words_end; it++) {
-			std::smatch match = *it;
-			std::string token = match.str();
-			size_t token_pos = match.position();
-			// ȫǿհ׵ƥ䣨Ȼͨƥհף
-			if (std::all_of(token.begin(), token.end(), isspace)) {
+		expression_lexer lexer(expression);
+		while (auto lex = lexer.next()) {
+			std::string text = expression.substr(lex->offset, lex->length);
+			if (lex->type == token_t::invalid_token) {
+				if (lex->offset + lex->length == expression.length()) {
+					add_error(text, "ʽĩβ޷ʶַ");
+				}
+				else {
+					add_error(text, "޷ʶַ");
+				}
 				continue;
 			}
-			// ǰƥ֮ǰδƥݣΪδַ֪
-			if (token_pos > pos) {
-				std::string unknown = expression.substr(pos, token_pos - pos);
-				if (!std::all_of(unknown.begin(), unknown.end(), isspace)) {
-					m_errors.push_back({ unknown,"޷ʶַ" });
-				}
+			// ʽͷǰһ׳˳⣩ʱ+ / - ΪһԪ
+			if ((text == "+" || text == "-") && (m_tokens.empty()
+				|| ((token_t::operator_token & m_lexemes.back().type) && m_tokens.back() != ")" && m_tokens.back() != "!"))) {
+				text = text == "+" ? "pos" : "neg";
+				lex->type = token_t::signal_operator;
 			}
-			m_tokens.push_back(token);
-			pos = token_pos + token.length();
+			m_tokens.push_back(std::move(text));
+			m_lexemes.push_back(*lex);
 		}
-		// ĩβǷʣ޷ʶ
-		if (pos < expression.length()) {
-			std::string remaining = expression.substr(pos);
-			if (!std::all_of(remaining.begin(), remaining.end(), isspace)) {
-				m_errors.push_back({ remaining, "ʽĩβ޷ʶַ" });
-			}
-		}
-		// һԪ + / - Ϊڲ pos/neg֤
-		parse_signal_operators();
 		return m_errors.empty();
 	}
 
-	// ֤ȷִʣ﷨
+	// ֤ȷִʣһɨȫ﷨
 	bool expression_tokenizer::validate(const std::string& expression) {
 		if (!tokenize(expression)) {
 			return 0;
 		}
-		parse_parenthese();         // Լ
-		parse_operator_sequence();  // ˳ϷԼ
-		parse_number_format();      // ʽ
-		parse_function_usage();     // ʽ飨 '('
+		check_sequence();
 		return m_errors.empty();
 	}
 
-	// ΪԪ + - ںλʶΪһԪ pos/neg
-	void expression_tokenizer::parse_signal_operators() {
-		std::vector<std::string> processed_tokens;
-		for (size_t i = 0; i < m_tokens.size(); ++i) {
-			const std::string& token = m_tokens[i];
-			if (token == "+" || token == "-") {
-				// Ǳʽͷǰһ(Ҳ׳)ΪһԪ
-				if (i == 0 || (i > 0 && (is_operator(m_tokens[i - 1]) && m_tokens[i - 1] != ")"
-					&& m_tokens[i - 1] != "!") || is_function(m_tokens[i - 1]))) {
-					processed_tokens.push_back(token == "+" ? "pos" : "neg");
-				}
-				else {
-					processed_tokens.push_back(token);
-				}
-			}
-			else {
-				processed_tokens.push_back(token);
-			}
-		}
-		m_tokens = processed_tokens;
-	}
+	namespace {
+		// ֤״̬ token ǰһ token 𼴵ǰ״̬
+		enum token_class : byte {
+			start_class,    // ʽͷ״̬
+			literal_class,  // 
+			operand_class,  // 
+			sign_class,     // һԪ pos/neg
+			binary_class,   // Ԫ
+			factorial_class,
+			left_class,
+			right_class,
+			function_class,
+			class_count
+		};
 
-	// ƥ䣬¼Ĵλ
-	void expression_tokenizer::parse_parenthese() {
-		std::stack<std::pair<std::string, size_t>>paren_stack;
-		for (size_t i = 0; i < m_tokens.size(); i++) {
-			const auto& token = m_tokens[i];
-			if (token == "(") {
-				paren_stack.push({ token,i });
+		// ״̬תϼ⵽ĴĽһԭȸ˳
+		enum sequence_error : byte {
+			no_error,
+			consecutive_signs,
+			factorial_at_start,
+			factorial_operand,
+			binary_at_start,
+			consecutive_binary,
+			consecutive_numbers,
+			consecutive_operands,
+		};
+
+		constexpr std::string_view sequence_error_text[] = {
+			"",
+			"ʽ",
+			"ʽԽ׳ͷ",
+			"׳ǰ֡ʽ",
+			"ʽԶԪͷ",
+			"ʽԪ",
+			"ʽ",
+			"ʽ",
+		};
+
+		// תƱtransition_table[״̬][ǰ] ΪתϵĴ
+		constexpr auto make_transition_table() {
+			std::array<std::array<sequence_error, class_count>, class_count> table{};
+			for (byte state = 0; state < class_count; state++) {
+				bool operand_before = state == literal_class || state == operand_class || state == right_class;
+				// ׳ǰֻǲд 3!! static_expr ܾͬд (3!)!
+				table[state][factorial_class] = state == start_class ? factorial_at_start
+					: operand_before ? no_error : factorial_operand;
+				table[state][binary_class] = state == start_class ? binary_at_start
+					: state == sign_class ? consecutive_binary : no_error;
 			}
-			else if (token == ")") {
-				if (paren_stack.empty()) {
-					add_error(std::to_string(i), "ڶ");
-				}
-				else {
-					paren_stack.pop();
+			// ׳˽֧֮ʡԳ˺ţ2x2(3)(2)3
+			for (byte state : { literal_class, operand_class, right_class, factorial_class }) {
+				for (byte current : { literal_class, operand_class, left_class, function_class }) {
+					table[state][current] = consecutive_operands;
 				}
 			}
+			// ʶԶ庯ã֤֪
+			table[operand_class][left_class] = no_error;
+			table[sign_class][sign_class] = consecutive_signs;
+			table[literal_class][literal_class] = consecutive_numbers;
+			table[operand_class][literal_class] = consecutive_numbers;
+			return table;
 		}
-		// ʣΪ
-		while (!paren_stack.empty()) {
-			add_error(std::to_string(paren_stack.top().second), "ڶ");
-			paren_stack.pop();
-		}
-	}
+		constexpr auto transition_table = make_transition_table();
 
-	// еĺϷԣ / ʼβȣ
-	void expression_tokenizer::parse_operator_sequence() {
-		for (size_t i = 0; i < m_tokens.size(); ++i) {
-			const std::string& token = m_tokens[i];
-			// һԪţpos/negܳڱʽĩβҲ
-			if (token_type(token) == token_t::signal_operator) {
-				if (i == m_tokens.size() - 1) {
-					add_error(std::to_string(i), "ʽβ");
-				}
-				else {
-					if (i != 0 && token_type(m_tokens[i - 1]) == token_t::signal_operator) {
-						add_error(std::to_string(i), "ʽ");
-					}
-				}
-			}
-			// ׳˱/
-			else if (token == "!") {
-				if (i == 0) {
-					add_error(std::to_string(i), "ʽԽ׳ͷ");
-				}
-				else {
-					const std::string& prev = m_tokens[i - 1];
-					if (!(is_number(prev) || prev == ")")) {
-						add_error(std::to_string(i), "׳ǰ֡ʽ");
-					}
-				}
-			}
-			// ͨԪʼ/βԪ
-			else if (token != "(" && token != ")" && token_type(token) == token_t::normal_operator) {
-				if (i == 0) {
-					add_error(std::to_string(i), "ʽԶԪͷ");
-				}
-				else if (i == m_tokens.size() - 1) {
-					add_error(std::to_string(i), "ʽβ");
-				}
-				else if (token_type(m_tokens[i - 1]) == token_t::signal_operator) {
-					add_error(std::to_string(i), "ʽԪ");
-				}
+		token_class classify(const lexeme& lex, std::string_view text) {
+			switch (lex.type) {
+			case token_t::constant_number:
+			case token_t::variable_number:
+				return operand_class;
+			case token_t::signal_operator:
+				return sign_class;
+			case token_t::function_operator:
+				return function_class;
+			case token_t::normal_operator:
+				return text == "(" ? left_class : text == ")" ? right_class : text == "!" ? factorial_class : binary_class;
+			default:
+				return literal_class;
 			}
 		}
 	}
 
-	// ʽ飺ơѧֵ
-	void expression_tokenizer::parse_number_format() {
+	// һɨ֤״̬ǰһ token Ϊ״̬תƱͬʱάջ
+	// ָʽ뺯ʽСָʽã
+	// Ϊʱ˳һ
+	void expression_tokenizer::check_sequence() {
+		std::array<std::vector<std::pair<std::string, std::string>>, 4> errors;
+		enum { parenthese_errors, sequence_errors, number_errors, function_errors };
+		std::vector<size_t> open_parentheses;
+		token_class state = start_class;
 		for (size_t i = 0; i < m_tokens.size(); i++) {
-			const auto& token = m_tokens[i];
-			// ԱʶΪҲǳ token иʽ
-			if (is_number(token) && !is_constant(token)) {
-				// һҲ -> ִ
-				if (i > 0 && is_number(m_tokens[i - 1])) {
-					add_error(m_tokens[i - 1] + token, "ʽ");
+			const std::string& text = m_tokens[i];
+			token_class current = classify(m_lexemes[i], text);
+			bool last = i + 1 == m_tokens.size();
+			sequence_error error = transition_table[state][current];
+			// һԪԪλĩβʱֻβԪλڿͷʱ⣩
+			if (last && (current == sign_class || (current == binary_class && error != binary_at_start))) {
+				errors[sequence_errors].push_back({ std::to_string(i), "ʽβ" });
+			}
+			else if (error == consecutive_numbers) {
+				errors[number_errors].push_back({ m_tokens[i - 1] + text, std::string(sequence_error_text[error]) });
+			}
+			else if (error != no_error) {
+				errors[sequence_errors].push_back({ std::to_string(i), std::string(sequence_error_text[error]) });
+			}
+			switch (current) {
+			case left_class:
+				open_parentheses.push_back(i);
+				break;
+			case right_class:
+				if (open_parentheses.empty()) {
+					errors[parenthese_errors].push_back({ std::to_string(i), "ڶ" });
 				}
 				else {
-					// ѧУ飺ȷ decimal_patternҲ 0x/0o/0b ǰ׺
-					if ((token.find('e') != std::string::npos || token.find('E') != std::string::npos) &&
-						!token.starts_with("0x") && !token.starts_with("0o") && !token.starts_with("0b")) {
-						if (!std::regex_match(token, std::regex(decimal_pattern))) {
-							add_error(token, "ѧʽ");
-						}
+					open_parentheses.pop_back();
+				}
+				break;
+			case literal_class:
+				if (error == no_error) {
+					// ѧʮƸʽ 0x/0o/0b ǰ׺ǰ׺İԽƼ
+					bool prefixed = text.starts_with("0x") || text.starts_with("0o") || text.starts_with("0b");
+					if (!prefixed && text.find_first_of("eE") != std::string::npos && !is_whole(text, token_t::decimal_number)) {
+						errors[number_errors].push_back({ text, "ѧʽ" });
 					}
-					// ʽУ
-					if (token.starts_with("0b") &&
-						!std::regex_match(token, std::regex(binary_pattern))) {
-						add_error(token, "Ƹʽ");
+					if (text.starts_with("0b") && !is_whole(text, token_t::binary_number)) {
+						errors[number_errors].push_back({ text, "Ƹʽ" });
 					}
-					else if (token.starts_with("0o") &&
-						!std::regex_match(token, std::regex(octal_pattern))) {
-						add_error(token, "˽Ƹʽ");
+					else if (text.starts_with("0o") && !is_whole(text, token_t::octal_number)) {
+						errors[number_errors].push_back({ text, "˽Ƹʽ" });
 					}
-					else if (token.starts_with("0x") &&
-						!std::regex_match(token, std::regex(hexadecimal_pattern))) {
-						add_error(token, "ʮƸʽ");
+					else if (text.starts_with("0x") && !is_whole(text, token_t::hexadecimal_number)) {
+						errors[number_errors].push_back({ text, "ʮƸʽ" });
 					}
 				}
+				break;
+			case function_class:
+				if (last || m_tokens[i + 1] != "(") {
+					errors[function_errors].push_back({ text, "δ" });
+				}
+				break;
+			default:
+				break;
 			}
+			state = current;
 		}
-	}
-
-	// ʹü飺 '('򱨴
-	void expression_tokenizer::parse_function_usage() {
-		for (size_t i = 0; i < m_tokens.size(); ++i) {
-			if (is_function(m_tokens[i]) && (i + 1 >= m_tokens.size() || m_tokens[i + 1] != "(")) {
-				add_error(m_tokens[i], "δ");
-			}
+		// ʣΪࣨ⣩
+		for (auto it = open_parentheses.rbegin(); it != open_parentheses.rend(); ++it) {
+			errors[parenthese_errors].push_back({ std::to_string(*it), "ڶ" });
+		}
+		for (auto& group : errors) {
+			m_errors.insert(m_errors.end(), std::make_move_iterator(group.begin()), std::make_move_iterator(group.end()));
 		}
 	}
 
@@ -251,8 +418,8 @@ namespace chr {
 	// ϸַгÿ token ֵ token ַг
 	std::string expression_tokenizer::detailed_analysis() const {
 		std::string str;
-		for (const auto& token : m_tokens) {
-			str += "" + std::to_string(static_cast<byte>(token_type(token))) + "" + token + "\n";
+		for (size_t i = 0; i < m_tokens.size(); i++) {
+			str += "" + std::to_string(static_cast<byte>(m_lexemes[i].type)) + "" + m_tokens[i] + "\n";
 		}
 		for (const auto& error : m_errors) {
 			str += "" + error.first + "" + error.second + "\n";
@@ -288,13 +455,31 @@ namespace chr {
 
 	// ԽַתΪֳֵ֧
 	inline std::optional<double> token::try_parse_number(const std::string& str) {
-		if (!chr::is_number(str)) {
+		token_t type = token_type(str);
+		if (!(token_t::number_token & type) || type == token_t::variable_number) {
 			return std::nullopt;
 		}
-		token_t type = token_type(str);
-		// ʮֱ stodֿ֧ѧ
+		return parse_number(str, type);
+	}
+
+	std::optional<double> fold_constant(op_t op, double a, double b) {
+		const double r = operator_info(op).apply(a, b);
+		// ȷΧĲѾ루2^60+1 ۵ 2^60õľȷ2^60+1-2^60  0
+		// ţһ㣬ҲͲᱻ int64 ȷֵ
+		const bool unary = operator_info(op).operand_num == 1;
+		if (is_exact_integer(r) && (std::abs(a) >= exact_integer_limit || (!unary && std::abs(b) >= exact_integer_limit))) {
+			return std::nullopt;
+		}
+		return r;
+	}
+
+	// ͽʮơ//ʮƣС֣
+	double token::parse_number(std::string_view str, token_t type) {
+		// ʮֱ from_charsֿ֧ѧ stod һ£
 		if (type == token_t::decimal_number) {
-			return std::stod(str);
+			double value = 0;
+			std::from_chars(str.data(), str.data() + str.size(), value);
+			return value;
 		}
 		// 滻Ϊֵ
 		else if (type == token_t::constant_number) {
@@ -315,8 +500,8 @@ namespace chr {
 		else {
 			double value = 0;
 			int radix = 10;
-			std::string integer;
-			std::string fraction;
+			std::string_view integer;
+			std::string_view fraction;
 			if (type == token_t::binary_number) {
 				radix = 2;
 			}
@@ -330,7 +515,7 @@ namespace chr {
 				throw std::runtime_error("Ч");
 			}
 			size_t dot_pos = str.find('.');
-			if (dot_pos == std::string::npos) {
+			if (dot_pos == std::string_view::npos) {
 				// ȥǰ׺0b/0o/0x
 				integer = str.substr(2);
 			}
@@ -338,145 +523,508 @@ namespace chr {
 				integer = str.substr(2, dot_pos - 2);
 				fraction = str.substr(dot_pos + 1);
 			}
-			// ֣ӵλλ
-			for (size_t i = 0; i < integer.length(); i++) {
-				char t = integer[integer.length() - i - 1];
-				value += pow(radix, i) * (t <= '9' ? t - '0' : t <= 'Z' ? t - 'A' + 10 : t - 'a' + 10);
+			// ƶ 2 ݣְλƴӵ 64 λУתΪ double ʱֻһΣ
+			//  64 λ double ۼӣԽǾȷģ
+			const int bits = radix == 2 ? 1 : radix == 8 ? 3 : 4;
+			std::uint64_t mantissa = 0;
+			bool wide = false;
+			for (char t : integer) {
+				if (!wide && mantissa >> (64 - bits) == 0) {
+					mantissa = mantissa << bits | digit_value(t);
+					continue;
+				}
+				if (!wide) {
+					value = static_cast<double>(mantissa);
+					wide = true;
+				}
+				value = value * radix + digit_value(t);
+			}
+			if (!wide) {
+				value = static_cast<double>(mantissa);
 			}
-			// С
-			for (size_t i = 0; i < fraction.length(); i++) {
-				char t = fraction[i];
-				value += pow(radix, -(int(i) + 1)) * (t <= '9' ? t - '0' : t <= 'Z' ? t - 'A' + 10 : t - 'a' + 10);
+			// С֣ÿһλȨض 2 ݣԾȷʾ
+			double weight = 1;
+			for (char t : fraction) {
+				weight /= radix;
+				value += weight * digit_value(t);
 			}
 			return value;
 		}
 	}
 
-	// ַӳΪ tokenͨ
-	std::optional<token> token::try_parse_operator(const std::string& str) {
-		static const std::unordered_map<std::string, token(*)(void)> operator_map = {
-			{"+", []() { return token::add(); }},
-			{"-", []() { return token::minus(); }},
-			{"*", []() { return token::multiply(); }},
-			{"/", []() { return token::divide(); }},
-			{"%", []() { return token::modulo(); }},
-			{"^", []() { return token::exponent(); }},
-			{"!", []() { return token::factorial(); }},
-			{"(", []() { return token::left_parentheses(); }},
-			{")", []() { return token::right_parentheses(); }},
-			{"sin", []() { return token::sine(); }},
-			{"cos", []() { return token::cosine(); }},
-			{"tan", []() { return token::tangent(); }},
-			{"cot", []() { return token::cotangent(); }},
-			{"sec", []() { return token::secant(); }},
-			{"csc", []() { return token::cosecant(); }},
-			{"arcsin", []() { return token::arcsine(); }},
-			{"arccos", []() { return token::arccosine(); }},
-			{"arctan", []() { return token::arctangent(); }},
-			{"arccot", []() { return token::arccotangent(); }},
-			{"arcsec", []() { return token::arcsecant(); }},
-			{"arccsc", []() { return token::arccosecant(); }},
-			{"lg", []() { return token::common_logarithm(); }},
-			{"ln", []() { return token::natural_logarithm(); }},
-			{"sqrt", []() { return token::square_root(); }},
-			{"cbrt", []() { return token::cubic_root(); }},
-			{"deg", []() { return token::degree(); }},
-			{"rad", []() { return token::radian(); }},
-		};
-		auto it = operator_map.find(str);
-		if (it != operator_map.end()) {
-			return it->second();
+	// ַӳΪ tokenаŲң
+	std::optional<token> token::try_parse_operator(std::string_view str) {
+		for (size_t i = 0; i < std::size(operator_table); i++) {
+			if (operator_table[i].symbol == str) {
+				return token(static_cast<op_t>(i));
+			}
 		}
 		return std::nullopt;
 	}
 
-	// ݲ operand_num ִӦĳջ㲢ѹ
-	void expression::calculate(std::stack<token>& operands, const token& op) const {
-		byte operand_num = op.operator_operand_num();
-		if (operand_num == 0) {
-			throw std::runtime_error("ʱ");
-		}
-		else if (operand_num == 1) {
-			// һԪ㣬ջȡһ
-			double a = operands.top().number_value();
-			operands.pop();
-			operands.push(token::from_number(op.apply_operator(a, 0)));
-		}
-		else if (operand_num == 2) {
-			// Ԫ㣬עջ˳ȵ bٵ a
-			double b = operands.top().number_value();
-			operands.pop();
-			double a = operands.top().number_value();
-			operands.pop();
-			operands.push(token::from_number(op.apply_operator(a, b)));
-		}
-		else {
-			throw std::runtime_error("ʱֲ");
+	namespace {
+		// ݲ operand_num ִӦĳջ㲢ѹأԭðĲջ
+		void calculate(fixed_stack<double>& operands, const token& op, const native_list& natives) {
+			byte operand_num = op.operator_operand_num();
+			if (op.operator_id() == op_t::call) {
+				const native_function& function = *natives[op.variable_slot()];
+				if (operands.size() < function.arity) {
+					throw std::runtime_error("ʱ " + function.name + " ȱٲ");
+				}
+				double* args = &operands.top() + 1 - function.arity;
+				double result = function.callback({ args, function.arity });
+				for (size_t i = 1; i < function.arity; i++) {
+					operands.pop();
+				}
+				operands.top() = result;
+			}
+			else if (operand_num == 0) {
+				throw std::runtime_error("ʱ");
+			}
+			else if (operands.size() < operand_num) {
+				throw std::runtime_error("ʱȱٲ");
+			}
+			else if (operand_num == 1) {
+				// һԪ㣬ֱ滻ջ
+				operands.top() = op.apply_operator(operands.top(), 0);
+			}
+			else if (operand_num == 2) {
+				// Ԫ㣬עջ˳ȵ bȡ a
+				double b = operands.top();
+				operands.pop();
+				operands.top() = op.apply_operator(operands.top(), b);
+			}
+			else {
+				throw std::runtime_error("ʱֲ");
+			}
 		}
 	}
 
-	// 캯֤ʽ -> ַ token תΪ token  -> ׺ת׺Shunting-yard
-	expression::expression(const std::string& infix_expression) {
-		expression_tokenizer tokenizer;
-		if (!tokenizer.validate(infix_expression)) {
-			throw std::runtime_error("ʽǷ\n" + tokenizer.detailed_analysis());
-		}
-		std::vector<std::string> strings = tokenizer.tokens();
-		for (const auto& str : strings) {
-			m_infix.push_back(token::from_string(str));
-		}
-		std::stack<token> ops;
-		for (const auto& tk : m_infix) {
-			token_t type = tk.type();
-			if (type == token_t::number_token) {
-				// ֱӼ׺ʽ
-				m_postfix.push_back(tk);
+	namespace {
+		// չ׺еĳޣֹǶסγֵĺѱʽָŴ
+		constexpr size_t max_inlined_size = size_t(1) << 24;
+
+		// PrattȼֱӴӴʷȡ tokenһ׺׺ token У
+		// ȼԭ Shunting-yard һ£ͬϣpos/neg  ^  !壩
+		class pratt_parser {
+			std::string_view m_source;
+			expression_lexer m_lexer;
+			std::optional<lexeme> m_current;
+			std::vector<token>& m_infix;
+			std::vector<token>& m_postfix;
+			std::vector<std::string>& m_variables;
+			native_list& m_natives;
+			optimization_report& m_report;
+			const function_table* m_functions;
+		public:
+			pratt_parser(std::string_view source, std::vector<token>& infix, std::vector<token>& postfix,
+				std::vector<std::string>& variables, native_list& natives, optimization_report& report, const function_table* functions)
+				:m_source(source), m_lexer(source), m_infix(infix), m_postfix(postfix), m_variables(variables),
+				m_natives(natives), m_report(report), m_functions(functions) {}
+			void parse() {
+				advance();
+				parse_expression(0);
+				if (m_current) {
+					fail("ڶ token");
+				}
 			}
-			else {
-				// ջ
-				if (tk.operator_symbol() == "(") {
-					ops.push(tk);
+		private:
+			[[noreturn]] void fail(const std::string& description) const {
+				size_t offset = m_current ? m_current->offset : m_source.size();
+				throw std::runtime_error("ʽǷ\n" + std::to_string(offset) + "" + description);
+			}
+			void advance() {
+				m_current = m_lexer.next();
+				if (m_current && m_current->type == token_t::invalid_token) {
+					fail("޷ʶַ");
 				}
-				// Ӧ
-				else if (tk.operator_symbol() == ")") {
-					while (!ops.empty()) {
-						if (ops.top().operator_symbol() == "(") {
-							ops.pop();
-							break;
+			}
+			std::string_view text() const {
+				return m_current ? m_source.substr(m_current->offset, m_current->length) : std::string_view();
+			}
+			token current_operator() const {
+				return *token::try_parse_operator(text());
+			}
+			// ȡ "( ʽ )"ͬ׺
+			void parse_group() {
+				if (text() != "(") {
+					fail("δ");
+				}
+				m_infix.push_back(token(op_t::left_parentheses));
+				advance();
+				parse_expression(0);
+				if (text() != ")") {
+					fail("ڶ");
+				}
+				m_infix.push_back(token(op_t::right_parentheses));
+				advance();
+			}
+			// Ϊλѳֹĸԭλ׷
+			token resolve_variable(std::string_view name) {
+				auto it = std::find(m_variables.begin(), m_variables.end(), name);
+				if (it == m_variables.end()) {
+					m_variables.emplace_back(name);
+					it = m_variables.end() - 1;
+				}
+				return token::from_variable(static_cast<std::uint32_t>(it - m_variables.begin()));
+			}
+			// ԭڱʽе±꣺ͬһֻռһ
+			std::uint32_t resolve_native(const std::shared_ptr<const native_function>& function) {
+				auto it = std::find(m_natives.begin(), m_natives.end(), function);
+				if (it == m_natives.end()) {
+					m_natives.push_back(function);
+					it = m_natives.end() - 1;
+				}
+				return static_cast<std::uint32_t>(it - m_natives.begin());
+			}
+			// Զ庯 "(ʵ, ...)"ԭ call token׺ʵ֮ comma 
+			// ɱʽĺʵδ뺯
+			void parse_call(const std::string& name, const function_table::definition& function) {
+				advance();
+				if (text() != "(") {
+					fail("δ");
+				}
+				size_t infix_start = m_infix.size();
+				size_t postfix_start = m_postfix.size();
+				if (function.native) {
+					m_infix.push_back(token::from_call(resolve_native(function.native)));
+				}
+				m_infix.push_back(token(op_t::left_parentheses));
+				advance();
+				std::vector<std::pair<size_t, size_t>> infix_arguments; // ʵ׺׺е
+				std::vector<std::pair<size_t, size_t>> postfix_arguments;
+				while (text() != ")") {
+					size_t infix_begin = m_infix.size();
+					size_t postfix_begin = m_postfix.size();
+					parse_expression(0);
+					infix_arguments.push_back({ infix_begin, m_infix.size() });
+					postfix_arguments.push_back({ postfix_begin, m_postfix.size() });
+					if (function.native && postfix_arguments.size() > 1) {
+						m_postfix.push_back(token(op_t::comma));
+					}
+					if (text() != ",") {
+						break;
+					}
+					m_infix.push_back(token(op_t::comma));
+					advance();
+				}
+				if (text() != ")") {
+					fail("ڶ");
+				}
+				if (postfix_arguments.size() != function.arity()) {
+					fail(" " + name + " Ҫ " + std::to_string(function.arity()) + " ");
+				}
+				m_infix.push_back(token(op_t::right_parentheses));
+				advance();
+				if (function.native) {
+					m_postfix.push_back(m_infix[infix_start]);
+					return;
+				}
+				auto copy_arguments = [](std::vector<token>& tokens, const std::vector<std::pair<size_t, size_t>>& ranges, size_t start) {
+					std::vector<std::vector<token>> values;
+					for (auto [begin, end] : ranges) {
+						values.emplace_back(tokens.begin() + begin, tokens.begin() + end);
+					}
+					tokens.resize(start);
+					return values;
+				};
+				inline_body(*function.body, function.parameters,
+					copy_arguments(m_infix, infix_arguments, infix_start), copy_arguments(m_postfix, postfix_arguments, postfix_start));
+			}
+			// 壺βδʵΣ׺иʵμţԭеĽϹϵ
+			// ԭΪôʽеĲλ±
+			void inline_body(const expression& body, const std::vector<std::string>& parameters,
+				const std::vector<std::vector<token>>& infix_values, const std::vector<std::vector<token>>& postfix_values) {
+				std::vector<std::optional<size_t>> parameter_of(body.variables().size());
+				std::vector<token> variables(body.variables().size());
+				for (size_t i = 0; i < body.variables().size(); i++) {
+					auto it = std::find(parameters.begin(), parameters.end(), body.variables()[i]);
+					if (it != parameters.end()) {
+						parameter_of[i] = it - parameters.begin();
+					}
+					else {
+						variables[i] = resolve_variable(body.variables()[i]);
+					}
+				}
+				auto substitute = [&](const std::vector<token>& source, const std::vector<std::vector<token>>& values, std::vector<token>& target, bool parenthesize) {
+					for (const auto& tk : source) {
+						if (tk.is_variable() && parameter_of[tk.variable_slot()]) {
+							const auto& value = values[*parameter_of[tk.variable_slot()]];
+							if (parenthesize) {
+								target.push_back(token(op_t::left_parentheses));
+							}
+							target.insert(target.end(), value.begin(), value.end());
+							if (parenthesize) {
+								target.push_back(token(op_t::right_parentheses));
+							}
+						}
+						else if (tk.is_variable()) {
+							target.push_back(variables[tk.variable_slot()]);
+						}
+						else if (tk.is_operator() && tk.operator_id() == op_t::call) {
+							target.push_back(token::from_call(resolve_native(body.natives()[tk.variable_slot()])));
 						}
 						else {
-							m_postfix.push_back(ops.top());
-							ops.pop();
+							target.push_back(tk);
+						}
+						if (target.size() > max_inlined_size) {
+							fail("չıʽ");
 						}
 					}
+				};
+				m_infix.push_back(token(op_t::left_parentheses));
+				substitute(body.infix(), infix_values, m_infix, true);
+				m_infix.push_back(token(op_t::right_parentheses));
+				substitute(body.postfix(), postfix_values, m_postfix, false);
+				m_report.inlined_calls++;
+			}
+			// ǰ׺λã//šһԪŻ
+			void parse_prefix() {
+				if (!m_current) {
+					fail("ʽβ");
+				}
+				token_t type = m_current->type;
+				std::string_view str = text();
+				const function_table::definition* function = type == token_t::variable_number && m_functions ? m_functions->find(str) : nullptr;
+				if (function) {
+					parse_call(std::string(str), *function);
+				}
+				else if (token_t::number_token & type) {
+					token tk = type == token_t::variable_number
+						? resolve_variable(str) : token::from_number(token::parse_number(str, type));
+					m_infix.push_back(tk);
+					m_postfix.push_back(tk);
+					advance();
+				}
+				else if (str == "(") {
+					parse_group();
+				}
+				else if (str == "+" || str == "-") {
+					token sign(str == "+" ? op_t::posite : op_t::negate);
+					m_infix.push_back(sign);
+					advance();
+					if (text() == "+" || text() == "-") {
+						fail("ʽ");
+					}
+					parse_expression(sign.operator_prioriry());
+					m_postfix.push_back(sign);
+				}
+				else if (type == token_t::function_operator) {
+					token func = current_operator();
+					m_infix.push_back(func);
+					advance();
+					parse_group();
+					m_postfix.push_back(func);
 				}
-				// ͨȼջ߻ȼĲ
 				else {
-					while (!ops.empty() && ops.top().operator_prioriry() >= tk.operator_prioriry()) {
-						m_postfix.push_back(ops.top());
-						ops.pop();
+					fail("ȱٲ");
+				}
+			}
+			// ȡһ󣬳ȼ min_priority ĺ׺/Ԫ
+			void parse_expression(byte min_priority) {
+				parse_prefix();
+				while (m_current && m_current->type == token_t::normal_operator) {
+					std::string_view str = text();
+					if (str == "(" || str == ")") {
+						break;
 					}
-					ops.push(tk);
+					token op = current_operator();
+					if (op.operator_prioriry() <= min_priority) {
+						break;
+					}
+					m_infix.push_back(op);
+					advance();
+					if (op.operator_operand_num() == 2) {
+						parse_expression(op.operator_prioriry());
+					}
+					// ֤״̬һ£׳˲д(3!)! ǺϷд
+					else if (text() == "!") {
+						fail("׳ǰ֡ʽ");
+					}
+					m_postfix.push_back(op);
 				}
 			}
+		};
+	}
+
+	namespace {
+		// ׺Ż׺˳ԵϽÿһͶ۵ǿ
+		// ӽڸɸд x^(1+1)x/(2*3) Ƕһ鼴ɴ
+		class postfix_optimizer {
+			struct node {
+				token tk;
+				int left;  // ӽ±꣬Ϊ -1
+				int right;
+			};
+			std::vector<node> m_nodes;
+			optimization_report& m_report;
+			const native_list& m_natives;
+		public:
+			postfix_optimizer(optimization_report& report, const native_list& natives) :m_report(report), m_natives(natives) {}
+			std::vector<token> optimize(const std::vector<token>& postfix) {
+				std::vector<int> operands;
+				m_nodes.reserve(postfix.size());
+				for (const auto& tk : postfix) {
+					if (!tk.is_operator()) {
+						operands.push_back(make(tk));
+						continue;
+					}
+					if (operands.size() < tk.operator_operand_num()) {
+						throw std::runtime_error("Żʱȱٲ");
+					}
+					if (tk.operator_operand_num() == 1) {
+						int a = operands.back();
+						operands.back() = unary(tk, a);
+					}
+					else {
+						int b = operands.back();
+						operands.pop_back();
+						int a = operands.back();
+						operands.back() = binary(tk, a, b);
+					}
+				}
+				if (operands.size() != 1) {
+					throw std::runtime_error("ŻʱջֻһԪ");
+				}
+				return emit(operands.back());
+			}
+		private:
+			int make(const token& tk, int left = -1, int right = -1) {
+				m_nodes.push_back({ tk, left, right });
+				return static_cast<int>(m_nodes.size() - 1);
+			}
+			bool is_constant(int index, double value) const {
+				return m_nodes[index].tk.is_number() && m_nodes[index].tk.number_value() == value;
+			}
+			// ԭʵΣ comma ǷȫΪ˳ȡ
+			bool constant_arguments(int index, std::vector<double>& arguments) const {
+				const token& tk = m_nodes[index].tk;
+				if (tk.is_operator() && tk.operator_id() == op_t::comma) {
+					return constant_arguments(m_nodes[index].left, arguments) && constant_arguments(m_nodes[index].right, arguments);
+				}
+				arguments.push_back(tk.number_value());
+				return tk.is_number();
+			}
+			int unary(const token& op, int a) {
+				const token& operand = m_nodes[a].tk;
+				if (op.operator_id() == op_t::posite) {
+					m_report.removed_posites++;
+					return a;
+				}
+				if (op.operator_id() == op_t::call) {
+					std::vector<double> arguments;
+					if (!constant_arguments(a, arguments)) {
+						return make(op, a);
+					}
+					m_report.folded_constants++;
+					return make(token(m_natives[op.variable_slot()]->callback(arguments)));
+				}
+				if (operand.is_number()) {
+					if (auto value = fold_constant(op.operator_id(), operand.number_value())) {
+						m_report.folded_constants++;
+						return make(token(*value));
+					}
+				}
+				if (op.operator_id() == op_t::negate && operand.is_operator() && operand.operator_id() == op_t::negate) {
+					m_report.double_negations++;
+					return m_nodes[a].left;
+				}
+				return make(op, a);
+			}
+			int binary(const token& op, int a, int b) {
+				if (op.operator_id() == op_t::comma) {
+					return make(op, a, b);
+				}
+				if (m_nodes[a].tk.is_number() && m_nodes[b].tk.is_number()) {
+					if (auto value = fold_constant(op.operator_id(), m_nodes[a].tk.number_value(), m_nodes[b].tk.number_value())) {
+						m_report.folded_constants++;
+						return make(token(*value));
+					}
+				}
+				if (op.operator_id() == op_t::exponent && is_constant(b, 2)) {
+					m_report.squares++;
+					return make(token(op_t::square), a);
+				}
+				if (op.operator_id() == op_t::exponent && is_constant(b, 0.5)) {
+					m_report.square_roots++;
+					return make(token(op_t::square_root), a);
+				}
+				// ԳΪ䵹ܾȷʾʱĩλ 1 ULPΪʱԭ
+				if (op.operator_id() == op_t::divide && m_nodes[b].tk.is_number()) {
+					double reciprocal = 1 / m_nodes[b].tk.number_value();
+					if (std::isfinite(reciprocal) && reciprocal != 0) {
+						m_report.reciprocals++;
+						return make(token(op_t::multiply), a, make(token(reciprocal)));
+					}
+				}
+				return make(op, a, b);
+			}
+			// ׺Уʽջʽݹ
+			std::vector<token> emit(int root) const {
+				std::vector<token> postfix;
+				std::vector<std::pair<int, bool>> pending{ { root, false } };
+				while (!pending.empty()) {
+					auto [index, expanded] = pending.back();
+					pending.pop_back();
+					const node& n = m_nodes[index];
+					if (expanded || n.left < 0) {
+						postfix.push_back(n.tk);
+						continue;
+					}
+					pending.push_back({ index, true });
+					if (n.right >= 0) {
+						pending.push_back({ n.right, false });
+					}
+					pending.push_back({ n.left, false });
+				}
+				return postfix;
+			}
+		};
+	}
+
+	// 캯Pratt һ׺׺ token УٶԺ׺۵ǿ
+	// ʱ֤Ըϸ
+	expression::expression(const std::string& infix_expression, const function_table* functions) {
+		if (instrumentation_enabled()) {
+			m_instrumentation = std::make_shared<instrumentation_state>();
+		}
+		expression_stats* stats = m_instrumentation ? &m_instrumentation->stats : nullptr;
+		try {
+			{
+				phase_timer timer(stats ? &stats->parse : nullptr);
+				pratt_parser(infix_expression, m_infix, m_postfix, m_variables, m_natives, m_optimizations, functions).parse();
+			}
+			phase_timer timer(stats ? &stats->optimize : nullptr);
+			m_postfix = postfix_optimizer(m_optimizations, m_natives).optimize(m_postfix);
 		}
-		// ʣ׺
-		while (!ops.empty()) {
-			m_postfix.push_back(ops.top());
-			ops.pop();
+		catch (const std::runtime_error&) {
+			expression_tokenizer tokenizer;
+			if (!tokenizer.validate(infix_expression)) {
+				throw std::runtime_error("ʽǷ\n" + tokenizer.detailed_analysis());
+			}
+			throw;
+		}
+	}
+
+	//  token Ŀɶıֵı
+	std::string expression::token_text(const token& tk) const {
+		if (tk.is_number()) {
+			return std::to_string(tk.number_value());
+		}
+		else if (tk.is_variable()) {
+			return m_variables[tk.variable_slot()];
+		}
+		else if (tk.operator_id() == op_t::call) {
+			return m_natives[tk.variable_slot()]->name;
 		}
+		return std::string(tk.operator_symbol());
 	}
 
-	// ׺ token блΪɶֵַı
+	// ׺ token блΪɶַ
 	std::string expression::infix_expression() const {
 		std::string str;
 		for (const auto& tk : m_infix) {
-			if (tk.type() == token_t::number_token) {
-				str += std::to_string(tk.number_value()) + ' ';
-			}
-			else {
-				str += tk.operator_symbol() + ' ';
-			}
+			str += token_text(tk) + ' ';
 		}
 		return str;
 	}
@@ -485,60 +1033,199 @@ namespace chr {
 	std::string expression::postfix_expression() const {
 		std::string str;
 		for (const auto& tk : m_postfix) {
-			if (tk.type() == token_t::number_token) {
-				str += std::to_string(tk.number_value()) + ' ';
+			str += token_text(tk) + ' ';
+		}
+		return str;
+	}
+
+	std::string optimization_report::to_string() const {
+		std::ostringstream oss;
+		auto line = [&oss](size_t count, const char* description) {
+			if (count != 0) {
+				oss << description << "" << count << " \n";
 			}
-			else {
-				str += tk.operator_symbol() + ' ';
+		};
+		line(folded_constants, "۵");
+		line(squares, "x^2  x*x");
+		line(square_roots, "x^0.5  sqrt(x)");
+		line(reciprocals, "x/c  x*(1/c)");
+		line(double_negations, "neg neg  ԭֵ");
+		line(removed_posites, "ɾ pos");
+		line(inlined_calls, "Զ庯");
+		return oss.str();
+	}
+
+	// ұλ
+	size_t expression::slot(std::string_view name) const {
+		auto it = std::find(m_variables.begin(), m_variables.end(), name);
+		if (it == m_variables.end()) {
+			throw std::runtime_error("ʽвڱ " + std::string(name));
+		}
+		return it - m_variables.begin();
+	}
+
+	std::vector<double> bind_variables(const std::vector<std::string>& variables, variable_binding bindings) {
+		std::vector<double> slots(variables.size());
+		std::vector<bool> bound(variables.size());
+		for (const auto& [name, value] : bindings) {
+			auto it = std::find(variables.begin(), variables.end(), name);
+			if (it == variables.end()) {
+				throw std::runtime_error("ʽвڱ " + std::string(name));
 			}
+			slots[it - variables.begin()] = value;
+			bound[it - variables.begin()] = true;
 		}
-		return str;
+		for (size_t i = 0; i < variables.size(); i++) {
+			if (!bound[i]) {
+				throw std::runtime_error(" " + variables[i] + " δ");
+			}
+		}
+		return slots;
 	}
 
-	// Ӻ׺ֱӼ㣨 calculate 
+	// ްֵʽܺб
 	double expression::evaluate_from_postfix() const {
-		std::stack<token> operands;
+		return evaluate(std::span<const double>());
+	}
+
+	double expression::evaluate(variable_binding bindings) const {
+		std::vector<double> slots = bind_variables(m_variables, bindings);
+		return evaluate(slots);
+	}
+
+	// ׺ֵ calculate ջѷ䣩 slots аλȡ
+	// ׮ʱͳȼڱεõľֲУϲ
+	double expression::evaluate(std::span<const double> slots) const {
+		if (slots.size() < m_variables.size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		if (!m_instrumentation) {
+			return run_postfix<false>(slots, nullptr);
+		}
+		expression_stats local{};
+		double result;
+		{
+			phase_timer timer(&local.evaluate);
+			result = run_postfix<true>(slots, &local);
+		}
+		std::lock_guard<std::mutex> lock(m_instrumentation->mutex);
+		m_instrumentation->stats.evaluate += local.evaluate;
+		for (size_t i = 0; i < operator_count; i++) {
+			m_instrumentation->stats.operators[i] += local.operators[i];
+		}
+		return result;
+	}
+
+	template <bool Instrumented>
+	double expression::run_postfix(std::span<const double> slots, expression_stats* stats) const {
+		fixed_stack<double> operands(m_postfix.size());
 		for (const auto& tk : m_postfix) {
-			if (tk.type() == token_t::number_token) {
-				operands.push(tk);
+			if (tk.is_number()) {
+				operands.push(tk.number_value());
+			}
+			else if (tk.is_variable()) {
+				operands.push(slots[tk.variable_slot()]);
+			}
+			else if (tk.operator_id() == op_t::comma) {
+				// ʵջϣ call һȡ
+			}
+			else if constexpr (Instrumented) {
+				phase_timer timer(&stats->operators[static_cast<byte>(tk.operator_id())]);
+				calculate(operands, tk, m_natives);
 			}
 			else {
-				calculate(operands, tk);
+				calculate(operands, tk, m_natives);
 			}
 		}
 		if (operands.size() != 1) {
 			throw std::runtime_error("ʱջֻһԪ");
 		}
-		return operands.top().number_value();
+		return operands.top();
+	}
+
+	expression_stats expression::stats() const {
+		if (!m_instrumentation) {
+			return {};
+		}
+		std::lock_guard<std::mutex> lock(m_instrumentation->mutex);
+		return m_instrumentation->stats;
+	}
+
+	std::string expression_stats::to_string() const {
+		std::ostringstream oss;
+		auto line = [&oss](std::string_view name, const phase_stats& stats) {
+			if (stats.calls != 0) {
+				oss << name << " " << stats.calls << " Σʱ " << stats.nanoseconds << " ns";
+				if (allocation_counting()) {
+					oss << " " << stats.allocations << " ";
+				}
+				oss << '\n';
+			}
+		};
+		line("", parse);
+		line("Ż", optimize);
+		line("׺ֵ", evaluate);
+		line("׺ֵ", evaluate_infix);
+		for (size_t i = 0; i < operator_count; i++) {
+			line("   " + std::string(operator_table[i].symbol), operators[i]);
+		}
+		return oss.str();
 	}
 
 	// ֱӰ׺㣨ʱȼ
 	double expression::evaluate_from_infix() const {
-		std::stack<token> operands;
-		std::stack<token> ops;
+		if (!m_variables.empty()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		if (!m_instrumentation) {
+			return run_infix();
+		}
+		phase_stats local;
+		double result;
+		{
+			phase_timer timer(&local);
+			result = run_infix();
+		}
+		std::lock_guard<std::mutex> lock(m_instrumentation->mutex);
+		m_instrumentation->stats.evaluate_infix += local;
+		return result;
+	}
+
+	double expression::run_infix() const {
+		fixed_stack<double> operands(m_infix.size());
+		fixed_stack<token> ops(m_infix.size());
 		for (const auto& tk : m_infix) {
 			if (tk.type() == token_t::number_token) {
-				operands.push(tk);
+				operands.push(tk.number_value());
 			}
 			else {
-				if (tk.operator_symbol() == "(") {
+				op_t id = tk.operator_id();
+				// ǰ׺pos/negûвֱջ
+				if (id == op_t::left_parentheses || (tk.operator_operand_num() == 1 && id != op_t::factorial)) {
 					ops.push(tk);
 				}
-				else if (tk.operator_symbol() == ")") {
+				else if (id == op_t::comma) {
+					// 굱ǰʵΣջеȴһʵ
+					while (ops.top().operator_id() != op_t::left_parentheses) {
+						calculate(operands, ops.top(), m_natives);
+						ops.pop();
+					}
+				}
+				else if (id == op_t::right_parentheses) {
 					while (!ops.empty()) {
-						if (ops.top().operator_symbol() == "(") {
+						if (ops.top().operator_id() == op_t::left_parentheses) {
 							ops.pop();
 							break;
 						}
 						else {
-							calculate(operands, ops.top());
+							calculate(operands, ops.top(), m_natives);
 							ops.pop();
 						}
 					}
 				}
 				else {
 					while (!ops.empty() && ops.top().operator_prioriry() >= tk.operator_prioriry()) {
-						calculate(operands, ops.top());
+						calculate(operands, ops.top(), m_natives);
 						ops.pop();
 					}
 					ops.push(tk);
@@ -547,11 +1234,48 @@ namespace chr {
 		}
 		// ʣ
 		while (!ops.empty()) {
-			calculate(operands, ops.top());
+			calculate(operands, ops.top(), m_natives);
 			ops.pop();
 		}
 		if (operands.size() != 1) {
 			throw std::runtime_error("ʱջֻһԪ");
 		}
-		return operands.top().number_value();
-	}
\ No newline at end of file
+		return operands.top();
+	}
+
+	// Ϊͨʶúͬ
+	void function_table::check_name(const std::string& name) {
+		if (token_type(name) != token_t::variable_number) {
+			throw std::runtime_error(" " + name + " ϷΪʶҲúͬ");
+		}
+	}
+
+	void function_table::define(const std::string& name, std::vector<std::string> parameters, const std::string& body) {
+		check_name(name);
+		for (size_t i = 0; i < parameters.size(); i++) {
+			check_name(parameters[i]);
+			if (std::find(parameters.begin(), parameters.begin() + i, parameters[i]) != parameters.begin() + i) {
+				throw std::runtime_error(" " + name + " Ĳ " + parameters[i] + " ظ");
+			}
+		}
+		auto function = std::make_shared<definition>();
+		function->parameters = std::move(parameters);
+		function->body.emplace(body, this);
+		m_functions[name] = std::move(function);
+	}
+
+	void function_table::define_native(const std::string& name, size_t arity, std::function<double(std::span<const double>)> callback) {
+		check_name(name);
+		if (arity == 0 || !callback) {
+			throw std::runtime_error("ԭ " + name + " ҪһͿɵõʵ");
+		}
+		auto function = std::make_shared<definition>();
+		function->native = std::make_shared<const native_function>(native_function{ name, arity, std::move(callback) });
+		m_functions[name] = std::move(function);
+	}
+
+	const function_table::definition* function_table::find(std::string_view name) const {
+		auto it = m_functions.find(std::string(name));
+		return it == m_functions.end() ? nullptr : it->second.get();
+	}
+}
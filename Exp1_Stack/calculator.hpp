@@ -3,17 +3,26 @@
 
 #include <iostream>
 #include <string>
-#include <regex>
+#include <string_view>
+#include <array>
 #include <vector>
 #include <stack>
 #include <algorithm>
 #include <unordered_map>
 #include <cmath>
 #include <stdexcept>
-#include <functional>
+#include <memory>
+#include <type_traits>
 #include <sstream>
-#include <variant>
 #include <optional>
+#include <charconv>
+#include <span>
+#include <cstdint>
+#include <initializer_list>
+#include <mutex>
+#include <functional>
+
+#include "instrumentation.hpp"
 
 namespace chr {
 
@@ -28,6 +37,7 @@ namespace chr {
 		octal_number,          // ˽ 0o...
 		hexadecimal_number,    // ʮ 0x...
 		decimal_number,        // ʮƣѧ
+		variable_number,       // x, y, t ȱʶʱΪλ
 		operator_token = 0x20, // ׼
 		signal_operator,       // һԪ +/-
 		normal_operator,       // Ԫͨ
@@ -38,6 +48,26 @@ namespace chr {
 	byte operator&(token_t a, token_t b) noexcept;
 	token_t token_type(const std::string& str) noexcept;
 
+	// ʷԪ¼Դеλãַ
+	struct lexeme {
+		token_t type;
+		size_t offset;
+		size_t length;
+	};
+
+	// дʷַз token
+	// ƥ˳ԭʽһ£//ʮ/ʮơ
+	class expression_lexer {
+		std::string_view m_source;
+		size_t m_pos;
+	public:
+		explicit expression_lexer(std::string_view source) :m_source(source), m_pos(0) {}
+		// ȡһ token޷ʶƬ invalid_token أʱ nullopt
+		std::optional<lexeme> next() noexcept;
+		//  pos ƥһ tokenƥ䳤ȣ0 ʾ޷ƥ䣩д
+		static size_t match(std::string_view source, size_t pos, token_t& type) noexcept;
+	};
+
 	// ж token_type
 	inline bool is_operator(const std::string& str) noexcept {
 		return token_t::operator_token & token_type(str);
@@ -56,18 +86,16 @@ namespace chr {
 	class expression_tokenizer {
 	private:
 		std::vector<std::string> m_tokens; // зֳ token бַʽ
+		std::vector<lexeme> m_lexemes;     //  m_tokens һһӦԴƫ
 		std::vector<std::pair<std::string, std::string>> m_errors; // бλ/
 	private:
-		void parse_signal_operators();    // һԪ + / -תΪ pos/neg
-		void parse_parenthese();          // 
-		void parse_operator_sequence();   // кϷ
-		void parse_number_format();       // ʽơѧ
-		void parse_function_usage();      // 麯Ƿ '('
+		void check_sequence();            // һԡСָʽ뺯ʽ
 		void add_error(const std::string& position, const std::string& description);
 	public:
 		bool tokenize(const std::string& expression); // ִʲ޷ʶַ
-		bool validate(const std::string& expression); // ֤öֽ
+		bool validate(const std::string& expression); // ִ֤ʺһɨ飩
 		const std::vector<std::string>& tokens() const { return m_tokens; }
+		const std::vector<lexeme>& lexemes() const { return m_lexemes; }
 		const std::vector<std::pair<std::string, std::string>>& errors() const { return m_errors; }
 		std::string detailed_analysis() const; // ϸ token Ϣ쳣Ϣ
 	};
@@ -80,169 +108,338 @@ namespace chr {
 	// ȼȼΪߣ
 	constexpr byte PRIORITY_FUNCTION = 0xFF;
 
-	// token ݳֻͣ
-	struct number_data {
-		double value;
-		number_data(double val = 0.0) :value(val) {}
+	// ţ operator_table ±
+	enum class op_t : byte {
+		add, minus, modulo, multiply, divide, posite, negate, exponent,
+		left_parentheses, right_parentheses, factorial,
+		sine, cosine, tangent, cotangent, secant, cosecant,
+		arcsine, arccosine, arctangent, arccotangent, arcsecant, arccosecant,
+		common_logarithm, natural_logarithm, square_root, cubic_root,
+		degree, radian,
+		square, // ڲŻ x^2 дõֱ
+		comma,  // ָֻԭУ׺ڲһ飬ֵʱκ
+		call    // ԭtoken ĲλΪڱʽе±꣬ɺ
 	};
+
+	// Ԫݣšȼִк
 	struct operator_data {
-		std::string symbol; // ı "+", "sin"
-		byte operand_num;   // 1  2
-		byte priority;      // ȼ׺ת׺ / 㣩
-		std::function<double(double, double)> apply; // ִк
-
-		operator_data(const std::string& sym = "", byte op_num = 0, byte pri = 0,
-			std::function<double(double, double)>func = nullptr)
-			: symbol(sym), operand_num(op_num), priority(pri), apply(std::move(func)) {}
+		std::string_view symbol; // ı "+", "sin"
+		byte operand_num;        // 1  2Ϊ 0
+		byte priority;           // ȼ׺ת׺ / 㣩
+		double (*apply)(double, double); // ִк
+	};
+
+	//  op_t ˳УһѧȼΪ PRIORITY_FUNCTIONΪȼһԪ㴦
+	inline constexpr operator_data operator_table[] = {
+		{ "+", 2, 1, [](double a, double b) { return a + b; } },
+		{ "-", 2, 1, [](double a, double b) { return a - b; } },
+		{ "%", 2, 2, [](double a, double b) { return static_cast<double>(fmodl(a, b)); } },
+		{ "*", 2, 3, [](double a, double b) { return a * b; } },
+		{ "/", 2, 3, [](double a, double b) { return a / b; } },
+		{ "pos", 1, 4, [](double a, double b) { return a; } },
+		{ "neg", 1, 4, [](double a, double b) { return -a; } },
+		{ "^", 2, 5, [](double a, double b) { return pow(a, b); } },
+		{ "(", 0, 0, [](double a, double b) { return 0.0; } },
+		{ ")", 0, 0, [](double a, double b) { return 0.0; } },
+		// ʹ tgamma(n+1) ʵֽ׳ˣݷ
+		{ "!", 1, 6, [](double a, double b) { return tgamma(a + 1); } },
+		{ "sin", 1, PRIORITY_FUNCTION, [](double a, double b) { return sin(a); } },
+		{ "cos", 1, PRIORITY_FUNCTION, [](double a, double b) { return cos(a); } },
+		{ "tan", 1, PRIORITY_FUNCTION, [](double a, double b) { return tan(a); } },
+		{ "cot", 1, PRIORITY_FUNCTION, [](double a, double b) { return 1 / tan(a); } },
+		{ "sec", 1, PRIORITY_FUNCTION, [](double a, double b) { return 1 / cos(a); } },
+		{ "csc", 1, PRIORITY_FUNCTION, [](double a, double b) { return 1 / sin(a); } },
+		{ "arcsin", 1, PRIORITY_FUNCTION, [](double a, double b) { return asin(a); } },
+		{ "arccos", 1, PRIORITY_FUNCTION, [](double a, double b) { return acos(a); } },
+		{ "arctan", 1, PRIORITY_FUNCTION, [](double a, double b) { return atan(a); } },
+		{ "arccot", 1, PRIORITY_FUNCTION, [](double a, double b) { return atan(1 / a); } },
+		{ "arcsec", 1, PRIORITY_FUNCTION, [](double a, double b) { return acos(1 / a); } },
+		{ "arccsc", 1, PRIORITY_FUNCTION, [](double a, double b) { return asin(1 / a); } },
+		{ "lg", 1, PRIORITY_FUNCTION, [](double a, double b) { return log10(a); } },
+		{ "ln", 1, PRIORITY_FUNCTION, [](double a, double b) { return log(a); } },
+		{ "sqrt", 1, PRIORITY_FUNCTION, [](double a, double b) { return sqrt(a); } },
+		{ "cbrt", 1, PRIORITY_FUNCTION, [](double a, double b) { return cbrt(a); } },
+		// Ƕ/תע⣺degree / rad ÷ΪһԪ
+		{ "deg", 1, PRIORITY_FUNCTION, [](double a, double b) { return a / CONSTANT_PI * 180; } },
+		{ "rad", 1, PRIORITY_FUNCTION, [](double a, double b) { return a / 180 * CONSTANT_PI; } },
+		// ڲ
+		{ "sqr", 1, PRIORITY_FUNCTION, [](double a, double b) { return a * a; } },
+		{ ",", 2, 0, [](double a, double b) { return 0.0; } },
+		{ "call", 1, PRIORITY_FUNCTION, [](double a, double b) { return 0.0; } },
 	};
 
-	// token ࣺװֻṩ빤
+	inline constexpr size_t operator_count = std::size(operator_table);
+
+	constexpr const operator_data& operator_info(op_t op) {
+		return operator_table[static_cast<byte>(op)];
+	}
+
+	// Գ±ȡеĺڼȷĿ꣬
+	template <op_t Op>
+	inline double apply_operator(double a, double b = 0) {
+		constexpr auto func = operator_info(Op).apply;
+		return func(a, b);
+	}
+
+	// 㣺ֵС 2^53  double һǾȷģ2^53 Ҳ 2^53+1 ͬȷ
+	constexpr std::int64_t exact_integer_bound = std::int64_t(1) << 53;
+	constexpr double exact_integer_limit = 9007199254740992.0;
+	// жϷΧҲų NaNٽضϱȽϣ floorû SSE4.1 ʱǿ⺯ã
+	inline bool is_exact_integer(double x) {
+		return std::abs(x) < exact_integer_limit && static_cast<double>(static_cast<std::int64_t>(x)) == x;
+	}
+	//  64 λ㣬ʱ falseGCC/Clang ڽԤж
+	inline bool checked_add(std::int64_t a, std::int64_t b, std::int64_t& r) {
+#if defined(__GNUC__) || defined(__clang__)
+		return !__builtin_add_overflow(a, b, &r);
+#else
+		if ((b > 0 && a > INT64_MAX - b) || (b < 0 && a < INT64_MIN - b)) {
+			return false;
+		}
+		r = a + b;
+		return true;
+#endif
+	}
+	inline bool checked_subtract(std::int64_t a, std::int64_t b, std::int64_t& r) {
+#if defined(__GNUC__) || defined(__clang__)
+		return !__builtin_sub_overflow(a, b, &r);
+#else
+		if ((b < 0 && a > INT64_MAX + b) || (b > 0 && a < INT64_MIN + b)) {
+			return false;
+		}
+		r = a - b;
+		return true;
+#endif
+	}
+	inline bool checked_multiply(std::int64_t a, std::int64_t b, std::int64_t& r) {
+#if defined(__GNUC__) || defined(__clang__)
+		return !__builtin_mul_overflow(a, b, &r);
+#else
+		if (a > 0 ? (b > 0 ? a > INT64_MAX / b : b < INT64_MIN / a)
+			: (b > 0 ? a < INT64_MIN / b : a != 0 && b < INT64_MAX / a)) {
+			return false;
+		}
+		r = a * b;
+		return true;
+#endif
+	}
+	//  operator_table һ£% ķ汻fmodָֻеΪ 1 ʱ
+	// ûн׳ˣΪ㡢ʱ false
+	inline bool checked_modulo(std::int64_t a, std::int64_t b, std::int64_t& r) {
+		if (b == 0) {
+			return false;
+		}
+		r = b == -1 ? 0 : a % b;
+		return true;
+	}
+	inline bool checked_power(std::int64_t a, std::int64_t b, std::int64_t& r) {
+		if (b < 0) {
+			if (a != 1 && a != -1) {
+				return false;
+			}
+			r = a == 1 || b % 2 == 0 ? 1 : -1;
+			return true;
+		}
+		// ƽݣƽʱֻҪʣָλҲȻ
+		std::int64_t result = 1;
+		while (true) {
+			if ((b & 1) && !checked_multiply(result, a, result)) {
+				return false;
+			}
+			b >>= 1;
+			if (b == 0) {
+				break;
+			}
+			if (!checked_multiply(a, a, a)) {
+				return false;
+			}
+		}
+		r = result;
+		return true;
+	}
+	inline bool checked_factorial(std::int64_t a, std::int64_t& r) {
+		if (a < 0 || a > 20) { // 21!  int64
+			return false;
+		}
+		r = 1;
+		for (std::int64_t k = 2; k <= a; k++) {
+			r *= k;
+		}
+		return true;
+	}
+	// ۵ double У expression::evaluatecompiled_expression::evaluateevaluate_batch Ľͬ
+	// ·ֻ double һʱãint64 ľȷֻ evaluate_integer 
+	// ȷΧĲõȷΧڵʱ۵ nullopt
+	std::optional<double> fold_constant(op_t op, double a, double b = 0);
+
+	// token ࣺ16 ֽڿƽƵֻ֡ operator_table ±
 	class token {
 		token_t m_type;
-		std::variant<number_data, operator_data> m_data;
+		op_t m_operator;
+		std::uint32_t m_slot; // λԭʱΪ±꣩
+		double m_value;
 	public:
-		token() :m_type(token_t::invalid_token), m_data() {}
-		token(double val) :m_type(token_t::number_token), m_data(number_data{ val }) {}
-		token(const std::string& sym, byte op_num, byte pri,
-			std::function<double(double, double)>func)
-			:m_type(token_t::operator_token), m_data(operator_data{ sym,op_num,pri,std::move(func) }) {}
+		constexpr token() :m_type(token_t::invalid_token), m_operator(op_t::add), m_slot(0), m_value(0) {}
+		constexpr token(double val) :m_type(token_t::number_token), m_operator(op_t::add), m_slot(0), m_value(val) {}
+		constexpr token(op_t op) :m_type(token_t::operator_token), m_operator(op), m_slot(0), m_value(0) {}
 		token_t type() const { return m_type; }
 		bool is_number() const { return m_type == token_t::number_token; }
+		bool is_variable() const { return m_type == token_t::variable_number; }
 		bool is_operator() const { return m_type == token_t::operator_token; }
 		bool is_valid() const { return m_type != token_t::invalid_token; }
-		double number_value() const {
-			return std::get<number_data>(m_data).value;
-		}
-		const std::string& operator_symbol() const {
-			return std::get<operator_data>(m_data).symbol;
-		}
-		byte operator_operand_num() const {
-			return std::get<operator_data>(m_data).operand_num;
-		}
-		byte operator_prioriry() const {
-			return std::get<operator_data>(m_data).priority;
-		}
-		double apply_operator(double a, double b) const {
-			return std::get<operator_data>(m_data).apply(a, b);
-		}
-		template <typename Visitor>
-		auto visit(Visitor&& vis) -> decltype(auto) {
-			return std::visit(std::forward<Visitor>(vis), m_data);
-		}
+		double number_value() const { return m_value; }
+		std::uint32_t variable_slot() const { return m_slot; }
+		op_t operator_id() const { return m_operator; }
+		std::string_view operator_symbol() const { return operator_info(m_operator).symbol; }
+		byte operator_operand_num() const { return operator_info(m_operator).operand_num; }
+		byte operator_prioriry() const { return operator_info(m_operator).priority; }
+		double apply_operator(double a, double b) const { return operator_info(m_operator).apply(a, b); }
 	public:
-		// ͵ token / ֲ / 
 		static token from_number(double val) {
 			return token(val);
 		}
-		static token add() {
-			return token("+", 2, 1, [](double a, double b) {return a + b; });
-		}
-		static token minus() {
-			return token("-", 2, 1, [](double a, double b) {return a - b; });
-		}
-		static token modulo() {
-			return token("%", 2, 2, [](double a, double b) { return fmodl(a, b); });
-		}
-		static token multiply() {
-			return token("*", 2, 3, [](double a, double b) {return a * b; });
-		}
-		static token divide() {
-			return token("/", 2, 3, [](double a, double b) {return a / b; });
-		}
-		static token posite() {
-			return token("pos", 1, 4, [](double a, double b) {return a; });
-		}
-		static token negate() {
-			return token("neg", 1, 4, [](double a, double b) {return -a; });
-		}
-		static token exponent() {
-			return token("^", 2, 5, [](double a, double b) {return pow(a, b); });
+		static token from_variable(std::uint32_t slot) {
+			token tk;
+			tk.m_type = token_t::variable_number;
+			tk.m_slot = slot;
+			return tk;
 		}
-		static token left_parentheses() {
-			return token("(", 0, 0, [](double a, double b) {return 0; });
-		}
-		static token right_parentheses() {
-			return token(")", 0, 0, [](double a, double b) {return 0; });
-		}
-		static token factorial() {
-			// ʹ tgamma(n+1) ʵֽ׳ˣݷ
-			return token("!", 1, 6, [](double a, double b) {return tgamma(a + 1); });
-		}
-		// һѧȼΪ PRIORITY_FUNCTIONΪȼһԪ
-		static token sine() {
-			return token("sin", 1, PRIORITY_FUNCTION, [](double a, double b) {return sin(a); });
-		}
-		static token cosine() {
-			return token("cos", 1, PRIORITY_FUNCTION, [](double a, double b) {return cos(a); });
-		}
-		static token tangent() {
-			return token("tan", 1, PRIORITY_FUNCTION, [](double a, double b) {return tan(a); });
-		}
-		static token cotangent() {
-			return token("cot", 1, PRIORITY_FUNCTION, [](double a, double b) {return 1 / tan(a); });
-		}
-		static token secant() {
-			return token("sec", 1, PRIORITY_FUNCTION, [](double a, double b) {return 1 / cos(a); });
-		}
-		static token cosecant() {
-			return token("csc", 1, PRIORITY_FUNCTION, [](double a, double b) {return 1 / sin(a); });
-		}
-		static token arcsine() {
-			return token("arcsin", 1, PRIORITY_FUNCTION, [](double a, double b) {return asin(a); });
-		}
-		static token arccosine() {
-			return token("arccos", 1, PRIORITY_FUNCTION, [](double a, double b) {return acos(a); });
-		}
-		static token arctangent() {
-			return token("arctan", 1, PRIORITY_FUNCTION, [](double a, double b) {return atan(a); });
-		}
-		static token arccotangent() {
-			return token("arccot", 1, PRIORITY_FUNCTION, [](double a, double b) {return atan(1 / a); });
-		}
-		static token arcsecant() {
-			return token("arcsec", 1, PRIORITY_FUNCTION, [](double a, double b) {return acos(1 / a); });
-		}
-		static token arccosecant() {
-			return token("arccsc", 1, PRIORITY_FUNCTION, [](double a, double b) {return asin(1 / a); });
-		}
-		static token common_logarithm() {
-			return token("lg", 1, PRIORITY_FUNCTION, [](double a, double b) {return log10(a); });
-		}
-		static token natural_logarithm() {
-			return token("ln", 1, PRIORITY_FUNCTION, [](double a, double b) {return log(a); });
-		}
-		static token square_root() {
-			return token("sqrt", 1, PRIORITY_FUNCTION, [](double a, double b) {return sqrt(a); });
-		}
-		static token cubic_root() {
-			return token("cbrt", 1, PRIORITY_FUNCTION, [](double a, double b) {return cbrt(a); });
-		}
-		// Ƕ/תע⣺degree / rad ÷ΪһԪ
-		static token degree() {
-			return token("deg", 1, PRIORITY_FUNCTION, [](double a, double b) {return a / CONSTANT_PI * 180; });
-		}
-		static token radian() {
-			return token("rad", 1, PRIORITY_FUNCTION, [](double a, double b) {return a / 180 * CONSTANT_PI; });
+		static token from_call(std::uint32_t function) {
+			token tk(op_t::call);
+			tk.m_slot = function;
+			return tk;
 		}
 		static token from_string(const std::string& str);
+		// ֪ͰıתΪֵжͣ
+		static double parse_number(std::string_view str, token_t type);
+		// /ӳΪ tokenδ֪Ʒ nullopt
+		static std::optional<token> try_parse_operator(std::string_view str);
 	private:
-		// ԽַΪֻ
+		// ԽַΪ
 		static std::optional<double> try_parse_number(const std::string& str);
-		static std::optional<token> try_parse_operator(const std::string& str);
 	};
+	static_assert(sizeof(token) == 16 && std::is_trivially_copyable_v<token>);
+
+	// ջ N ʱʹջ飬һ룬ѹջ/ջ̲ٷ
+	template <typename T, size_t N = 64>
+	class fixed_stack {
+		T m_local[N];
+		std::unique_ptr<T[]> m_heap;
+		T* m_data;
+		size_t m_size;
+	public:
+		explicit fixed_stack(size_t capacity)
+			:m_heap(capacity > N ? new T[capacity] : nullptr), m_data(m_heap ? m_heap.get() : m_local), m_size(0) {}
+		fixed_stack(const fixed_stack&) = delete;
+		fixed_stack& operator=(const fixed_stack&) = delete;
+		void push(const T& value) { m_data[m_size++] = value; }
+		void pop() { m_size--; }
+		T& top() { return m_data[m_size - 1]; }
+		bool empty() const { return m_size == 0; }
+		size_t size() const { return m_size; }
+	};
+
 	// ʽࣺ׺׺ʾṩӿ
+	// ư󶨵ȡֵ { {"x", 1.5}, {"y", 2} }
+	using variable_binding = std::initializer_list<std::pair<std::string_view, double>>;
+
+	// ׺Ż棺дʵʷĴ
+	struct optimization_report {
+		size_t folded_constants = 0; // ۵ȥƣ
+		size_t squares = 0;          // x^2  x*x
+		size_t square_roots = 0;     // x^0.5  sqrt(x)
+		size_t reciprocals = 0;      // x/c  x*(1/c)
+		size_t double_negations = 0; // neg neg  ԭֵ
+		size_t removed_posites = 0;  // pos  ɾ
+		size_t inlined_calls = 0;    // Զ庯ãʱչ
+		size_t total() const {
+			return folded_constants + squares + square_roots + reciprocals + double_negations + removed_posites + inlined_calls;
+		}
+		std::string to_string() const; // ÿһУֻгĸд
+	};
+
+	// ʽĲ׮ͳƣ׶ĵôʱͶѷ
+	struct expression_stats {
+		phase_stats parse;          // ʷ + Pratt 
+		phase_stats optimize;       // ׺Ż
+		phase_stats evaluate;       // ׺ֵ󶨱ֵ
+		phase_stats evaluate_infix; // ׺ֵ
+		std::array<phase_stats, operator_count> operators; // ׺ֵа
+		std::string to_string() const; // ÿһУֻгù
+	};
+
+	// ԭ̶һԴͬõͬ
+	// ʱȫΪĵûᱻ۵ͬĵûᱻϲ
+	struct native_function {
+		std::string name;
+		size_t arity;
+		std::function<double(std::span<const double>)> callback;
+	};
+	using native_list = std::vector<std::shared_ptr<const native_function>>;
+
+	class function_table;
+
 	class expression {
+		// ׮״̬ڹʱ enable_instrumentation ŷ䣻ֵܲϲͳʱ
+		struct instrumentation_state {
+			std::mutex mutex;
+			expression_stats stats{};
+		};
 		std::vector<token> m_infix;
 		std::vector<token> m_postfix;
+		std::vector<std::string> m_variables; // ±꼴λ״γֵ˳
+		native_list m_natives;                // õԭ±꼴 call token Ĳλ
+		optimization_report m_optimizations;
+		std::shared_ptr<instrumentation_state> m_instrumentation; // Ƶ expression ͬһͳ
 	private:
-		void calculate(std::stack<token>& operands, const token& op) const;
+		std::string token_text(const token& tk) const;
+		template <bool Instrumented>
+		double run_postfix(std::span<const double> slots, expression_stats* stats) const;
+		double run_infix() const;
 	public:
-		expression(const std::string& infix_expression);
+		// functions ΪɵõԶ庯Ϊգֻڹʱʹã֮޸Ļ
+		expression(const std::string& infix_expression, const function_table* functions = nullptr);
 		std::string infix_expression() const;
 		std::string postfix_expression() const;
+		const std::vector<token>& infix() const { return m_infix; }
+		const std::vector<token>& postfix() const { return m_postfix; }
+		const std::vector<std::string>& variables() const { return m_variables; }
+		const native_list& natives() const { return m_natives; }
+		const optimization_report& optimizations() const { return m_optimizations; } // ʱԺ׺ĸд
+		bool instrumented() const { return m_instrumentation != nullptr; }
+		expression_stats stats() const; // ͳƿգδ׮ʱΪ㣩
+		size_t slot(std::string_view name) const; // ӦĲλʱ׳쳣
 		double evaluate_from_postfix() const;
 		double evaluate_from_infix() const;
+		// 󶨱ֵslots λ˳ֵ
+		double evaluate(std::span<const double> slots) const;
+		double evaluate(variable_binding bindings) const;
 	};
+
+	// Զ庯ӳ䡣ɱʽıĺڵôչ
+	// ʵֱӴ뺯壬۵빫ӱʽϲԿԽñ߽磬ûκεÿ
+	class function_table {
+	public:
+		struct definition {
+			std::vector<std::string> parameters;
+			std::optional<expression> body;               // ɱʽʱĺ壨ѽ
+			std::shared_ptr<const native_function> native; // ԭ
+			size_t arity() const { return native ? native->arity : parameters.size(); }
+		};
+	private:
+		std::unordered_map<std::string, std::shared_ptr<const definition>> m_functions;
+	private:
+		static void check_name(const std::string& name);
+	public:
+		// ɱʽı壺Եôǰĺʱչ
+		// ıʶΪôʽıͬ滻ɶ壬ѹıʽӰ
+		void define(const std::string& name, std::vector<std::string> parameters, const std::string& body);
+		void define_native(const std::string& name, size_t arity, std::function<double(std::span<const double>)> callback);
+		const definition* find(std::string_view name) const;
+	};
+
+	// ѰչΪλ飨ȱٻı׳쳣
+	std::vector<double> bind_variables(const std::vector<std::string>& variables, variable_binding bindings);
 }
 
 #endif // CALCULATOR_HPP
\ No newline at end of file
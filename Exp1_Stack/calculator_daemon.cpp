@@ -0,0 +1,376 @@
+#include "calculator_daemon.hpp"
+#include "thread_pool.hpp"
+
+#include <cstring>
+#include <filesystem>
+
+#ifdef _WIN32
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <winsock2.h>
+#include <afunix.h>
+#pragma comment(lib, "Ws2_32.lib")
+#else
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#endif
+
+namespace chr {
+	namespace {
+		// ƽ̨ص׽ֲWindows 10  Winsock ֧ͬ AF_UNIX
+#ifdef _WIN32
+		using native_socket = SOCKET;
+		const native_socket invalid_socket = INVALID_SOCKET;
+		void close_socket(native_socket s) { closesocket(s); }
+		void shutdown_socket(native_socket s) { ::shutdown(s, SD_BOTH); }
+		void initialize_sockets() {
+			static const bool initialized = [] {
+				WSADATA data;
+				return WSAStartup(MAKEWORD(2, 2), &data) == 0;
+			}();
+			if (!initialized) {
+				throw std::runtime_error("Winsock ʼʧ");
+			}
+		}
+		constexpr int send_flags = 0;
+#else
+		using native_socket = int;
+		const native_socket invalid_socket = -1;
+		void close_socket(native_socket s) { ::close(s); }
+		void shutdown_socket(native_socket s) { ::shutdown(s, SHUT_RDWR); }
+		void initialize_sockets() {}
+#ifdef MSG_NOSIGNAL
+		constexpr int send_flags = MSG_NOSIGNAL; // Զ˹رʱشǴ SIGPIPE
+#else
+		constexpr int send_flags = 0;
+#endif
+#endif
+		native_socket to_native(std::uintptr_t s) { return static_cast<native_socket>(s); }
+
+		sockaddr_un make_address(const std::string& path) {
+			sockaddr_un address{};
+			address.sun_family = AF_UNIX;
+			if (path.size() >= sizeof(address.sun_path)) {
+				throw std::runtime_error("׽·" + path);
+			}
+			std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+			return address;
+		}
+
+		bool send_all(native_socket s, const std::string& data) {
+			size_t sent = 0;
+			while (sent < data.size()) {
+				int n = ::send(s, data.data() + sent, static_cast<int>(std::min<size_t>(data.size() - sent, 1 << 30)), send_flags);
+				if (n <= 0) {
+					return false;
+				}
+				sent += n;
+			}
+			return true;
+		}
+
+		// ׷ӶȡһΣǷݣӹرջʱΪ٣
+		bool receive_some(native_socket s, std::string& buffer) {
+			char chunk[65536];
+			int n = ::recv(s, chunk, sizeof(chunk), 0);
+			if (n <= 0) {
+				return false;
+			}
+			buffer.append(chunk, n);
+			return true;
+		}
+
+		void put_u32(std::string& out, std::uint32_t value) {
+			for (int i = 0; i < 4; i++) {
+				out += static_cast<char>((value >> (8 * i)) & 0xFF);
+			}
+		}
+		std::uint32_t get_u32(const char* p) {
+			std::uint32_t value = 0;
+			for (int i = 0; i < 4; i++) {
+				value |= static_cast<std::uint32_t>(static_cast<unsigned char>(p[i])) << (8 * i);
+			}
+			return value;
+		}
+
+		// ӻͷȡһ֡һ֡ʱ nullopt֡ΪЭ
+		std::optional<std::string> take_frame(std::string& buffer, size_t& offset) {
+			if (buffer.size() - offset < 4) {
+				return std::nullopt;
+			}
+			std::uint32_t length = get_u32(buffer.data() + offset);
+			if (length > daemon_max_frame) {
+				throw std::runtime_error("֡ȳ");
+			}
+			if (buffer.size() - offset - 4 < length) {
+				return std::nullopt;
+			}
+			std::string frame = buffer.substr(offset + 4, length);
+			offset += 4 + length;
+			return frame;
+		}
+
+		void put_response(std::string& out, const daemon_response& response) {
+			if (response.ok) {
+				put_u32(out, 9);
+				out += '\0';
+				std::uint64_t bits = std::bit_cast<std::uint64_t>(response.value);
+				for (int i = 0; i < 8; i++) {
+					out += static_cast<char>((bits >> (8 * i)) & 0xFF);
+				}
+			}
+			else {
+				put_u32(out, static_cast<std::uint32_t>(response.error.size() + 1));
+				out += '\1';
+				out += response.error;
+			}
+		}
+
+		daemon_response parse_response(const std::string& frame) {
+			if (frame.empty()) {
+				throw std::runtime_error("Ӧ֡Ϊ");
+			}
+			if (frame[0] != '\0') {
+				return { false, 0, frame.substr(1) };
+			}
+			if (frame.size() != 9) {
+				throw std::runtime_error("Ӧ֡ȴ");
+			}
+			std::uint64_t bits = 0;
+			for (int i = 0; i < 8; i++) {
+				bits |= static_cast<std::uint64_t>(static_cast<unsigned char>(frame[1 + i])) << (8 * i);
+			}
+			return { true, std::bit_cast<double>(bits), {} };
+		}
+	}
+
+	calculator_daemon::calculator_daemon(std::string path, const daemon_options& options)
+		:m_path(std::move(path)), m_options(options), m_cache(options.cache_capacity, options.functions), m_stopping(false),
+		m_listener(static_cast<std::uintptr_t>(invalid_socket)) {
+		initialize_sockets();
+	}
+
+	calculator_daemon::~calculator_daemon() {
+		stop();
+		reap_connections(true);
+	}
+
+	void calculator_daemon::stop() {
+		//  thread_pool ͬñ־̲߳ڼ뿪ʼȴ֪֮ͨ
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stopping = true;
+		}
+		m_available.notify_all();
+		native_socket listener = to_native(m_listener.exchange(static_cast<std::uintptr_t>(invalid_socket)));
+		if (listener != invalid_socket) {
+#ifndef _WIN32
+			::shutdown(listener, SHUT_RDWR); //  accept ϵ߳
+#endif
+			close_socket(listener);
+		}
+		std::lock_guard<std::mutex> lock(m_connection_mutex);
+		for (auto& client : m_connections) {
+			shutdown_socket(to_native(client.socket));
+		}
+	}
+
+	// ѽ̲߳ر׽֣all ΪʱȹرȫӵĶдٻա
+	// ȴ߳̽ stop() ȴlist Ľڵƶַ䣬̳߳еЧ
+	void calculator_daemon::reap_connections(bool all) {
+		std::list<connection> finished;
+		{
+			std::lock_guard<std::mutex> lock(m_connection_mutex);
+			for (auto it = m_connections.begin(); it != m_connections.end();) {
+				auto next = std::next(it);
+				if (all || it->finished) {
+					if (all) {
+						shutdown_socket(to_native(it->socket));
+					}
+					finished.splice(finished.end(), m_connections, it);
+				}
+				it = next;
+			}
+		}
+		for (auto& client : finished) {
+			if (client.thread.joinable()) {
+				client.thread.join();
+			}
+			close_socket(to_native(client.socket));
+		}
+	}
+
+	// һֵʽֻһΣرõӦ֡
+	std::string calculator_daemon::evaluate_requests(const std::vector<std::string>& requests) {
+		std::string out;
+		out.reserve(requests.size() * 13);
+		for (const auto& text : requests) {
+			try {
+				put_response(out, { true, m_cache.get(text)->evaluate(), {} });
+			}
+			catch (const std::exception& e) {
+				put_response(out, { false, 0, e.what() });
+			}
+		}
+		return out;
+	}
+
+	// ̣߳Ѹύκϲɲ max_batch 񽻸̳߳أ
+	// ֹͣ԰Ѷʣη̳꣬߳ǰִȫӵܵõ
+	void calculator_daemon::dispatch() {
+		thread_pool pool(m_options.threads);
+		while (true) {
+			auto group = std::make_shared<std::vector<std::shared_ptr<pending_batch>>>();
+			{
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_available.wait(lock, [this] { return m_stopping || !m_queue.empty(); });
+				if (m_queue.empty()) {
+					return;
+				}
+				size_t count = 0;
+				while (!m_queue.empty() && (group->empty() || count + m_queue.front()->requests.size() <= m_options.max_batch)) {
+					count += m_queue.front()->requests.size();
+					group->push_back(std::move(m_queue.front()));
+					m_queue.pop_front();
+				}
+			}
+			pool.submit([this, group] {
+				for (auto& batch : *group) {
+					batch->responses.set_value(evaluate_requests(batch->requests));
+				}
+			});
+		}
+	}
+
+	// ̣߳ǰѵȫΪһȴֵɺһд
+	void calculator_daemon::serve(connection& client) {
+		native_socket s = to_native(client.socket);
+		std::string buffer;
+		try {
+			while (!m_stopping && receive_some(s, buffer)) {
+				auto batch = std::make_shared<pending_batch>();
+				size_t offset = 0;
+				while (auto frame = take_frame(buffer, offset)) {
+					batch->requests.push_back(std::move(*frame));
+				}
+				buffer.erase(0, offset);
+				if (batch->requests.empty()) {
+					continue;
+				}
+				std::future<std::string> responses = batch->responses.get_future();
+				{
+					// ֹͣ߳̿Ѿ˳ӣһԶò
+					std::lock_guard<std::mutex> lock(m_mutex);
+					if (m_stopping) {
+						break;
+					}
+					m_queue.push_back(std::move(batch));
+				}
+				m_available.notify_one();
+				if (!send_all(s, responses.get())) {
+					break;
+				}
+			}
+		}
+		catch (const std::exception&) {
+			// ЭֱӶϿ
+		}
+		shutdown_socket(s); // ׽ reap_connections رգ stop() Ѹõ shutdown
+		client.finished = true;
+	}
+
+	void calculator_daemon::run() {
+		sockaddr_un address = make_address(m_path);
+		std::error_code ignored;
+		std::filesystem::remove(m_path, ignored); // ϴ׽ļ
+		native_socket listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (listener == invalid_socket) {
+			throw std::runtime_error("׽ʧ");
+		}
+		if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, SOMAXCONN) != 0) {
+			close_socket(listener);
+			throw std::runtime_error("޷׽֣" + m_path);
+		}
+		m_listener = static_cast<std::uintptr_t>(listener);
+		std::thread dispatcher([this] { dispatch(); });
+		while (!m_stopping) {
+			native_socket accepted = ::accept(listener, nullptr, nullptr);
+			if (accepted == invalid_socket) {
+				continue;
+			}
+			reap_connections(false);
+			std::lock_guard<std::mutex> lock(m_connection_mutex);
+			// stop() رӣ˺ܵӲ߳
+			if (m_stopping) {
+				close_socket(accepted);
+				break;
+			}
+			connection& client = m_connections.emplace_back();
+			client.socket = static_cast<std::uintptr_t>(accepted);
+			client.thread = std::thread([this, &client] { serve(client); });
+		}
+		dispatcher.join();
+		reap_connections(true);
+		std::filesystem::remove(m_path, ignored);
+	}
+
+	daemon_client::daemon_client(const std::string& path) {
+		initialize_sockets();
+		sockaddr_un address = make_address(path);
+		native_socket s = ::socket(AF_UNIX, SOCK_STREAM, 0);
+		if (s == invalid_socket) {
+			throw std::runtime_error("׽ʧ");
+		}
+		if (::connect(s, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+			close_socket(s);
+			throw std::runtime_error("޷ӵ" + path);
+		}
+		m_socket = static_cast<std::uintptr_t>(s);
+	}
+
+	daemon_client::~daemon_client() {
+		close_socket(to_native(m_socket));
+	}
+
+	// ˮߣÿ pipeline_window һηٰ˳ȡͬӦ
+	// Ϊ˱˫ķͻͬʱдȴ
+	std::vector<daemon_response> daemon_client::evaluate(const std::vector<std::string>& expressions) {
+		constexpr size_t pipeline_window = 1024;
+		native_socket s = to_native(m_socket);
+		std::vector<daemon_response> responses;
+		responses.reserve(expressions.size());
+		for (size_t first = 0; first < expressions.size(); first += pipeline_window) {
+			size_t last = std::min(first + pipeline_window, expressions.size());
+			std::string out;
+			for (size_t i = first; i < last; i++) {
+				if (expressions[i].size() > daemon_max_frame) {
+					throw std::runtime_error("ʽ");
+				}
+				put_u32(out, static_cast<std::uint32_t>(expressions[i].size()));
+				out += expressions[i];
+			}
+			if (!send_all(s, out)) {
+				throw std::runtime_error("ʧ");
+			}
+			size_t offset = 0;
+			while (responses.size() < last) {
+				if (auto frame = take_frame(m_buffer, offset)) {
+					responses.push_back(parse_response(*frame));
+					continue;
+				}
+				m_buffer.erase(0, offset);
+				offset = 0;
+				if (!receive_some(s, m_buffer)) {
+					throw std::runtime_error("ѶϿ");
+				}
+			}
+			m_buffer.erase(0, offset);
+		}
+		return responses;
+	}
+
+	daemon_response daemon_client::evaluate(const std::string& expression) {
+		return evaluate(std::vector<std::string>{ expression }).front();
+	}
+}
@@ -0,0 +1,87 @@
+#ifndef CALCULATOR_DAEMON_HPP
+#define CALCULATOR_DAEMON_HPP
+
+#include "expression_cache.hpp"
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <list>
+#include <mutex>
+#include <thread>
+
+namespace chr {
+
+	// פ񣺼 Unix ׽֣ЭΪǰ׺֡ΪС򣩣
+	//   uint32  + ʽı
+	//   Ӧuint32  + 1 ֽ״̬ + ݣ״̬ 0 Ϊɹ 8 ֽ double״̬ 1 ΪʧܣǴϢ
+	// ͬһӿͶˮߣӦ˳򷵻
+	constexpr std::uint32_t daemon_max_frame = 1u << 20;
+
+	struct daemon_response {
+		bool ok;
+		double value;
+		std::string error;
+	};
+
+	struct daemon_options {
+		size_t threads = 0;            // ߳0 ʾȡӲ
+		size_t max_batch = 256;        // һϲ
+		size_t cache_capacity = 4096;  // 
+		const function_table* functions = nullptr; // ɵõԶ庯ڼҲ޸
+	};
+
+	class calculator_daemon {
+		// һһζɸɹֵ߳ͨ promise ߳
+		struct pending_batch {
+			std::vector<std::string> requests;
+			std::promise<std::string> responses; // ѱõȫӦ֡
+		};
+		// ߳׽֣׽߳̽ʱŹرգstop() ֻرնдԻ recv
+		struct connection {
+			std::thread thread;
+			std::uintptr_t socket;
+			std::atomic<bool> finished{ false };
+		};
+		std::string m_path;
+		daemon_options m_options;
+		expression_cache m_cache;
+		std::mutex m_mutex;
+		std::condition_variable m_available;
+		std::deque<std::shared_ptr<pending_batch>> m_queue;
+		std::atomic<bool> m_stopping;
+		std::atomic<std::uintptr_t> m_listener; // ׽֣stop() رԽ accept
+		std::mutex m_connection_mutex;
+		std::list<connection> m_connections;
+	private:
+		void serve(connection& client);
+		void reap_connections(bool all);
+		void dispatch();
+		std::string evaluate_requests(const std::vector<std::string>& requests);
+	public:
+		calculator_daemon(std::string path, const daemon_options& options = {});
+		calculator_daemon(const calculator_daemon&) = delete;
+		calculator_daemon& operator=(const calculator_daemon&) = delete;
+		~calculator_daemon();
+		// 󶨲׽ֱ֣ stop() ãǰȴύϡȫ߳̽
+		void run();
+		void stop();
+		const expression_cache& cache() const { return m_cache; }
+	};
+
+	// ׿ͻˣˮ߷ͣÿ鷢ζȡӦ
+	class daemon_client {
+		std::uintptr_t m_socket;
+		std::string m_buffer;
+	public:
+		explicit daemon_client(const std::string& path);
+		daemon_client(const daemon_client&) = delete;
+		daemon_client& operator=(const daemon_client&) = delete;
+		~daemon_client();
+		std::vector<daemon_response> evaluate(const std::vector<std::string>& expressions);
+		daemon_response evaluate(const std::string& expression);
+	};
+}
+
+#endif // !CALCULATOR_DAEMON_HPP
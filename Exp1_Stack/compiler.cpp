@@ -0,0 +1,906 @@
+#include "compiler.hpp"
+#include "fast_math.hpp"
+
+namespace chr {
+	namespace {
+		// ӳ䣨pos ָں׺У
+		opcode to_opcode(op_t op) {
+			switch (op) {
+			case op_t::add: return opcode::add;
+			case op_t::minus: return opcode::minus;
+			case op_t::modulo: return opcode::modulo;
+			case op_t::multiply: return opcode::multiply;
+			case op_t::divide: return opcode::divide;
+			case op_t::negate: return opcode::negate;
+			case op_t::exponent: return opcode::exponent;
+			case op_t::factorial: return opcode::factorial;
+			case op_t::sine: return opcode::sine;
+			case op_t::cosine: return opcode::cosine;
+			case op_t::tangent: return opcode::tangent;
+			case op_t::cotangent: return opcode::cotangent;
+			case op_t::secant: return opcode::secant;
+			case op_t::cosecant: return opcode::cosecant;
+			case op_t::arcsine: return opcode::arcsine;
+			case op_t::arccosine: return opcode::arccosine;
+			case op_t::arctangent: return opcode::arctangent;
+			case op_t::arccotangent: return opcode::arccotangent;
+			case op_t::arcsecant: return opcode::arcsecant;
+			case op_t::arccosecant: return opcode::arccosecant;
+			case op_t::common_logarithm: return opcode::common_logarithm;
+			case op_t::natural_logarithm: return opcode::natural_logarithm;
+			case op_t::square_root: return opcode::square_root;
+			case op_t::cubic_root: return opcode::cubic_root;
+			case op_t::degree: return opcode::degree;
+			case op_t::radian: return opcode::radian;
+			case op_t::square: return opcode::square;
+			default: throw std::runtime_error("ʱ޷תΪָ");
+			}
+		}
+
+		// ÿָջӰ죺ѹջ +1һԪ 0Ԫ -1Ԫ -2 k Ԫԭ 1 - k
+		int stack_effect(opcode code) {
+			switch (code) {
+			case opcode::push_constant: case opcode::load_variable: case opcode::load_temp:
+				return 1;
+			case opcode::add: case opcode::minus: case opcode::modulo:
+			case opcode::multiply: case opcode::divide: case opcode::exponent:
+				return -1;
+			case opcode::multiply_add:
+				return -2;
+			default:
+				return 0;
+			}
+		}
+		int stack_effect(const instruction& ins, std::span<const std::shared_ptr<const native_function>> natives) {
+			return ins.code == opcode::call ? 1 - static_cast<int>(natives[ins.operand]->arity) : stack_effect(ins.code);
+		}
+
+		// ֵѡʵ
+		template <precision Mode, op_t Op>
+		inline double apply(double a, double b = 0) {
+			if constexpr (Mode == precision::fast) {
+				return fast::apply_operator<Op>(a, b);
+			}
+			else {
+				return apply_operator<Op>(a, b);
+			}
+		}
+
+		// ѭsp ָջ֮λãswitch 
+		template <precision Mode>
+		double execute(const instruction* code, size_t size, const double* constants, const double* variables,
+			const std::shared_ptr<const native_function>* natives, double* stack, double* temps) {
+			double* sp = stack;
+			for (const instruction* pc = code; pc != code + size; pc++) {
+				switch (pc->code) {
+				case opcode::push_constant: *sp++ = constants[pc->operand]; break;
+				case opcode::load_variable: *sp++ = variables[pc->operand]; break;
+				case opcode::store_temp: temps[pc->operand] = sp[-1]; break;
+				case opcode::load_temp: *sp++ = temps[pc->operand]; break;
+				case opcode::add: sp[-2] = apply<Mode, op_t::add>(sp[-2], sp[-1]); sp--; break;
+				case opcode::minus: sp[-2] = apply<Mode, op_t::minus>(sp[-2], sp[-1]); sp--; break;
+				case opcode::modulo: sp[-2] = apply<Mode, op_t::modulo>(sp[-2], sp[-1]); sp--; break;
+				case opcode::multiply: sp[-2] = apply<Mode, op_t::multiply>(sp[-2], sp[-1]); sp--; break;
+				case opcode::divide: sp[-2] = apply<Mode, op_t::divide>(sp[-2], sp[-1]); sp--; break;
+				case opcode::exponent: sp[-2] = apply<Mode, op_t::exponent>(sp[-2], sp[-1]); sp--; break;
+				case opcode::negate: sp[-1] = apply<Mode, op_t::negate>(sp[-1]); break;
+				case opcode::factorial: sp[-1] = apply<Mode, op_t::factorial>(sp[-1]); break;
+				case opcode::sine: sp[-1] = apply<Mode, op_t::sine>(sp[-1]); break;
+				case opcode::cosine: sp[-1] = apply<Mode, op_t::cosine>(sp[-1]); break;
+				case opcode::tangent: sp[-1] = apply<Mode, op_t::tangent>(sp[-1]); break;
+				case opcode::cotangent: sp[-1] = apply<Mode, op_t::cotangent>(sp[-1]); break;
+				case opcode::secant: sp[-1] = apply<Mode, op_t::secant>(sp[-1]); break;
+				case opcode::cosecant: sp[-1] = apply<Mode, op_t::cosecant>(sp[-1]); break;
+				case opcode::arcsine: sp[-1] = apply<Mode, op_t::arcsine>(sp[-1]); break;
+				case opcode::arccosine: sp[-1] = apply<Mode, op_t::arccosine>(sp[-1]); break;
+				case opcode::arctangent: sp[-1] = apply<Mode, op_t::arctangent>(sp[-1]); break;
+				case opcode::arccotangent: sp[-1] = apply<Mode, op_t::arccotangent>(sp[-1]); break;
+				case opcode::arcsecant: sp[-1] = apply<Mode, op_t::arcsecant>(sp[-1]); break;
+				case opcode::arccosecant: sp[-1] = apply<Mode, op_t::arccosecant>(sp[-1]); break;
+				case opcode::common_logarithm: sp[-1] = apply<Mode, op_t::common_logarithm>(sp[-1]); break;
+				case opcode::natural_logarithm: sp[-1] = apply<Mode, op_t::natural_logarithm>(sp[-1]); break;
+				case opcode::square_root: sp[-1] = apply<Mode, op_t::square_root>(sp[-1]); break;
+				case opcode::cubic_root: sp[-1] = apply<Mode, op_t::cubic_root>(sp[-1]); break;
+				case opcode::degree: sp[-1] = apply<Mode, op_t::degree>(sp[-1]); break;
+				case opcode::radian: sp[-1] = apply<Mode, op_t::radian>(sp[-1]); break;
+				case opcode::square: sp[-1] = apply<Mode, op_t::square>(sp[-1]); break;
+				case opcode::multiply_add: sp[-3] = std::fma(sp[-3], sp[-2], sp[-1]); sp -= 2; break;
+				case opcode::call: {
+					const native_function& function = *natives[pc->operand];
+					sp -= function.arity;
+					*sp = function.callback({ sp, function.arity });
+					sp++;
+					break;
+				}
+				}
+			}
+			return sp[-1];
+		}
+
+		// powtgamma ֤ȷ tgamma(17)  16!  0.004׼Ľ˶
+		template <op_t Op>
+		bool same_as_double(std::int64_t a, std::int64_t b, std::int64_t r) {
+			return apply_operator<Op>(static_cast<double>(a), static_cast<double>(b)) == static_cast<double>(r);
+		}
+
+		//  execute ͬջ֣κһʧܣĳ nullopt
+		// ֵɵ÷ȼ飬CheckConstants Ϊ false ʱڱڼ
+		// MatchDouble Ϊ true ʱֻ double ͬĽÿһھȷΧڣ^  ! ׼һ
+		template <bool CheckConstants, bool MatchDouble>
+		std::optional<std::int64_t> execute_integer(const instruction* code, size_t size, const double* constants,
+			const double* variables, std::int64_t* stack, std::int64_t* temps) {
+			std::int64_t* sp = stack;
+			for (const instruction* pc = code; pc != code + size; pc++) {
+				bool ok = true;
+				switch (pc->code) {
+				case opcode::push_constant:
+					if constexpr (CheckConstants) {
+						ok = is_exact_integer(constants[pc->operand]);
+					}
+					*sp++ = ok ? static_cast<std::int64_t>(constants[pc->operand]) : 0;
+					break;
+				case opcode::load_variable: *sp++ = static_cast<std::int64_t>(variables[pc->operand]); break;
+				case opcode::store_temp: temps[pc->operand] = sp[-1]; break;
+				case opcode::load_temp: *sp++ = temps[pc->operand]; break;
+				case opcode::add: ok = checked_add(sp[-2], sp[-1], sp[-2]); sp--; break;
+				case opcode::minus: ok = checked_subtract(sp[-2], sp[-1], sp[-2]); sp--; break;
+				case opcode::multiply: ok = checked_multiply(sp[-2], sp[-1], sp[-2]); sp--; break;
+				case opcode::modulo: ok = checked_modulo(sp[-2], sp[-1], sp[-2]); sp--; break;
+				case opcode::exponent: {
+					const std::int64_t base = sp[-2], power = sp[-1];
+					ok = checked_power(base, power, sp[-2]);
+					if constexpr (MatchDouble) {
+						ok = ok && same_as_double<op_t::exponent>(base, power, sp[-2]);
+					}
+					sp--;
+					break;
+				}
+				case opcode::negate: ok = checked_subtract(0, sp[-1], sp[-1]); break;
+				case opcode::factorial: {
+					const std::int64_t operand = sp[-1];
+					ok = checked_factorial(operand, sp[-1]);
+					if constexpr (MatchDouble) {
+						ok = ok && same_as_double<op_t::factorial>(operand, 0, sp[-1]);
+					}
+					break;
+				}
+				case opcode::square: ok = checked_multiply(sp[-1], sp[-1], sp[-1]); break;
+				case opcode::multiply_add:
+					ok = checked_multiply(sp[-3], sp[-2], sp[-3]) && checked_add(sp[-3], sp[-1], sp[-3]);
+					sp -= 2;
+					break;
+				default:
+					ok = false;
+					break;
+				}
+				if constexpr (MatchDouble) {
+					// ȷΧڵ + - * % ˼Ӻ double Ľͬ double 
+					ok = ok && sp[-1] > -exact_integer_bound && sp[-1] < exact_integer_bound;
+				}
+				if (!ok) {
+					return std::nullopt;
+				}
+			}
+			return sp[-1];
+		}
+		// ж򣺳Ǿȷ㶼գֵֵʱ飩
+		bool integer_program(std::span<const instruction> code, std::span<const double> constants) {
+			return std::all_of(code.begin(), code.end(), [constants](const instruction& ins) {
+				switch (ins.code) {
+				case opcode::push_constant:
+					return is_exact_integer(constants[ins.operand]);
+				case opcode::load_variable: case opcode::store_temp: case opcode::load_temp:
+				case opcode::add: case opcode::minus: case opcode::multiply: case opcode::modulo:
+				case opcode::exponent: case opcode::negate: case opcode::factorial: case opcode::square:
+				case opcode::multiply_add:
+					return true;
+				default:
+					return false;
+				}
+			});
+		}
+
+		// Ƿһ£
+		std::string_view mnemonic(opcode code) {
+			static constexpr std::string_view names[] = {
+				"push", "load", "store_temp", "load_temp", "+", "-", "%", "*", "/", "neg", "^", "!",
+				"sin", "cos", "tan", "cot", "sec", "csc",
+				"arcsin", "arccos", "arctan", "arccot", "arcsec", "arccsc",
+				"lg", "ln", "sqrt", "cbrt", "deg", "rad", "sqr", "fma", "call",
+			};
+			return names[static_cast<byte>(code)];
+		}
+
+		// ʽvariable Ϊλnpos ʾcoefficients[k] Ϊ x^k ϵ
+		struct polynomial {
+			std::uint32_t variable;
+			std::vector<double> coefficients;
+			size_t degree() const { return coefficients.size() - 1; }
+			bool is_monomial() const {
+				return std::count_if(coefficients.begin(), coefficients.end(), [](double c) { return c != 0; }) <= 1;
+			}
+			bool is_zero() const {
+				return std::all_of(coefficients.begin(), coefficients.end(), [](double c) { return c == 0; });
+			}
+		};
+		constexpr size_t polynomial_max_degree = 32;
+		constexpr size_t estrin_min_degree = 5; // ﵽֵʱ Estrin̳˼ӵ
+
+		// ʽܷϲͬһΪ
+		std::optional<std::uint32_t> common_variable(const polynomial& a, const polynomial& b) {
+			if (a.variable == expression_dag::npos || b.variable == expression_dag::npos || a.variable == b.variable) {
+				return std::min(a.variable, b.variable);
+			}
+			return std::nullopt;
+		}
+
+		// ϲϵܷ 0 ʱһʱһ
+		// x Ϊ infNaN 0ʱдĽԭʽͬ x^3-x^3+1  inf ԭʽΪ NaN
+		bool keeps_terms(double coefficient, bool from_nonzero) {
+			return std::isfinite(coefficient) && (coefficient != 0 || !from_nonzero);
+		}
+
+		// ӽĶʽʽƳʽֻʶչʽӼȡʽˡ
+		// ʽķǸݣչ (x+1)^n ֮ĳ˻µ
+		// ϵΪ 0 ȻıֵβΪʽ
+		std::optional<polynomial> combine(const token& op, const polynomial* a, const polynomial* b) {
+			switch (op.operator_id()) {
+			case op_t::add:
+			case op_t::minus: {
+				auto variable = common_variable(*a, *b);
+				if (!variable) {
+					return std::nullopt;
+				}
+				polynomial r{ *variable, std::vector<double>(std::max(a->coefficients.size(), b->coefficients.size())) };
+				for (size_t k = 0; k < a->coefficients.size(); k++) {
+					r.coefficients[k] = a->coefficients[k];
+				}
+				for (size_t k = 0; k < b->coefficients.size(); k++) {
+					r.coefficients[k] += op.operator_id() == op_t::add ? b->coefficients[k] : -b->coefficients[k];
+					if (!keeps_terms(r.coefficients[k], b->coefficients[k] != 0)) {
+						return std::nullopt;
+					}
+				}
+				return r;
+			}
+			case op_t::negate: {
+				polynomial r = *a;
+				for (double& c : r.coefficients) {
+					c = -c;
+				}
+				return r;
+			}
+			case op_t::multiply: {
+				auto variable = common_variable(*a, *b);
+				if (!variable || !(a->is_monomial() || b->is_monomial()) || a->degree() + b->degree() > polynomial_max_degree) {
+					return std::nullopt;
+				}
+				// 0*x  x Ϊ inf ʱ NaNܵʽ
+				if ((a->is_zero() && b->degree() > 0) || (b->is_zero() && a->degree() > 0)) {
+					return std::nullopt;
+				}
+				polynomial r{ *variable, std::vector<double>(a->degree() + b->degree() + 1) };
+				for (size_t i = 0; i < a->coefficients.size(); i++) {
+					for (size_t j = 0; j < b->coefficients.size(); j++) {
+						double product = a->coefficients[i] * b->coefficients[j];
+						if (!keeps_terms(product, a->coefficients[i] != 0 && b->coefficients[j] != 0)) {
+							return std::nullopt;
+						}
+						r.coefficients[i + j] += product;
+					}
+				}
+				return r;
+			}
+			case op_t::square:
+			case op_t::exponent: {
+				double n = op.operator_id() == op_t::square ? 2 : b->variable == expression_dag::npos ? b->coefficients[0] : -1;
+				if (!a->is_monomial() || n < 0 || n != std::floor(n) || a->degree() * n > polynomial_max_degree) {
+					return std::nullopt;
+				}
+				size_t power = static_cast<size_t>(n);
+				polynomial r{ a->variable, std::vector<double>(a->degree() * power + 1) };
+				r.coefficients.back() = std::pow(a->coefficients.back(), n);
+				if (!keeps_terms(r.coefficients.back(), a->coefficients.back() != 0)) {
+					return std::nullopt;
+				}
+				return r;
+			}
+			default:
+				return std::nullopt;
+			}
+		}
+
+		// Եϣ±꼴ÿĶʽʽǶʽĽΪ nullopt
+		std::vector<std::optional<polynomial>> find_polynomials(const expression_dag& dag) {
+			const auto& nodes = dag.nodes();
+			std::vector<std::optional<polynomial>> result(nodes.size());
+			for (size_t i = 0; i < nodes.size(); i++) {
+				const auto& n = nodes[i];
+				if (n.tk.is_number()) {
+					result[i] = polynomial{ expression_dag::npos, { n.tk.number_value() } };
+				}
+				else if (n.tk.is_variable()) {
+					result[i] = polynomial{ n.tk.variable_slot(), { 0, 1 } };
+				}
+				else {
+					const polynomial* a = result[n.left] ? &*result[n.left] : nullptr;
+					const polynomial* b = n.right != expression_dag::npos && result[n.right] ? &*result[n.right] : nullptr;
+					if (a && (n.right == expression_dag::npos || b)) {
+						result[i] = combine(n.tk, a, b);
+					}
+				}
+				// ȥϲΪߴ
+				while (result[i] && result[i]->coefficients.size() > 1 && result[i]->coefficients.back() == 0) {
+					result[i]->coefficients.pop_back();
+				}
+			}
+			return result;
+		}
+	}
+
+	// ϣ//ıʶӽ±϶ɣͻʱȽϽṹ
+	std::uint32_t expression_dag::intern(const token& tk, std::uint32_t left, std::uint32_t right,
+		std::unordered_map<std::uint64_t, std::vector<std::uint32_t>>& table) {
+		if (tk.is_operator() && (tk.operator_id() == op_t::add || tk.operator_id() == op_t::multiply) && right < left) {
+			std::swap(left, right);
+		}
+		// ıʶλͬԭĵòܺϲ
+		std::uint64_t identity = tk.is_number() ? std::bit_cast<std::uint64_t>(tk.number_value())
+			: tk.is_variable() ? tk.variable_slot() : static_cast<std::uint64_t>(tk.operator_id()) | std::uint64_t(tk.variable_slot()) << 8;
+		std::uint64_t key = identity * 0x9E3779B97F4A7C15ull ^ static_cast<std::uint64_t>(tk.type());
+		key = (key ^ left) * 0xC2B2AE3D27D4EB4Full;
+		key = (key ^ right) * 0x165667B19E3779F9ull;
+		auto& bucket = table[key];
+		for (std::uint32_t index : bucket) {
+			const node& n = m_nodes[index];
+			if (n.tk.type() == tk.type() && n.left == left && n.right == right
+				&& (tk.is_number() ? std::bit_cast<std::uint64_t>(n.tk.number_value()) == identity
+					: tk.is_variable() ? n.tk.variable_slot() == tk.variable_slot()
+					: n.tk.operator_id() == tk.operator_id() && n.tk.variable_slot() == tk.variable_slot())) {
+				return index;
+			}
+		}
+		m_nodes.push_back({ tk, left, right, 0 });
+		if (left != npos) {
+			m_nodes[left].uses++;
+		}
+		if (right != npos) {
+			m_nodes[right].uses++;
+		}
+		bucket.push_back(static_cast<std::uint32_t>(m_nodes.size() - 1));
+		return bucket.back();
+	}
+
+	// ׺˳ͼջŽ±꣨pos 㣩
+	expression_dag::expression_dag(const std::vector<token>& postfix) {
+		std::unordered_map<std::uint64_t, std::vector<std::uint32_t>> table;
+		std::vector<std::uint32_t> operands;
+		m_nodes.reserve(postfix.size());
+		for (const auto& tk : postfix) {
+			if (!tk.is_operator()) {
+				operands.push_back(intern(tk, npos, npos, table));
+				continue;
+			}
+			if (tk.operator_id() == op_t::posite) {
+				continue;
+			}
+			if (tk.operator_operand_num() == 0 || operands.size() < tk.operator_operand_num()) {
+				throw std::runtime_error("ʱȱٲ");
+			}
+			std::uint32_t right = npos;
+			if (tk.operator_operand_num() == 2) {
+				right = operands.back();
+				operands.pop_back();
+			}
+			operands.back() = intern(tk, operands.back(), right, table);
+		}
+		if (operands.size() != 1) {
+			throw std::runtime_error("ʱջֻһԪ");
+		}
+		m_root = operands.back();
+		m_nodes[m_root].uses++;
+	}
+
+	size_t expression_dag::shared_count() const {
+		return std::count_if(m_nodes.begin(), m_nodes.end(), [](const node& n) {
+			return n.uses > 1 && n.tk.is_operator() && n.tk.operator_id() != op_t::comma;
+		});
+	}
+
+	//  DAG ָһμʱλֻ֮ȡ
+	// ֽ㸴ͬһ±ꡣʹʽջʽݹ
+	void compiled_expression::lower(const expression_dag& dag) {
+		const auto& nodes = dag.nodes();
+		const auto polynomials = find_polynomials(dag);
+		std::vector<std::uint32_t> location(nodes.size(), expression_dag::npos); // ʱλ±
+		std::vector<std::pair<std::uint32_t, bool>> pending{ { dag.root(), false } };
+		while (!pending.empty()) {
+			auto [index, expanded] = pending.back();
+			pending.pop_back();
+			const auto& n = nodes[index];
+			if (n.tk.is_number()) {
+				if (location[index] == expression_dag::npos) {
+					location[index] = static_cast<std::uint32_t>(m_constants.size());
+					m_constants.push_back(n.tk.number_value());
+				}
+				m_code.push_back({ opcode::push_constant, location[index] });
+			}
+			else if (n.tk.is_variable()) {
+				m_code.push_back({ opcode::load_variable, n.tk.variable_slot() });
+			}
+			else if (location[index] != expression_dag::npos) {
+				m_code.push_back({ opcode::load_temp, location[index] });
+			}
+			else if (!expanded && polynomials[index] && polynomials[index]->variable != expression_dag::npos
+				&& polynomials[index]->degree() >= 2 && !polynomials[index]->is_monomial()) {
+				// Ķʽ㼴ΪĶʽдʽԭ
+				emit_polynomial(polynomials[index]->variable, polynomials[index]->coefficients);
+				if (n.uses > 1) {
+					location[index] = static_cast<std::uint32_t>(m_temp_count++);
+					m_code.push_back({ opcode::store_temp, location[index] });
+				}
+			}
+			else if (!expanded) {
+				pending.push_back({ index, true });
+				if (n.right != expression_dag::npos) {
+					pending.push_back({ n.right, false });
+				}
+				pending.push_back({ n.left, false });
+			}
+			else if (n.tk.operator_id() == op_t::comma) {
+				// ʵ֮ӽ㲻ָҲʱλʱʵѸԸã
+			}
+			else {
+				op_t op = n.tk.operator_id();
+				m_code.push_back(op == op_t::call ? instruction{ opcode::call, n.tk.variable_slot() } : instruction{ to_opcode(op), 0 });
+				if (n.uses > 1) {
+					location[index] = static_cast<std::uint32_t>(m_temp_count++);
+					m_code.push_back({ opcode::store_temp, location[index] });
+				}
+			}
+		}
+	}
+
+	// Horner((a_n * x + a_{n-1}) * x + ...) * x + a_0ÿһһ˼ָϵΪʱֻˣ
+	void compiled_expression::emit_polynomial(std::uint32_t variable, std::span<const double> coefficients) {
+		auto push = [this](double value) {
+			m_code.push_back({ opcode::push_constant, static_cast<std::uint32_t>(m_constants.size()) });
+			m_constants.push_back(value);
+		};
+		size_t degree = coefficients.size() - 1;
+		if (degree >= estrin_min_degree) {
+			size_t count = 1;
+			while (count < coefficients.size()) {
+				count *= 2;
+			}
+			std::vector<std::uint32_t> powers; // powers[i] Ϊ x^(2^(i+1)) ڵʱλ
+			emit_estrin(variable, coefficients, 0, count, powers);
+			return;
+		}
+		push(coefficients[degree]);
+		for (size_t k = degree; k-- > 0;) {
+			m_code.push_back({ opcode::load_variable, variable });
+			if (coefficients[k] == 0) {
+				m_code.push_back({ opcode::multiply, 0 }); // ϵΪʱʡȥӷ
+				continue;
+			}
+			push(coefficients[k]);
+			m_code.push_back({ opcode::multiply_add, 0 });
+		}
+	}
+
+	// Estrin [low, low + count) ϵֳɸߵ룬Ϊ ߰ * x^(count/2) + Ͱ룬
+	// 뻥x ĸηݵһõʱƽõʱλ
+	void compiled_expression::emit_estrin(std::uint32_t variable, std::span<const double> coefficients, size_t low, size_t count,
+		std::vector<std::uint32_t>& powers) {
+		auto push = [this](double value) {
+			m_code.push_back({ opcode::push_constant, static_cast<std::uint32_t>(m_constants.size()) });
+			m_constants.push_back(value);
+		};
+		if (count == 1) {
+			push(coefficients[low]);
+			return;
+		}
+		size_t half = count / 2;
+		if (low + half >= coefficients.size()) {
+			emit_estrin(variable, coefficients, low, half, powers);
+			return;
+		}
+		emit_estrin(variable, coefficients, low + half, half, powers);
+		// ѹ x^halfhalf Ϊ 2 ݣx^(2^i) еߴηƽõ
+		size_t level = std::countr_zero(half);
+		if (level == 0) {
+			m_code.push_back({ opcode::load_variable, variable });
+		}
+		else if (level <= powers.size()) {
+			m_code.push_back({ opcode::load_temp, powers[level - 1] });
+		}
+		else {
+			if (powers.empty()) {
+				m_code.push_back({ opcode::load_variable, variable });
+			}
+			else {
+				m_code.push_back({ opcode::load_temp, powers.back() });
+			}
+			while (powers.size() < level) {
+				m_code.push_back({ opcode::square, 0 });
+				powers.push_back(static_cast<std::uint32_t>(m_temp_count++));
+				m_code.push_back({ opcode::store_temp, powers.back() });
+			}
+		}
+		if (std::all_of(coefficients.begin() + low, coefficients.begin() + low + half, [](double c) { return c == 0; })) {
+			m_code.push_back({ opcode::multiply, 0 });
+			return;
+		}
+		emit_estrin(variable, coefficients, low, half, powers);
+		m_code.push_back({ opcode::multiply_add, 0 });
+	}
+
+	// 룺 DAG ָͬʱģջõȲǷƽ
+	compiled_expression::compiled_expression(const expression& expr)
+		:m_variables(expr.variables()), m_natives(expr.natives()), m_max_depth(0), m_temp_count(0), m_integer(false) {
+		m_code.reserve(expr.postfix().size());
+		lower(expression_dag(expr.postfix()));
+		int depth = 0;
+		for (const auto& ins : m_code) {
+			int effect = stack_effect(ins, m_natives);
+			if (effect <= 0 && depth < 1 - effect) {
+				throw std::runtime_error("ʱȱٲ");
+			}
+			depth += effect;
+			m_max_depth = std::max(m_max_depth, static_cast<size_t>(depth));
+		}
+		if (depth != 1) {
+			throw std::runtime_error("ʱջֻһԪ");
+		}
+		m_integer = integer_program(m_code, m_constants);
+	}
+
+	namespace {
+		// ֿʷֻδѵβ¶һ飬
+		// token ܿԽ߽磬ƥ໺ĩβ 2 ַʮָǰ׺ǰհʱȲƥ
+		class chunked_lexer {
+			std::istream& m_in;
+			std::string m_buffer;
+			size_t m_pos;      // ڵĶȡλ
+			size_t m_consumed; // Ѷֽm_buffer[0] еƫƣ
+			size_t m_chunk;
+			bool m_eof;
+		public:
+			chunked_lexer(std::istream& in, size_t chunk) :m_in(in), m_pos(0), m_consumed(0), m_chunk(std::max<size_t>(chunk, 16)), m_eof(false) {}
+			// ȡһ tokentext ָ򻺳һεǰЧ޷ʶַ invalid_token 
+			std::optional<lexeme> next(std::string_view& text) {
+				while (true) {
+					while (m_pos < m_buffer.size() && std::isspace(static_cast<byte>(m_buffer[m_pos]))) {
+						m_pos++;
+					}
+					if (m_pos == m_buffer.size()) {
+						if (m_eof) {
+							return std::nullopt;
+						}
+						fill();
+						continue;
+					}
+					token_t type = token_t::invalid_token;
+					size_t len = expression_lexer::match(m_buffer, m_pos, type);
+					if (!m_eof && m_pos + len + 2 >= m_buffer.size()) {
+						fill();
+						continue;
+					}
+					if (len == 0) {
+						type = token_t::invalid_token;
+						len = 1;
+					}
+					lexeme lex{ type, m_consumed + m_pos, len };
+					text = std::string_view(m_buffer).substr(m_pos, len);
+					m_pos += len;
+					return lex;
+				}
+			}
+			size_t offset() const { return m_consumed + m_pos; }
+		private:
+			// ѵǰ׺׷Ӷһ
+			void fill() {
+				m_buffer.erase(0, m_pos);
+				m_consumed += m_pos;
+				m_pos = 0;
+				size_t size = m_buffer.size();
+				m_buffer.resize(size + m_chunk);
+				m_in.read(m_buffer.data() + size, static_cast<std::streamsize>(m_chunk));
+				m_buffer.resize(size + static_cast<size_t>(m_in.gcount()));
+				m_eof = m_in.gcount() == 0;
+			}
+		};
+
+		// ʽ Shunting-yardջֻ op_tջʱָ
+		// ȼ Pratt һ£ͬϣpos/neg  ^  !壩
+		class stream_compiler {
+			chunked_lexer m_lexer;
+			std::vector<instruction>& m_code;
+			std::vector<double>& m_constants;
+			std::vector<std::string>& m_variables;
+			std::vector<op_t> m_operators;
+			size_t m_depth;
+			size_t& m_max_depth;
+		public:
+			stream_compiler(std::istream& in, size_t chunk, std::vector<instruction>& code, std::vector<double>& constants,
+				std::vector<std::string>& variables, size_t& max_depth)
+				:m_lexer(in, chunk), m_code(code), m_constants(constants), m_variables(variables), m_depth(0), m_max_depth(max_depth) {}
+			void compile() {
+				bool expect_operand = true; // һ token ӦΪǰ׺
+				bool after_sign = false;
+				bool need_group = false;    // һ token Ǻ
+				std::string_view str;
+				while (auto lex = m_lexer.next(str)) {
+					if (lex->type == token_t::invalid_token) {
+						fail(lex->offset, "޷ʶַ");
+					}
+					if (need_group && str != "(") {
+						fail(lex->offset, "δ");
+					}
+					need_group = false;
+					if (expect_operand) {
+						bool sign = str == "+" || str == "-";
+						if (token_t::number_token & lex->type) {
+							push_operand(lex->type, str);
+							expect_operand = false;
+						}
+						else if (str == "(") {
+							m_operators.push_back(op_t::left_parentheses);
+						}
+						else if (sign) {
+							if (after_sign) {
+								fail(lex->offset, "ʽ");
+							}
+							m_operators.push_back(str == "+" ? op_t::posite : op_t::negate);
+						}
+						else if (lex->type == token_t::function_operator) {
+							m_operators.push_back(token::try_parse_operator(str)->operator_id());
+							need_group = true;
+						}
+						else {
+							fail(lex->offset, "ȱٲ");
+						}
+						after_sign = sign;
+					}
+					else if (str == ")") {
+						while (!m_operators.empty() && m_operators.back() != op_t::left_parentheses) {
+							pop_operator();
+						}
+						if (m_operators.empty()) {
+							fail(lex->offset, "ڶ token");
+						}
+						m_operators.pop_back();
+						if (!m_operators.empty() && operator_info(m_operators.back()).priority == PRIORITY_FUNCTION) {
+							pop_operator();
+						}
+					}
+					else if (str == ",") {
+						fail(lex->offset, "ʽ벻ֶ֧ĺ");
+					}
+					else if (lex->type == token_t::normal_operator && str != "(") {
+						op_t op = token::try_parse_operator(str)->operator_id();
+						byte priority = operator_info(op).priority;
+						while (!m_operators.empty() && m_operators.back() != op_t::left_parentheses
+							&& operator_info(m_operators.back()).priority >= priority) {
+							pop_operator();
+						}
+						// ׳Ǻ׺ȼ
+						if (op == op_t::factorial) {
+							emit(op);
+						}
+						else {
+							m_operators.push_back(op);
+							expect_operand = true;
+						}
+					}
+					else {
+						bool open = std::find(m_operators.begin(), m_operators.end(), op_t::left_parentheses) != m_operators.end();
+						fail(lex->offset, open ? "ڶ" : "ڶ token");
+					}
+				}
+				if (need_group) {
+					fail(m_lexer.offset(), "δ");
+				}
+				if (expect_operand) {
+					fail(m_lexer.offset(), "ʽβ");
+				}
+				while (!m_operators.empty()) {
+					if (m_operators.back() == op_t::left_parentheses) {
+						fail(m_lexer.offset(), "ڶ");
+					}
+					pop_operator();
+				}
+			}
+		private:
+			[[noreturn]] void fail(size_t offset, const std::string& description) const {
+				throw std::runtime_error("ʽǷ\n" + std::to_string(offset) + "" + description);
+			}
+			void push(instruction ins) {
+				m_code.push_back(ins);
+				m_max_depth = std::max(m_max_depth, ++m_depth);
+			}
+			void push_operand(token_t type, std::string_view str) {
+				if (type == token_t::variable_number) {
+					auto it = std::find(m_variables.begin(), m_variables.end(), str);
+					if (it == m_variables.end()) {
+						m_variables.emplace_back(str);
+						it = m_variables.end() - 1;
+					}
+					push({ opcode::load_variable, static_cast<std::uint32_t>(it - m_variables.begin()) });
+					return;
+				}
+				push({ opcode::push_constant, static_cast<std::uint32_t>(m_constants.size()) });
+				m_constants.push_back(token::parse_number(str, type));
+			}
+			void pop_operator() {
+				emit(m_operators.back());
+				m_operators.pop_back();
+			}
+			// ָǸѹĳʱֱ۵ÿռĩβһ۵һգ
+			void emit(op_t op) {
+				if (op == op_t::posite) {
+					return;
+				}
+				const operator_data& info = operator_info(op);
+				size_t size = m_code.size();
+				if (info.operand_num == 1 && size >= 1 && m_code[size - 1].code == opcode::push_constant) {
+					if (auto value = fold_constant(op, m_constants.back())) {
+						m_constants.back() = *value;
+						return;
+					}
+				}
+				if (info.operand_num == 2) {
+					m_depth--;
+					if (size >= 2 && m_code[size - 1].code == opcode::push_constant && m_code[size - 2].code == opcode::push_constant) {
+						if (auto value = fold_constant(op, m_constants[m_constants.size() - 2], m_constants.back())) {
+							m_constants[m_constants.size() - 2] = *value;
+							m_constants.pop_back();
+							m_code.pop_back();
+							return;
+						}
+					}
+				}
+				m_code.push_back({ to_opcode(op), 0 });
+			}
+		};
+	}
+
+	// ʽ룺׺׺У򻺳ڽʱʵʴС
+	compiled_expression compiled_expression::compile_stream(std::istream& in, size_t chunk_size) {
+		compiled_expression program;
+		stream_compiler(in, chunk_size, program.m_code, program.m_constants, program.m_variables, program.m_max_depth).compile();
+		program.m_code.shrink_to_fit();
+		program.m_constants.shrink_to_fit();
+		program.m_integer = integer_program(program.m_code, program.m_constants);
+		return program;
+	}
+
+	namespace {
+		template <bool CheckConstants, bool MatchDouble>
+		std::optional<std::int64_t> run_integer(const program_view& program, std::span<const double> slots) {
+			if (slots.size() < program.variable_count) {
+				throw std::runtime_error("ʽδ󶨵ı");
+			}
+			if (!std::all_of(slots.begin(), slots.begin() + program.variable_count, [](double x) { return is_exact_integer(x); })) {
+				return std::nullopt;
+			}
+			constexpr size_t local_capacity = 64;
+			std::int64_t local[local_capacity];
+			std::unique_ptr<std::int64_t[]> heap;
+			std::int64_t* stack = local;
+			const size_t size = program.max_depth + program.temp_count;
+			if (size > local_capacity) {
+				heap.reset(new std::int64_t[size]);
+				stack = heap.get();
+			}
+			return execute_integer<CheckConstants, MatchDouble>(program.code.data(), program.code.size(), program.constants.data(),
+				slots.data(), stack, stack + program.max_depth);
+		}
+	}
+
+	double compiled_expression::evaluate() const {
+		return evaluate(std::span<const double>());
+	}
+
+	double compiled_expression::evaluate(variable_binding bindings, precision mode) const {
+		std::vector<double> slots = bind_variables(m_variables, bindings);
+		return evaluate(slots, mode);
+	}
+
+	double compiled_expression::evaluate(std::span<const double> slots, precision mode) const {
+		if (m_integer && mode == precision::exact) {
+			// ·ֻ double ֵͬʱã㲻ַţdouble ܵõ -0 x%-10*-5
+			// Ϊʱͬ double ֵ
+			if (auto value = run_integer<false, true>(view(), slots); value && *value != 0) {
+				return static_cast<double>(*value);
+			}
+		}
+		return view().evaluate(slots, mode);
+	}
+
+	std::optional<std::int64_t> compiled_expression::evaluate_integer(std::span<const double> slots) const {
+		return m_integer ? run_integer<false, false>(view(), slots) : std::nullopt;
+	}
+
+	// ֵջʱλһ黺ϼƲ 64 ʱʹջ飬һ
+	double program_view::evaluate(std::span<const double> slots, precision mode) const {
+		if (slots.size() < variable_count) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		constexpr size_t local_capacity = 64;
+		double local[local_capacity];
+		std::unique_ptr<double[]> heap;
+		double* stack = local;
+		if (max_depth + temp_count > local_capacity) {
+			heap.reset(new double[max_depth + temp_count]);
+			stack = heap.get();
+		}
+		auto run = mode == precision::fast ? execute<precision::fast> : execute<precision::exact>;
+		return run(code.data(), code.size(), constants.data(), slots.data(), natives.data(), stack, stack + max_depth);
+	}
+
+	std::optional<std::int64_t> program_view::evaluate_integer(std::span<const double> slots) const {
+		return run_integer<true, false>(*this, slots);
+	}
+
+	// ģִһ飺ȡʱλǰдջԽ max_depthʱǡʣһֵ
+	void program_view::verify() const {
+		// ÿָѹһֵдһʱλջλᳬָ
+		if (max_depth > code.size() || temp_count > code.size()) {
+			throw std::runtime_error("ջʱλ");
+		}
+		std::vector<bool> stored(temp_count);
+		size_t depth = 0;
+		for (const auto& ins : code) {
+			if (static_cast<byte>(ins.code) > static_cast<byte>(opcode::call)) {
+				throw std::runtime_error("ЧĲ");
+			}
+			bool in_range = ins.code == opcode::push_constant ? ins.operand < constants.size()
+				: ins.code == opcode::load_variable ? ins.operand < variable_count
+				: ins.code == opcode::store_temp ? ins.operand < temp_count
+				: ins.code == opcode::load_temp ? ins.operand < temp_count && stored[ins.operand]
+				: ins.code == opcode::call ? ins.operand < natives.size()
+				: true;
+			if (!in_range) {
+				throw std::runtime_error("ָԽ");
+			}
+			int effect = stack_effect(ins, natives);
+			if (static_cast<int>(depth) < (effect > 0 ? 0 : 1 - effect)) {
+				throw std::runtime_error("ȱٲ");
+			}
+			depth += effect;
+			if (depth > max_depth) {
+				throw std::runtime_error("ջֵ");
+			}
+			if (ins.code == opcode::store_temp) {
+				stored[ins.operand] = true;
+			}
+		}
+		if (depth != 1) {
+			throw std::runtime_error("ʱջֻһԪ");
+		}
+	}
+
+	// ָ嵥ÿһšǷ
+	std::string compiled_expression::to_string() const {
+		std::ostringstream oss;
+		for (size_t i = 0; i < m_code.size(); i++) {
+			oss << i << '\t' << mnemonic(m_code[i].code);
+			if (m_code[i].code == opcode::push_constant) {
+				oss << '\t' << m_constants[m_code[i].operand];
+			}
+			else if (m_code[i].code == opcode::load_variable) {
+				oss << '\t' << m_variables[m_code[i].operand];
+			}
+			else if (m_code[i].code == opcode::store_temp || m_code[i].code == opcode::load_temp) {
+				oss << "\tt" << m_code[i].operand;
+			}
+			else if (m_code[i].code == opcode::call) {
+				oss << '\t' << m_natives[m_code[i].operand]->name;
+			}
+			oss << '\n';
+		}
+		return oss.str();
+	}
+}
@@ -0,0 +1,137 @@
+#ifndef COMPILER_HPP
+#define COMPILER_HPP
+
+#include "calculator.hpp"
+
+#include <bit>
+#include <cstdint>
+
+namespace chr {
+
+	// ֽ룺ѹջָ⣬ operator_table вһһӦ
+	enum class opcode : byte {
+		push_constant,     // ѹ볣еoperand Ϊ±꣩
+		load_variable,     // ѹλеֵoperand Ϊλ
+		store_temp,        // ջƵʱλջoperand Ϊʱλ
+		load_temp,         // ѹʱλеֵoperand Ϊʱλ
+		add, minus, modulo, multiply, divide, negate, exponent, factorial,
+		sine, cosine, tangent, cotangent, secant, cosecant,
+		arcsine, arccosine, arctangent, arccotangent, arcsecant, arccosecant,
+		common_logarithm, natural_logarithm, square_root, cubic_root,
+		degree, radian, square,
+		multiply_add,      // Ԫa * b + c루ʽֵʹã
+		call               // ԭoperand Ϊ±꣩ȡĲɺ
+	};
+
+	// ֵȣexact  operator_table һ£ֵʹñ׼⣻evaluate_batch  sin/cos/tan/ln/lg/pow ʹ
+	// simd.hpp еʵ֣ 3 ULPֵ֤λͬpow  |bln a| > 16 ʱͨ std::pow
+	// fast ʹõʹζʽƣ fast_math.hpp 1e-7Խ׳ݿʺؿһĴֵ
+	enum class precision : byte { exact, fast };
+
+	// ֵͳƣ飨1024 Уƣdouble_blocks ΪжȲȫ˫ȼĿ
+	struct float_batch_stats {
+		size_t blocks = 0;
+		size_t double_blocks = 0;
+	};
+
+	// ָ + 32 λ±ꡢλʱλȣ
+	struct instruction {
+		opcode code;
+		std::uint32_t operand;
+	};
+
+	// ͼݣָֻ볣أָ compiled_expression
+	// Ҳָӳ䵽ڴеĶƾ񣨼 program_image.hppֵκθ
+	struct program_view {
+		std::span<const instruction> code;
+		std::span<const double> constants;
+		std::span<const std::shared_ptr<const native_function>> natives;
+		size_t variable_count;
+		size_t max_depth;
+		size_t temp_count;
+		double evaluate(std::span<const double> slots, precision mode = precision::exact) const;
+		//  64 λֵֵǾȷֵС 2^53ֻжյʱ
+		// Ǿȷģ㡢ֵ縺ָʱ nullopt
+		std::optional<std::int64_t> evaluate_integer(std::span<const double> slots) const;
+		// 롢Χջƽ⣨ջ max_depthϷʱ׳쳣
+		// ⲿĳֵǰ뾭
+		void verify() const;
+	};
+
+	// ʽ DAG׺ԵϽ㣬ṹͬϣͬһ㣨hash-consing
+	// +  * ӽ㰴±a+b  b+a Ҳܹ
+	class expression_dag {
+	public:
+		static constexpr std::uint32_t npos = UINT32_MAX;
+		struct node {
+			token tk;            // ֡
+			std::uint32_t left;  // ӽ±꣬Ϊ npos
+			std::uint32_t right;
+			std::uint32_t uses;  // ô 1
+		};
+	private:
+		std::vector<node> m_nodes; // ӽڸ֮ǰ
+		std::uint32_t m_root;
+	private:
+		std::uint32_t intern(const token& tk, std::uint32_t left, std::uint32_t right,
+			std::unordered_map<std::uint64_t, std::vector<std::uint32_t>>& table);
+	public:
+		explicit expression_dag(const std::vector<token>& postfix);
+		const std::vector<node>& nodes() const { return m_nodes; }
+		std::uint32_t root() const { return m_root; }
+		size_t shared_count() const; // ദõ
+	};
+
+	// ıʽָ볣أջڱȷֵʱκζѷ
+	class compiled_expression {
+		std::vector<instruction> m_code;
+		std::vector<double> m_constants;
+		std::vector<std::string> m_variables; // ±꼴λ
+		native_list m_natives;                // ԭ±꼴 call ָĲ
+		size_t m_max_depth;
+		size_t m_temp_count; // ʱλDAG ÿռһ
+		bool m_integer;      // жֻȷյ㣬԰ 64 λֵ
+	private:
+		void lower(const expression_dag& dag);
+		// ʽֵcoefficients[k] Ϊ x^k ϵʹ Hornerߴ Estrin
+		void emit_polynomial(std::uint32_t variable, std::span<const double> coefficients);
+		void emit_estrin(std::uint32_t variable, std::span<const double> coefficients, size_t low, size_t count,
+			std::vector<std::uint32_t>& powers);
+		compiled_expression() :m_max_depth(0), m_temp_count(0), m_integer(false) {} // ʽ
+	public:
+		//  DAG 룺ӱʽֻһΣʱλֱӶȡ
+		// ʽдΪ Horner/Estrin ʽĳ˼ָ
+		explicit compiled_expression(const expression& expr);
+		// ʽ룺ȡ룬߷ִʱ Shunting-yard ֱָֻڳ۵
+		// ѵ漴ֵڴֻջȺɵĳСйأ
+		//  expressionҲ DAGʺʮ MB ɱʽ
+		static compiled_expression compile_stream(std::istream& in, size_t chunk_size = 1 << 16);
+		double evaluate() const;
+		// 󶨱ֵһα룬ֻλֵ
+		double evaluate(std::span<const double> slots, precision mode = precision::exact) const;
+		double evaluate(variable_binding bindings, precision mode = precision::exact) const;
+		// integer_only 64 λȷֵ 2^53 Ҳʧλֵʱ nullopt
+		// evaluate ֻ double ֵͬʱ· fold_constant ˵
+		bool integer_only() const { return m_integer; }
+		std::optional<std::int64_t> evaluate_integer(std::span<const double> slots = {}) const;
+		// ʽֵcolumns[i] Ϊ i λһȡֵֵд outSIMD 
+		void evaluate_batch(std::span<const std::span<const double>> columns, std::span<double> out,
+			precision mode = precision::exact) const;
+		// ʽֵͬļĴͨӱÿȰеȡֵΧԳ
+		// ƵȼľϽ磬 tolerance  ÿֵʱõȼ㣬
+		// ӽ㡢ֵ֧ȣÿ˫ȼΪ
+		float_batch_stats evaluate_batch(std::span<const std::span<const float>> columns, std::span<float> out,
+			precision mode = precision::exact, double tolerance = 1e-5) const;
+		const std::vector<std::string>& variables() const { return m_variables; }
+		size_t max_stack_depth() const { return m_max_depth; }
+		size_t temp_count() const { return m_temp_count; }
+		const std::vector<instruction>& code() const { return m_code; }
+		const std::vector<double>& constants() const { return m_constants; }
+		program_view view() const { return { m_code, m_constants, m_natives, m_variables.size(), m_max_depth, m_temp_count }; }
+		// дضλĶƾ񣨸ʽ program_image.hppɶдͬһԭĳд
+		void save(std::ostream& out) const;
+		std::string to_string() const; // ɶָ嵥ڵԣ
+	};
+}
+
+#endif // !COMPILER_HPP
@@ -0,0 +1,372 @@
+#include "differentiation.hpp"
+
+#include <limits>
+#include <numbers>
+
+namespace chr {
+	namespace {
+		// digamma (x) = '(x)/(x)÷乫ʽС 6 ʱõ (x) = (x+1) - 1/x Ƶչ
+		double digamma(double x) {
+			if (x <= 0 && x == std::floor(x)) {
+				return std::numeric_limits<double>::quiet_NaN();
+			}
+			if (x < 0.5) {
+				return digamma(1 - x) - std::numbers::pi / std::tan(std::numbers::pi * x);
+			}
+			double result = 0;
+			for (; x < 6; x += 1) {
+				result -= 1 / x;
+			}
+			double f = 1 / (x * x);
+			return result + std::log(x) - 0.5 / x - f * (1.0 / 12 - f * (1.0 / 120 - f * (1.0 / 252 - f * (1.0 / 240 - f / 132))));
+		}
+
+		// trigamma '(x)ͬ digamma
+		double trigamma(double x) {
+			if (x <= 0 && x == std::floor(x)) {
+				return std::numeric_limits<double>::quiet_NaN();
+			}
+			if (x < 0.5) {
+				double s = std::sin(std::numbers::pi * x);
+				return std::numbers::pi * std::numbers::pi / (s * s) - trigamma(1 - x);
+			}
+			double result = 0;
+			for (; x < 6; x += 1) {
+				result += 1 / (x * x);
+			}
+			double f = 1 / (x * x);
+			return result + 1 / x + f / 2 + f / x * (1.0 / 6 - f * (1.0 / 30 - f * (1.0 / 42 - f * (1.0 / 30 - f * 5 / 66))));
+		}
+
+		// ԸһƫһԪֻ a  aavalue ΪĽ
+		struct partials {
+			double a = 0, b = 0, aa = 0, ab = 0, bb = 0;
+		};
+
+		partials operator_partials(op_t op, double a, double b, double value) {
+			constexpr double ln10 = std::numbers::ln10;
+			switch (op) {
+			case op_t::add: return { 1, 1 };
+			case op_t::minus: return { 1, -1 };
+			case op_t::modulo: return { 1, -std::trunc(a / b) };
+			case op_t::multiply: return { b, a, 0, 1, 0 };
+			case op_t::divide: return { 1 / b, -value / b, 0, -1 / (b * b), 2 * value / (b * b) };
+			case op_t::posite: return { 1 };
+			case op_t::negate: return { -1 };
+			case op_t::exponent: {
+				// Ϊʱָĵ޶壻Ϊʱ 0^b  b > 0 Ϊ
+				double log_a = a > 0 ? std::log(a) : a == 0 ? 0 : std::numeric_limits<double>::quiet_NaN();
+				double d = b * std::pow(a, b - 1);
+				return { d, value * log_a, b * (b - 1) * std::pow(a, b - 2), std::pow(a, b - 1) * (1 + b * log_a), value * log_a * log_a };
+			}
+			case op_t::factorial: {
+				// (x!)' = (x+1)(x+1)(x!)'' = (x+1)((x+1)^2 + '(x+1))
+				double psi = digamma(a + 1);
+				return { value * psi, 0, value * (psi * psi + trigamma(a + 1)) };
+			}
+			case op_t::sine: return { std::cos(a), 0, -value };
+			case op_t::cosine: return { -std::sin(a), 0, -value };
+			case op_t::tangent: return { 1 + value * value, 0, 2 * value * (1 + value * value) };
+			case op_t::cotangent: return { -(1 + value * value), 0, 2 * value * (1 + value * value) };
+			case op_t::secant: {
+				double t = std::tan(a);
+				return { value * t, 0, value * (t * t + value * value) };
+			}
+			case op_t::cosecant: {
+				double c = 1 / std::tan(a);
+				return { -value * c, 0, value * (c * c + value * value) };
+			}
+			case op_t::arcsine:
+			case op_t::arccosine: {
+				double s = 1 - a * a;
+				double sign = op == op_t::arcsine ? 1 : -1;
+				return { sign / std::sqrt(s), 0, sign * a / (s * std::sqrt(s)) };
+			}
+			case op_t::arctangent:
+			case op_t::arccotangent: {
+				double s = 1 + a * a;
+				double sign = op == op_t::arctangent ? 1 : -1;
+				return { sign / s, 0, -sign * 2 * a / (s * s) };
+			}
+			case op_t::arcsecant:
+			case op_t::arccosecant: {
+				// arcsec(x) = arccos(1/x)Ϊ 1/(|x|(x^2-1)) = (x^4-x^2)^(-1/2)
+				double q = a * a * (a * a - 1);
+				double sign = op == op_t::arcsecant ? 1 : -1;
+				return { sign / std::sqrt(q), 0, -sign * (2 * a * a * a - a) / (q * std::sqrt(q)) };
+			}
+			case op_t::common_logarithm: return { 1 / (a * ln10), 0, -1 / (a * a * ln10) };
+			case op_t::natural_logarithm: return { 1 / a, 0, -1 / (a * a) };
+			case op_t::square_root: return { 0.5 / value, 0, -0.25 / (value * a) };
+			case op_t::cubic_root: return { 1 / (3 * value * value), 0, -2 / (9 * value * value * value * value * value) };
+			//  deg/rad ʵʹͬһ 
+			case op_t::degree: return { 180 / CONSTANT_PI };
+			case op_t::radian: return { CONSTANT_PI / 180 };
+			case op_t::square: return { 2 * a, 0, 2 };
+			default:
+				throw std::runtime_error(" " + std::string(operator_info(op).symbol) + " ");
+			}
+		}
+
+		// Ϊ㣬 0 * inf ֮޹طϲ NaN
+		inline double scale(double factor, double tangent) {
+			return tangent == 0 ? 0 : factor * tangent;
+		}
+
+		// ԭԸƫĲ֣ȡ ^(1/3) ƽض
+		std::vector<double> native_partials(const native_function& function, std::span<const double> args) {
+			std::vector<double> point(args.begin(), args.end());
+			std::vector<double> result(args.size());
+			for (size_t i = 0; i < args.size(); i++) {
+				double h = 6.0554544523933395e-6 * std::max(1.0, std::fabs(args[i]));
+				point[i] = args[i] + h;
+				double forward = function.callback(point);
+				point[i] = args[i] - h;
+				double backward = function.callback(point);
+				point[i] = args[i];
+				result[i] = (forward - backward) / (2 * h);
+			}
+			return result;
+		}
+
+		// ׵ jetֵһ׵
+		struct jet {
+			double value, d1, d2;
+		};
+
+		// ׺ f(x)f'(x)f''(x)һԪ g(u)'' = g''u'^2 + g'u''
+		// Ԫ f(a,b)'' = f_aa a'^2 + 2 f_ab a'b' + f_bb b'^2 + f_a a'' + f_b b''
+		jet evaluate_jet(const expression& expr, std::span<const double> slots, size_t variable) {
+			const std::vector<token>& postfix = expr.postfix();
+			std::vector<jet> operands;
+			operands.reserve(postfix.size());
+			std::vector<double> args;
+			for (const auto& tk : postfix) {
+				if (tk.is_number()) {
+					operands.push_back({ tk.number_value(), 0, 0 });
+				}
+				else if (tk.is_variable()) {
+					bool active = tk.variable_slot() == variable;
+					operands.push_back({ slots[tk.variable_slot()], active ? 1.0 : 0.0, 0 });
+				}
+				else if (tk.operator_id() == op_t::comma) {
+					// ʵջϣ call һȡ
+				}
+				else if (tk.operator_id() == op_t::call) {
+					const native_function& function = *expr.natives()[tk.variable_slot()];
+					if (operands.size() < function.arity) {
+						throw std::runtime_error("ʱ " + function.name + " ȱٲ");
+					}
+					size_t first = operands.size() - function.arity;
+					args.clear();
+					for (size_t i = first; i < operands.size(); i++) {
+						args.push_back(operands[i].value);
+					}
+					jet result{ function.callback(args), 0, 0 };
+					std::vector<double> p = native_partials(function, args);
+					bool curved = false;
+					for (size_t i = 0; i < p.size(); i++) {
+						result.d1 += scale(p[i], operands[first + i].d1);
+						curved = curved || operands[first + i].d1 != 0;
+					}
+					// ԭûж׵ֻҪ޷ f''
+					result.d2 = curved ? std::numeric_limits<double>::quiet_NaN() : 0;
+					operands.resize(first);
+					operands.push_back(result);
+				}
+				else if (tk.operator_operand_num() == 1) {
+					if (operands.empty()) {
+						throw std::runtime_error("ʱȱٲ");
+					}
+					jet& u = operands.back();
+					double value = tk.apply_operator(u.value, 0);
+					if (u.d1 != 0 || u.d2 != 0) {
+						partials p = operator_partials(tk.operator_id(), u.value, 0, value);
+						u.d2 = scale(p.aa, u.d1 * u.d1) + scale(p.a, u.d2);
+						u.d1 = scale(p.a, u.d1);
+					}
+					u.value = value;
+				}
+				else {
+					if (operands.size() < 2) {
+						throw std::runtime_error("ʱȱٲ");
+					}
+					jet b = operands.back();
+					operands.pop_back();
+					jet& a = operands.back();
+					double value = tk.apply_operator(a.value, b.value);
+					if (a.d1 != 0 || a.d2 != 0 || b.d1 != 0 || b.d2 != 0) {
+						partials p = operator_partials(tk.operator_id(), a.value, b.value, value);
+						a.d2 = scale(p.aa, a.d1 * a.d1) + scale(2 * p.ab, a.d1 * b.d1) + scale(p.bb, b.d1 * b.d1)
+							+ scale(p.a, a.d2) + scale(p.b, b.d2);
+						a.d1 = scale(p.a, a.d1) + scale(p.b, b.d1);
+					}
+					a.value = value;
+				}
+			}
+			if (operands.size() != 1) {
+				throw std::runtime_error("ʱջֻһԪ");
+			}
+			return operands.back();
+		}
+	}
+
+	gradient_evaluator::gradient_evaluator(const expression& expr, const std::vector<std::string>& variables) :m_expression(expr) {
+		for (const auto& name : variables) {
+			m_slots.push_back(expr.slot(name));
+		}
+	}
+
+	gradient_result gradient_evaluator::evaluate(variable_binding bindings) const {
+		std::vector<double> slots = bind_variables(m_expression.variables(), bindings);
+		return evaluate(slots);
+	}
+
+	// ֵջ expression::evaluate ͬtangents е k ջԪصλ [k*n, (k+1)*n)
+	// ʼֵջͬ
+	gradient_result gradient_evaluator::evaluate(std::span<const double> slots) const {
+		if (slots.size() < m_expression.variables().size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		const std::vector<token>& postfix = m_expression.postfix();
+		const size_t n = m_slots.size();
+		fixed_stack<double> values(postfix.size());
+		std::vector<double> tangents;
+		std::vector<double> args;
+		for (const auto& tk : postfix) {
+			if (tk.is_number() || tk.is_variable()) {
+				values.push(tk.is_number() ? tk.number_value() : slots[tk.variable_slot()]);
+				tangents.resize(values.size() * n);
+				for (size_t k = 0; tk.is_variable() && k < n; k++) {
+					if (m_slots[k] == tk.variable_slot()) {
+						tangents[(values.size() - 1) * n + k] = 1;
+					}
+				}
+				continue;
+			}
+			if (tk.operator_id() == op_t::comma) {
+				// ʵջϣ call һȡ
+				continue;
+			}
+			if (tk.operator_id() == op_t::call) {
+				const native_function& function = *m_expression.natives()[tk.variable_slot()];
+				if (values.size() < function.arity) {
+					throw std::runtime_error("ʱ " + function.name + " ȱٲ");
+				}
+				size_t first = values.size() - function.arity;
+				const double* base = &values.top() + 1 - function.arity;
+				args.assign(base, base + function.arity);
+				double result = function.callback(args);
+				std::vector<double> p = native_partials(function, args);
+				for (size_t k = 0; k < n; k++) {
+					double d = 0;
+					for (size_t i = 0; i < p.size(); i++) {
+						d += scale(p[i], tangents[(first + i) * n + k]);
+					}
+					tangents[first * n + k] = d;
+				}
+				for (size_t i = 1; i < function.arity; i++) {
+					values.pop();
+				}
+				values.top() = result;
+				tangents.resize(values.size() * n);
+				continue;
+			}
+			byte operand_num = tk.operator_operand_num();
+			if (operand_num == 0 || values.size() < operand_num) {
+				throw std::runtime_error("ʱȱٲ");
+			}
+			if (operand_num == 1) {
+				double a = values.top();
+				double value = tk.apply_operator(a, 0);
+				double* t = tangents.data() + (values.size() - 1) * n;
+				if (std::any_of(t, t + n, [](double d) { return d != 0; })) {
+					partials p = operator_partials(tk.operator_id(), a, 0, value);
+					for (size_t k = 0; k < n; k++) {
+						t[k] = scale(p.a, t[k]);
+					}
+				}
+				values.top() = value;
+			}
+			else {
+				double b = values.top();
+				values.pop();
+				double a = values.top();
+				double value = tk.apply_operator(a, b);
+				double* ta = tangents.data() + (values.size() - 1) * n;
+				const double* tb = ta + n;
+				if (std::any_of(ta, ta + 2 * n, [](double d) { return d != 0; })) {
+					partials p = operator_partials(tk.operator_id(), a, b, value);
+					for (size_t k = 0; k < n; k++) {
+						ta[k] = scale(p.a, ta[k]) + scale(p.b, tb[k]);
+					}
+				}
+				values.top() = value;
+				tangents.resize(values.size() * n);
+			}
+		}
+		if (values.size() != 1) {
+			throw std::runtime_error("ʱջֻһԪ");
+		}
+		return { values.top(), std::vector<double>(tangents.begin(), tangents.begin() + n) };
+	}
+
+	double solve(const expression& expr, std::string_view variable, double x0,
+		variable_binding bindings, const solve_options& options) {
+		size_t target = expr.slot(variable);
+		std::vector<double> slots(expr.variables().size());
+		std::vector<bool> bound(slots.size());
+		bound[target] = true;
+		for (const auto& [name, value] : bindings) {
+			size_t index = expr.slot(name);
+			if (index == target) {
+				throw std::runtime_error(" " + std::string(variable) + " ͬʱȡֵ");
+			}
+			slots[index] = value;
+			bound[index] = true;
+		}
+		for (size_t i = 0; i < slots.size(); i++) {
+			if (!bound[i]) {
+				throw std::runtime_error(" " + expr.variables()[i] + " δ");
+			}
+		}
+		return solve(expr, variable, x0, slots, options);
+	}
+
+	// ÿһǰ΢ֵõ ff'f''Halley   = 2ff' / (2f'^2 - ff'')
+	// ĸΪޣԭûж׵ʱȡ Newton   = f / f'
+	double solve(const expression& expr, std::string_view variable, double x0,
+		std::span<const double> values, const solve_options& options) {
+		if (values.size() < expr.variables().size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		size_t target = expr.slot(variable);
+		std::vector<double> slots(values.begin(), values.end());
+		double x = x0;
+		for (size_t iteration = 0; iteration < options.max_iterations; iteration++) {
+			slots[target] = x;
+			jet f = evaluate_jet(expr, slots, target);
+			if (f.value == 0) {
+				return x;
+			}
+			if (!std::isfinite(f.value) || !std::isfinite(f.d1)) {
+				throw std::runtime_error("ʱ " + std::to_string(x) + " ֵַ");
+			}
+			if (f.d1 == 0) {
+				throw std::runtime_error("ʱ " + std::to_string(x) + " Ϊ");
+			}
+			double step = f.value / f.d1;
+			if (options.halley) {
+				double denominator = 2 * f.d1 * f.d1 - f.value * f.d2;
+				if (denominator != 0 && std::isfinite(denominator)) {
+					step = 2 * f.value * f.d1 / denominator;
+				}
+			}
+			x -= step;
+			if (std::fabs(step) <= options.tolerance * std::max(1.0, std::fabs(x))) {
+				return x;
+			}
+		}
+		throw std::runtime_error(" " + std::to_string(options.max_iterations) + " εδ");
+	}
+}
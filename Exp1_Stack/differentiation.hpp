@@ -0,0 +1,43 @@
+#ifndef DIFFERENTIATION_HPP
+#define DIFFERENTIATION_HPP
+
+#include "calculator.hpp"
+
+namespace chr {
+
+	// ǰԶ΢ֵĽֵԸ󵼱ƫ˳빹ʱıһ£
+	struct gradient_result {
+		double value;
+		std::vector<double> gradient;
+	};
+
+	// żֵջÿԪشһ׺һͬʱֵݶȡ
+	// ֵļ expression::evaluate ȫͬÿ
+	// ԭûнĲֽƫ
+	class gradient_evaluator {
+		const expression& m_expression;
+		std::vector<size_t> m_slots; // 󵼱Ĳλ
+	public:
+		// variables Ǳʽеıexpr ֵþ
+		gradient_evaluator(const expression& expr, const std::vector<std::string>& variables);
+		gradient_result evaluate(std::span<const double> slots) const;
+		gradient_result evaluate(variable_binding bindings) const;
+	};
+
+	struct solve_options {
+		size_t max_iterations = 64;
+		double tolerance = 1e-14; //  tolerance * max(1, |x|) ʱΪ
+		bool halley = true;       // ʹö׵ Halley Ϊ Newton 
+	};
+
+	//  expr  variable ĸ x0 Ϊֵ Newton/Halley ɶǰ΢һ
+	//  bindings ԭʱ׵ãԶ˻Ϊ Newton 
+	// Ϊ㡢ֵַþʱ׳쳣
+	double solve(const expression& expr, std::string_view variable, double x0,
+		variable_binding bindings = {}, const solve_options& options = {});
+	// slots λȫֵڲλֵ
+	double solve(const expression& expr, std::string_view variable, double x0,
+		std::span<const double> slots, const solve_options& options = {});
+}
+
+#endif // !DIFFERENTIATION_HPP
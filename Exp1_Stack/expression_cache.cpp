@@ -0,0 +1,85 @@
+#include "expression_cache.hpp"
+
+namespace chr {
+	expression_cache::expression_cache(size_t capacity, const function_table* functions, size_t shard_count)
+		:m_shards(std::max<size_t>(shard_count, 1)), m_functions(functions), m_hits(0), m_misses(0), m_evictions(0) {
+		if (capacity == 0) {
+			throw std::runtime_error("Ϊ");
+		}
+		m_shard_capacity = (capacity + m_shards.size() - 1) / m_shards.size();
+	}
+
+	std::string expression_cache::normalize(std::string_view text) {
+		std::string key;
+		key.reserve(text.size());
+		bool space = false;
+		for (char ch : text) {
+			if (ch == ' ' || ch == '\t' || ch == '\r' || ch == '\n' || ch == '\v' || ch == '\f') {
+				space = !key.empty();
+				continue;
+			}
+			if (space) {
+				key += ' ';
+				space = false;
+			}
+			key += ch;
+		}
+		return key;
+	}
+
+	expression_cache::shard& expression_cache::shard_of(const std::string& key) {
+		return m_shards[std::hash<std::string>{}(key) % m_shards.size()];
+	}
+
+	std::shared_ptr<const compiled_expression> expression_cache::get(std::string_view text) {
+		std::string key = normalize(text);
+		shard& s = shard_of(key);
+		{
+			std::lock_guard<std::mutex> lock(s.mutex);
+			auto it = s.index.find(key);
+			if (it != s.index.end()) {
+				s.lru.splice(s.lru.begin(), s.lru, it->second);
+				m_hits++;
+				return it->second->second;
+			}
+		}
+		m_misses++;
+		// У̲߳ͬһеĽ
+		auto compiled = std::make_shared<const compiled_expression>(expression(key, m_functions));
+		std::lock_guard<std::mutex> lock(s.mutex);
+		auto it = s.index.find(key);
+		if (it != s.index.end()) {
+			s.lru.splice(s.lru.begin(), s.lru, it->second);
+			return it->second->second;
+		}
+		s.lru.emplace_front(key, compiled);
+		s.index.emplace(std::move(key), s.lru.begin());
+		if (s.lru.size() > m_shard_capacity) {
+			s.index.erase(s.lru.back().first);
+			s.lru.pop_back();
+			m_evictions++;
+		}
+		return compiled;
+	}
+
+	expression_cache::statistics expression_cache::stats() const {
+		return { m_hits.load(), m_misses.load(), m_evictions.load() };
+	}
+
+	size_t expression_cache::size() const {
+		size_t total = 0;
+		for (auto& s : m_shards) {
+			std::lock_guard<std::mutex> lock(s.mutex);
+			total += s.lru.size();
+		}
+		return total;
+	}
+
+	void expression_cache::clear() {
+		for (auto& s : m_shards) {
+			std::lock_guard<std::mutex> lock(s.mutex);
+			s.index.clear();
+			s.lru.clear();
+		}
+	}
+}
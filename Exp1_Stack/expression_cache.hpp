@@ -0,0 +1,55 @@
+#ifndef EXPRESSION_CACHE_HPP
+#define EXPRESSION_CACHE_HPP
+
+#include "compiler.hpp"
+
+#include <atomic>
+#include <list>
+#include <mutex>
+
+namespace chr {
+
+	// 棺Թ淶ıʽıΪ治ɱ compiled_expression
+	// ĹϣƬÿƬһһ LRU Ƭ֮以
+	// Զ庯ڹʱ̶䣻ʹڼ亯Ҳ޸
+	// ¶庯Ӧ clear()ѻĽǾɵĶ壩
+	class expression_cache {
+	public:
+		struct statistics {
+			size_t hits;
+			size_t misses;
+			size_t evictions;
+		};
+	private:
+		using entry = std::pair<std::string, std::shared_ptr<const compiled_expression>>;
+		struct shard {
+			mutable std::mutex mutex;
+			std::list<entry> lru; // ͷΪʹ
+			std::unordered_map<std::string, std::list<entry>::iterator> index;
+		};
+		std::vector<shard> m_shards;
+		size_t m_shard_capacity; // ÿƬ
+		const function_table* m_functions;
+		std::atomic<size_t> m_hits;
+		std::atomic<size_t> m_misses;
+		std::atomic<size_t> m_evictions;
+	private:
+		shard& shard_of(const std::string& key);
+	public:
+		// capacity ΪƽֵƬȡfunctions ΪʱɵõԶ庯Ϊգ
+		explicit expression_cache(size_t capacity = 1024, const function_table* functions = nullptr, size_t shard_count = 16);
+		expression_cache(const expression_cache&) = delete;
+		expression_cache& operator=(const expression_cache&) = delete;
+		// ȡñʽıʱֱӷأδʱ룻ʽǷʱ׳쳣Ҳ
+		std::shared_ptr<const compiled_expression> get(std::string_view text);
+		statistics stats() const;
+		size_t size() const;
+		size_t capacity() const { return m_shard_capacity * m_shards.size(); }
+		const function_table* functions() const { return m_functions; }
+		void clear();
+		// 淶ȥβհףհ׺ϲΪһո񣨴ʷֻѿհ׵ָ岻䣩
+		static std::string normalize(std::string_view text);
+	};
+}
+
+#endif // !EXPRESSION_CACHE_HPP
@@ -0,0 +1,383 @@
+#ifndef FAST_MATH_HPP
+#define FAST_MATH_HPP
+
+#include "calculator.hpp"
+#include "simd.hpp"
+
+namespace chr {
+
+	// precision::fast Ŀٽƣÿ㷨 double  vdouble ֻдһģ壬
+	//  FMA ĿϱֵĽλͬ
+	// ʽϵ Remez ϣ±ڶܼȡ㡢 long double ׼ԱȲõ
+	// ULP    2^53 ΪϽ磺
+	//   sin cos tan cot sec csc|x|  1e5  1.5e-81.4e8 ULP
+	//   ln lg                                 1.7e-111.6e5 ULP
+	//   arcsin arccos arctan arccot         2.6e-92.4e7 ULP
+	//   cbrt                                  4.4e-94.0e7 ULP
+	//   a^bb |bln a|  708       1.3e-81.2e8 ULP
+	//   a^bb Ϊ |b|  1024            ƽԼ |b| ULP
+	//   n!n Ϊ 0~170                   n! ȷ루0.5 ULP tgamma
+	// ֵ0ԼΧͨ˵׼
+	namespace fast {
+		// 汾ԭʹģ double  vdouble ʵ
+		inline double abs(double x) { return std::fabs(x); }
+		inline double sqrt(double x) { return std::sqrt(x); }
+#if defined(__SSE4_1__) || defined(__AVX__)
+		inline double floor(double x) { return std::floor(x); }
+#else
+		// û roundsd ָʱ std::floor ǺãΪӼ 1.52^52 뵽|x|  2^51 ʱ
+		inline double floor(double x) {
+			constexpr double magic = 6755399441055744.0;
+			double r = x + magic - magic;
+			r = r > x ? r - 1 : r;
+			return std::fabs(x) < 2251799813685248.0 ? r : x;
+		}
+#endif
+#if defined(__FMA__) || defined(__AVX2__)
+		inline double fma(double a, double b, double c) { return std::fma(a, b, c); }
+#else
+		// ûӲ FMA ʱ std::fma ģ⣬Ϊĳ˼ӣԼ˲֣粻
+		inline double fma(double a, double b, double c) { return a * b + c; }
+#endif
+		inline double select(bool m, double a, double b) { return m ? a : b; }
+		inline bool any(bool m) { return m; }
+		inline bool any(vmask m) { return m.any(); }
+		// ֻĹ
+		inline double frexp_mantissa(double x) {
+			return std::bit_cast<double>((std::bit_cast<std::uint64_t>(x) & 0x800FFFFFFFFFFFFFull) | 0x3FE0000000000000ull);
+		}
+		inline double frexp_exponent(double x) {
+			return static_cast<double>(static_cast<int>(std::bit_cast<std::uint64_t>(x) >> 52 & 0x7FF) - 1022);
+		}
+		inline double scale2(double a, double n) {
+			//  AVX2 汾ͬ
+			auto pow2 = [](double k) { return std::bit_cast<double>(static_cast<std::uint64_t>(static_cast<std::int64_t>(k) + 1023) << 52); };
+			double half = floor(n * 0.5);
+			return a * pow2(half) * pow2(n - half);
+		}
+		template <size_t N>
+		double polynomial(double x, const double(&coef)[N]) {
+			double r = coef[0];
+			for (size_t i = 1; i < N; i++) {
+				r = fma(r, x, coef[i]);
+			}
+			return r;
+		}
+		template <typename T>
+		T splat(double x) {
+			if constexpr (std::is_same_v<T, double>) {
+				return x;
+			}
+			else {
+				return vdouble::broadcast(x);
+			}
+		}
+		// bad Ϊͨñ
+		template <typename F>
+		double fix(double result, bool bad, double a, double b, F func) {
+			return bad ? func(a, b) : result;
+		}
+		template <typename F>
+		vdouble fix(vdouble result, vmask bad, vdouble a, vdouble b, F func) {
+			return fix_lanes(result, bad, a, b, func);
+		}
+
+		// ϵӸߴεʹ
+		// sin r = r - r^3S(r^2)cos r = 1 - r^2/2 + r^4C(r^2)|r|  /4
+		constexpr double sin_coef[] = { 1.9587360354399381e-4, -8.332744992003923e-3, 1.6666664636892808e-1 };
+		constexpr double cos_coef[] = { 2.4547608028293428e-5, -1.3888300972533501e-3, 4.1666664643528945e-2 };
+		// atan a = a + a^3A(a^2)|a|  tan(/8)
+		constexpr double atan_coef[] = {
+			-6.4563896715198341e-2, 1.0745271034879059e-1, -1.4264121995141613e-1, 1.9999546262027859e-1, -3.3333331792786008e-1,
+		};
+		// ln(1+t) = 2s + 2s^3L(s^2)s = t/(2+t)|s|  3-22
+		constexpr double log_coef[] = { 1.1665496849626848e-1, 1.4275398800444453e-1, 2.0000061047742115e-1, 3.3333333277040444e-1 };
+		// e^r = 1 + r + r^2E(r)|r|  ln2/2
+		constexpr double exp_coef[] = {
+			1.3901285063257563e-3, 8.3631403795553609e-3, 4.1666853345629383e-2, 1.666657731993815e-1, 4.9999999552859664e-1,
+		};
+		// arcsin w = w + w^3P(w^2)|w|  1/2
+		constexpr double asin_coef[] = {
+			3.3799707460429901e-2, 1.7081657422757791e-2, 3.111531940210242e-2, 4.4598107687062523e-2,
+			7.5000985238599494e-2, 1.6666666317980192e-1,
+		};
+		// cbrt  [0.5, 4) ϵĴγֵ 1.9e-3һ Halley ԼΪ
+		constexpr double cbrt_coef[] = {
+			-5.4873425739570244e-3, 6.0853491242989943e-2, -2.6596939150042126e-1, 7.130506963739266e-1, 4.9788412873878418e-1,
+		};
+		constexpr double sin_limit = 1e5;
+		constexpr double exp_limit = 708.0;
+		constexpr double pow_integer_limit = 1024.0;
+		// /2  ln2 ɸλβ̵ܶļΣԼʱ qλ ǾȷģCody-Waite
+		constexpr double pi_2_1 = 1.57079625129699707031, pi_2_2 = 7.54978941586159635335e-8, pi_2_3 = 5.39030285815811905290e-15;
+		constexpr double ln2_1 = 6.93145751953125e-1, ln2_2 = 1.42860682030941723212e-6;
+
+		// 0~170 Ľ׳ˣn! ȷ루171! ѳ double
+		inline constexpr double factorial_table[] = {
+			0x1p+0, 0x1p+0, 0x1p+1, 0x1.8p+2, 0x1.8p+4,
+			0x1.ep+6, 0x1.68p+9, 0x1.3bp+12, 0x1.3bp+15, 0x1.626p+18,
+			0x1.baf8p+21, 0x1.308a8p+25, 0x1.c8cfcp+28, 0x1.7328ccp+32, 0x1.44c3b28p+36,
+			0x1.30777758p+40, 0x1.30777758p+44, 0x1.437eeecd8p+48, 0x1.6beecca73p+52, 0x1.b02b930689p+56,
+			0x1.0e1b3be415ap+61, 0x1.6283be9b5c62p+65, 0x1.e77526159f06cp+69, 0x1.5e5c335f8a4cep+74, 0x1.06c52687a7b9ap+79,
+			0x1.9a940c33f6121p+83, 0x1.4d9849ea37eebp+88, 0x1.19787e5d9f316p+93, 0x1.ec92dd23d6967p+97, 0x1.be6518687a785p+102,
+			0x1.a27ec6e1f2d0dp+107, 0x1.956ad0aae33a4p+112, 0x1.956ad0aae33a4p+117, 0x1.a21627303a541p+122, 0x1.bc3789a33df96p+127,
+			0x1.e5dcbe8a8bc8cp+132, 0x1.114c2b2deea0fp+138, 0x1.3c0011ed1bea1p+143, 0x1.774015499125fp+148, 0x1.c95619f1a8e64p+153,
+			0x1.1dd5d037098fep+159, 0x1.6e39f2c684406p+164, 0x1.e0ac0ea48d948p+169, 0x1.42f399d68f1fcp+175, 0x1.bc0ef38704cbbp+180,
+			0x1.383a833aef5f3p+186, 0x1.c0d41ca4b818ep+191, 0x1.499bc508f7324p+197, 0x1.ee69a78d72cb6p+202, 0x1.7a88e4484be3bp+208,
+			0x1.27baf2587b49ep+214, 0x1.d751f23d047dcp+219, 0x1.7ef294d193a63p+225, 0x1.3d20e33d8e45ap+231, 0x1.0b93bfbbf00acp+237,
+			0x1.cbe5f18b04928p+242, 0x1.92693359a4003p+248, 0x1.6665b1bbd6102p+254, 0x1.44cc291239feap+260, 0x1.2b6c35dccd76cp+266,
+			0x1.18b5727f009f5p+272, 0x1.0b8cf1210c97ep+278, 0x1.0330899804332p+284, 0x1.fe478ee34844ap+289, 0x1.fe478ee34844ap+295,
+			0x1.0320568f6ab2ep+302, 0x1.0b395943e6087p+308, 0x1.17c0097314d0dp+314, 0x1.293c0a0a461dep+320, 0x1.4074bad313983p+326,
+			0x1.5e7fac56dd6e8p+332, 0x1.84d5a3305da69p+338, 0x1.b5705796695b6p+344, 0x1.f2f423e7902c4p+350, 0x1.207524c1df599p+357,
+			0x1.5209471331bdp+363, 0x1.916b0466cb107p+369, 0x1.e2f4c14bac4fcp+375, 0x1.264d25ca1d009p+382, 0x1.6b473aa57bcccp+388,
+			0x1.c619094edabffp+394, 0x1.1f5bd7e3e66d7p+401, 0x1.702dac9bff3c4p+407, 0x1.dd7b3bda4f022p+413, 0x1.3958df4743d96p+420,
+			0x1.a02a088aa61cbp+426, 0x1.179c3dbd279b5p+433, 0x1.7c1863ed21d72p+439, 0x1.0550c4b30743ep+446, 0x1.6b645188f61a6p+452,
+			0x1.ff0512a89a152p+458, 0x1.6b4d9b43dd8bp+465, 0x1.051fc798c73bfp+472, 0x1.7b722e0a01831p+478, 0x1.16a7d9cf591c4p+485,
+			0x1.9da1274fc845fp+491, 0x1.3638dd7bd6347p+498, 0x1.d62e2fafb0a78p+504, 0x1.67fb5c8283404p+511, 0x1.166c698cf183bp+518,
+			0x1.b30964ec395dcp+524, 0x1.574569a26544p+531, 0x1.118b502d68b23p+538, 0x1.b83c3509147ecp+544, 0x1.65b0eb1760a7p+551,
+			0x1.256b20d92d49p+558, 0x1.e5f96e67b300ep+564, 0x1.963e824aafa2cp+571, 0x1.56c4bdef04315p+578, 0x1.23e389bd8992p+585,
+			0x1.f5af14bdc472fp+591, 0x1.b30dd3fc905bap+598, 0x1.7cac197cfe503p+605, 0x1.500fee805882dp+612, 0x1.2b4e306a4ed48p+619,
+			0x1.0ce83f7f82d2fp+626, 0x1.e764f3171d1e4p+632, 0x1.bd824633209dbp+639, 0x1.9ab418b722116p+646, 0x1.7dd36efa41ac2p+653,
+			0x1.65f6380a9d916p+660, 0x1.5262c0fa08f37p+667, 0x1.42861fee5088p+674, 0x1.35ece2af0162bp+681, 0x1.2c3d7b998957ap+688,
+			0x1.25340ab3f01f9p+695, 0x1.209f3a89205f1p+702, 0x1.1e5dfc140e1e5p+709, 0x1.1e5dfc140e1e5p+716, 0x1.209ab80c363a9p+723,
+			0x1.251d22ec67138p+730, 0x1.2bfbd1bdf17dfp+737, 0x1.355bb04be109ep+744, 0x1.4171452ed7d44p+751, 0x1.5082946d09f23p+758,
+			0x1.62e9b88b007d7p+765, 0x1.79185413b0855p+772, 0x1.939c09fd12eebp+779, 0x1.b3243ac4d8695p+786, 0x1.d88957d1c3026p+793,
+			0x1.026b1c06b6a55p+801, 0x1.1ca9fcdf65321p+808, 0x1.3bcc9487d4439p+815, 0x1.60ce8defbf238p+822, 0x1.8ce85fadb707ep+829,
+			0x1.c19f3c62c956fp+836, 0x1.006cd07056d39p+844, 0x1.267cf76103b7p+851, 0x1.54807e082c4b9p+858, 0x1.8c5d92b5839p+865,
+			0x1.d07da7ecb62ccp+872, 0x1.11fa1e0c9f746p+880, 0x1.455903aefd5a3p+887, 0x1.84e466672ad5dp+894, 0x1.d3e2cb341f894p+901,
+			0x1.1b4a51088f182p+909, 0x1.594292c26e656p+916, 0x1.a77ba8027b686p+923, 0x1.055e51b1882a7p+931, 0x1.44ab297a8724bp+938,
+			0x1.95d5f3d928edep+945, 0x1.fe771cb7257b3p+952, 0x1.4307602be5b7fp+960, 0x1.9b5b6477e6884p+967, 0x1.07868c5ccfaf4p+975,
+			0x1.53b370efa3b7fp+982, 0x1.b88cb676c8529p+989, 0x1.1f63cb077cadep+997, 0x1.7932fa79d3a43p+1004, 0x1.f2054eb4d96ecp+1011,
+			0x1.4ab7864418639p+1019,
+		};
+
+		//  /2 Լͬʱ sin  cos|x|  sin_limit
+		template <typename T>
+		void sincos(T x, T& s, T& c) {
+			T q = floor(fma(x, splat<T>(0.63661977236758134), splat<T>(0.5))); // 2/
+			T r = fma(q, splat<T>(-pi_2_1), x);
+			r = fma(q, splat<T>(-pi_2_2), r);
+			r = fma(q, splat<T>(-pi_2_3), r);
+			T z = r * r;
+			T ps = fma(-(r * z), polynomial(z, sin_coef), r);
+			T pc = fma(z * z, polynomial(z, cos_coef), fma(z, splat<T>(-0.5), splat<T>(1)));
+			//  j = q mod 4sin x Ϊ s, c, -s, -ccos x Ϊ c, -s, -c, s
+			T j = q - floor(q * splat<T>(0.25)) * splat<T>(4);
+			auto swap = (j == splat<T>(1)) | (j == splat<T>(3));
+			T sv = select(swap, pc, ps);
+			T cv = select(swap, ps, pc);
+			s = select(splat<T>(2) <= j, -sv, sv);
+			s = select(x == splat<T>(0), x, s); //  -0 ķ
+			c = select((j == splat<T>(1)) | (j == splat<T>(2)), -cv, cv);
+		}
+		template <typename T>
+		auto sincos_bad(T x) {
+			return !(abs(x) <= splat<T>(sin_limit));
+		}
+		template <typename T>
+		T sin(T x) {
+			T s, c;
+			sincos(x, s, c);
+			return fix(s, sincos_bad(x), x, x, [](double a, double) { return std::sin(a); });
+		}
+		template <typename T>
+		T cos(T x) {
+			T s, c;
+			sincos(x, s, c);
+			return fix(c, sincos_bad(x), x, x, [](double a, double) { return std::cos(a); });
+		}
+		template <typename T>
+		T tan(T x) {
+			T s, c;
+			sincos(x, s, c);
+			return fix(s / c, sincos_bad(x), x, x, [](double a, double) { return std::tan(a); });
+		}
+		template <typename T>
+		T cot(T x) {
+			T s, c;
+			sincos(x, s, c);
+			return fix(c / s, sincos_bad(x), x, x, [](double a, double) { return 1 / std::tan(a); });
+		}
+		template <typename T>
+		T sec(T x) {
+			T s, c;
+			sincos(x, s, c);
+			return fix(splat<T>(1) / c, sincos_bad(x), x, x, [](double a, double) { return 1 / std::cos(a); });
+		}
+		template <typename T>
+		T csc(T x) {
+			T s, c;
+			sincos(x, s, c);
+			return fix(splat<T>(1) / s, sincos_bad(x), x, x, [](double a, double) { return 1 / std::sin(a); });
+		}
+
+		// Ȼx ΪĹ
+		template <typename T>
+		T log_core(T x) {
+			T e = frexp_exponent(x);
+			T m = frexp_mantissa(x);
+			auto small = m < splat<T>(0.70710678118654752440);
+			e = select(small, e - splat<T>(1), e);
+			m = select(small, m + m, m);
+			T t = m - splat<T>(1);
+			T s = t / (t + splat<T>(2));
+			T s2 = s + s;
+			T y = fma(s2 * (s * s), polynomial(s * s, log_coef), s2);
+			return fma(e, splat<T>(ln2_1), fma(e, splat<T>(ln2_2), y));
+		}
+		template <typename T>
+		auto log_bad(T x) {
+			return (!(splat<T>(2.2250738585072014e-308) <= x)) | (!(x < splat<T>(INFINITY)));
+		}
+		template <typename T>
+		T log(T x) {
+			return fix(log_core(x), log_bad(x), x, x, [](double a, double) { return std::log(a); });
+		}
+		template <typename T>
+		T log10(T x) {
+			return fix(log_core(x) * splat<T>(0.43429448190325182765), log_bad(x), x, x, [](double a, double) { return std::log10(a); });
+		}
+
+		// e^x|x|  exp_limit
+		template <typename T>
+		T exp_core(T x) {
+			T n = floor(fma(x, splat<T>(1.4426950408889634), splat<T>(0.5)));
+			T r = fma(n, splat<T>(-ln2_1), x);
+			r = fma(n, splat<T>(-ln2_2), r);
+			T p = fma(r * r, polynomial(r, exp_coef), r) + splat<T>(1);
+			return scale2(p, n);
+		}
+
+		// ݣ |b| ĶλƽָȶԵȡ
+		inline double pow_integer(double a, double b) {
+			double base = b < 0 ? 1 / a : a;
+			double result = 1;
+			for (auto n = static_cast<std::uint32_t>(std::fabs(b)); n != 0; n >>= 1) {
+				if (n & 1) {
+					result *= base;
+				}
+				base *= base;
+			}
+			return result;
+		}
+		inline vdouble pow_integer(vdouble a, vdouble b) {
+			vdouble base = select(b < vdouble::broadcast(0), 1.0 / a, a);
+			vdouble result = vdouble::broadcast(1);
+			for (vdouble n = abs(b); (vdouble::broadcast(0) < n).any(); ) {
+				vdouble half = floor(n * 0.5);
+				result = select(half + half < n, result * base, result);
+				base = base * base;
+				n = half;
+			}
+			return result;
+		}
+		// a^bָ߷ƽ a > 0 ͨȡ exp(bln a)ʣµͨ˵ std::pow
+		template <typename T>
+		T pow(T a, T b) {
+			auto integral = (floor(b) == b) & (abs(b) <= splat<T>(pow_integer_limit));
+			T result = splat<T>(0);
+			if (any(integral)) {
+				result = pow_integer(a, b);
+			}
+			auto general = !integral;
+			if (any(general)) {
+				T p = b * log_core(a);
+				auto bad = general & (log_bad(a) | !(abs(p) <= splat<T>(exp_limit)));
+				result = select(integral, result, exp_core(p));
+				result = fix(result, bad, a, b, [](double x, double y) { return std::pow(x, y); });
+			}
+			return result;
+		}
+
+		// arctan |x| ΣֻһγѲԼ |a|  tan(/8)
+		//   |x| > tan(3/8) ʱ atan|x| = /2 + atan(-1/|x|)|x| > tan(/8) ʱ = /4 + atan((|x|-1)/(|x|+1))
+		template <typename T>
+		T atan(T x) {
+			T ax = abs(x);
+			auto big = splat<T>(2.4142135623730950) < ax;
+			auto mid = splat<T>(0.41421356237309505) < ax;
+			T numerator = select(big, splat<T>(-1), select(mid, ax - splat<T>(1), ax));
+			T denominator = select(big, ax, select(mid, ax + splat<T>(1), splat<T>(1)));
+			T a = numerator / denominator;
+			T base = select(big, splat<T>(1.5707963267948966), select(mid, splat<T>(0.78539816339744831), splat<T>(0)));
+			T z = a * a;
+			T r = base + fma(a * z, polynomial(z, atan_coef), a);
+			r = select(x < splat<T>(0), -r, r);
+			return select(x == splat<T>(0), x, r); //  -0 ķ
+		}
+		// arcsin |x||x|  1/2 ʱֱöʽ arcsin|x| = /2 - 2arcsin(sqrt((1-|x|)/2))
+		// |x| > 1 ʱ sqrt ĲΪΪ NaN׼һ
+		template <typename T>
+		T asin_abs(T ax, auto& big) {
+			big = splat<T>(0.5) < ax;
+			T z = select(big, (splat<T>(1) - ax) * splat<T>(0.5), ax * ax);
+			T w = select(big, sqrt(z), ax);
+			return fma(w * z, polynomial(z, asin_coef), w);
+		}
+		template <typename T>
+		T asin(T x) {
+			decltype(splat<T>(0) < x) big;
+			T p = asin_abs(abs(x), big);
+			T r = select(big, splat<T>(1.5707963267948966) - (p + p), p);
+			r = select(x < splat<T>(0), -r, r);
+			return select(x == splat<T>(0), x, r);
+		}
+		// arccos x|x|  1/2 ʱΪ /2 - arcsin xx > 1/2 ʱΪ 2arcsin(sqrt((1-x)/2))x < -1/2 ʱΪ  ȥ
+		template <typename T>
+		T acos(T x) {
+			decltype(splat<T>(0) < x) big;
+			T p = asin_abs(abs(x), big);
+			auto negative = x < splat<T>(0);
+			T outer = select(negative, splat<T>(3.1415926535897932) - (p + p), p + p);
+			T inner = splat<T>(1.5707963267948966) - select(negative, -p, p);
+			return select(big, outer, inner);
+		}
+
+		//  |x| д u2^(3k)u  [0.5, 4)Ĵζʽֵһ Halley 
+		template <typename T>
+		T cbrt(T x) {
+			T ax = abs(x);
+			T e = frexp_exponent(ax);
+			T k = floor(e * splat<T>(1.0 / 3));
+			T u = scale2(frexp_mantissa(ax), e - k * splat<T>(3));
+			T y = polynomial(u, cbrt_coef);
+			T y3 = y * y * y;
+			y = y * (y3 + u + u) / (y3 + y3 + u);
+			y = scale2(y, k);
+			return fix(select(x < splat<T>(0), -y, y), log_bad(ax), x, x, [](double a, double) { return std::cbrt(a); });
+		}
+
+		inline double factorial(double x) {
+			if (x >= 0 && x <= 170 && x == floor(x)) {
+				return factorial_table[static_cast<size_t>(x)];
+			}
+			return std::tgamma(x + 1);
+		}
+
+		// 㣺нʵֵĺ apply_operator ͬ
+		template <op_t Op>
+		inline double apply_operator(double a, double b = 0) {
+			if constexpr (Op == op_t::modulo) return std::fmod(a, b); //  fmodl һǾȷ
+			else if constexpr (Op == op_t::exponent) return pow(a, b);
+			else if constexpr (Op == op_t::factorial) return factorial(a);
+			else if constexpr (Op == op_t::sine) return sin(a);
+			else if constexpr (Op == op_t::cosine) return cos(a);
+			else if constexpr (Op == op_t::tangent) return tan(a);
+			else if constexpr (Op == op_t::cotangent) return cot(a);
+			else if constexpr (Op == op_t::secant) return sec(a);
+			else if constexpr (Op == op_t::cosecant) return csc(a);
+			else if constexpr (Op == op_t::arcsine) return asin(a);
+			else if constexpr (Op == op_t::arccosine) return acos(a);
+			else if constexpr (Op == op_t::arctangent) return atan(a);
+			else if constexpr (Op == op_t::arccotangent) return atan(1 / a);
+			else if constexpr (Op == op_t::arcsecant) return acos(1 / a);
+			else if constexpr (Op == op_t::arccosecant) return asin(1 / a);
+			else if constexpr (Op == op_t::common_logarithm) return log10(a);
+			else if constexpr (Op == op_t::natural_logarithm) return log(a);
+			else if constexpr (Op == op_t::cubic_root) return cbrt(a);
+			else return chr::apply_operator<Op>(a, b);
+		}
+	}
+}
+
+#endif // !FAST_MATH_HPP
@@ -0,0 +1,35 @@
+#include "instrumentation.hpp"
+
+#include <atomic>
+
+namespace chr {
+	namespace {
+		thread_local std::uint64_t allocation_count = 0;
+		std::atomic<bool> instrumentation_flag{ false };
+		std::atomic<bool> counter_registered{ false };
+	}
+
+	std::uint64_t thread_allocation_count() noexcept {
+		return allocation_count;
+	}
+
+	bool allocation_counting() noexcept {
+		return counter_registered.load(std::memory_order_relaxed);
+	}
+
+	void register_allocation_counter() noexcept {
+		counter_registered.store(true, std::memory_order_relaxed);
+	}
+
+	void count_allocation() noexcept {
+		allocation_count++;
+	}
+
+	void enable_instrumentation(bool enabled) noexcept {
+		instrumentation_flag.store(enabled, std::memory_order_relaxed);
+	}
+
+	bool instrumentation_enabled() noexcept {
+		return instrumentation_flag.load(std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,56 @@
+#ifndef INSTRUMENTATION_HPP
+#define INSTRUMENTATION_HPP
+
+#include <chrono>
+#include <cstdint>
+
+namespace chr {
+
+	// ǰ߳ۼƵĶѷ allocation_counter.cpp 滻ȫ operator new ɣ
+	// ֻ Benchmark δʱ滻亯ʼΪ 0
+	std::uint64_t thread_allocation_count() noexcept;
+	// Ƿ allocation_counter.cppûʱͳв
+	bool allocation_counting() noexcept;
+	//  allocation_counter.cpp ʹãǼǼΪǰ̼߳һη
+	void register_allocation_counter() noexcept;
+	void count_allocation() noexcept;
+
+	// ȫֿأ򿪺¹ expression ż¼׶ͳƣĬϹرգӰ·
+	void enable_instrumentation(bool enabled) noexcept;
+	bool instrumentation_enabled() noexcept;
+
+	// ׶εۼͳ
+	struct phase_stats {
+		std::uint64_t calls = 0;
+		std::uint64_t nanoseconds = 0;
+		std::uint64_t allocations = 0;
+	};
+	inline phase_stats& operator+=(phase_stats& a, const phase_stats& b) {
+		a.calls += b.calls;
+		a.nanoseconds += b.nanoseconds;
+		a.allocations += b.allocations;
+		return a;
+	}
+
+	// ʱʱѾʱ뱾߳ķۼӵ statsstats ΪʲôҲ
+	class phase_timer {
+		phase_stats* m_stats;
+		std::chrono::steady_clock::time_point m_start;
+		std::uint64_t m_allocations;
+	public:
+		explicit phase_timer(phase_stats* stats)
+			:m_stats(stats), m_start(stats ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point()),
+			m_allocations(stats ? thread_allocation_count() : 0) {}
+		phase_timer(const phase_timer&) = delete;
+		phase_timer& operator=(const phase_timer&) = delete;
+		~phase_timer() {
+			if (m_stats) {
+				m_stats->calls++;
+				m_stats->nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count();
+				m_stats->allocations += thread_allocation_count() - m_allocations;
+			}
+		}
+	};
+}
+
+#endif // !INSTRUMENTATION_HPP
@@ -1,7 +1,415 @@
-﻿#include "calculator.hpp"
+﻿#include "bulk_evaluator.hpp"
+#include "calculator_daemon.hpp"
+#include "program_image.hpp"
+#include "parallel_evaluator.hpp"
+#include "differentiation.hpp"
+#include "big_number.hpp"
 
-int main()
+#include <fstream>
+
+// 预置的多参数原生函数，REPL、批量模式与服务模式共用
+void define_preset_functions(chr::function_table& functions)
+{
+    functions.define_native("hypot", 2, [](std::span<const double> a) { return std::hypot(a[0], a[1]); });
+    functions.define_native("max", 2, [](std::span<const double> a) { return std::max(a[0], a[1]); });
+    functions.define_native("min", 2, [](std::span<const double> a) { return std::min(a[0], a[1]); });
+}
+
+// 批量模式：Calculator --bulk <输入文件> [-o <输出文件>] [-j <线程数>]
+// 每行一个表达式，结果按输入顺序写到输出文件（默认标准输出），出错行写入标准错误
+int run_bulk(int argc, char* argv[])
+{
+    std::string input, output;
+    chr::bulk_options options;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-o" && i + 1 < argc) {
+            output = argv[++i];
+        }
+        else if (arg == "-j" && i + 1 < argc) {
+            options.threads = std::stoul(argv[++i]);
+        }
+        else if (input.empty()) {
+            input = arg;
+        }
+        else {
+            std::cerr << "无法识别的参数：" << arg << "\n";
+            return 2;
+        }
+    }
+    std::ifstream in(input, std::ios::binary);
+    if (!in) {
+        std::cerr << "无法打开输入文件：" << input << "\n";
+        return 1;
+    }
+    std::ofstream file;
+    if (!output.empty()) {
+        file.open(output, std::ios::binary);
+        if (!file) {
+            std::cerr << "无法打开输出文件：" << output << "\n";
+            return 1;
+        }
+    }
+    chr::function_table functions;
+    define_preset_functions(functions);
+    options.functions = &functions;
+    chr::bulk_summary summary = chr::evaluate_bulk(in, output.empty() ? std::cout : file, std::cerr, options);
+    std::cerr << "共 " << summary.lines << " 行，其中 " << summary.errors << " 行出错\n";
+    return summary.errors == 0 ? 0 : 1;
+}
+
+// 服务模式：Calculator --daemon <套接字路径> [-j <线程数>]
+int run_daemon(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "缺少套接字路径\n";
+        return 2;
+    }
+    chr::daemon_options options;
+    if (argc == 5 && std::string(argv[3]) == "-j") {
+        options.threads = std::stoul(argv[4]);
+    }
+    chr::function_table functions;
+    define_preset_functions(functions);
+    options.functions = &functions;
+    chr::calculator_daemon daemon(argv[2], options);
+    daemon.run();
+    return 0;
+}
+
+// 客户端：Calculator --client <套接字路径> [表达式...]，未给出表达式时从标准输入逐行读取
+int run_client(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "缺少套接字路径\n";
+        return 2;
+    }
+    std::vector<std::string> expressions(argv + 3, argv + argc);
+    if (expressions.empty()) {
+        std::string line;
+        while (std::getline(std::cin, line)) {
+            expressions.push_back(line);
+        }
+    }
+    chr::daemon_client client(argv[2]);
+    int status = 0;
+    for (const auto& response : client.evaluate(expressions)) {
+        if (response.ok) {
+            std::cout << response.value << "\n";
+        }
+        else {
+            std::cout << "\n";
+            std::cerr << response.error << "\n";
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// 流式模式：Calculator --stream <输入文件> [--fast] [变量=值...]
+// 输入文件为单个（可能长达数十 MB 的）表达式，分块读取并直接编译，不在内存中保留整个输入；--fast 使用快速近似求值
+int run_stream(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "缺少输入文件\n";
+        return 2;
+    }
+    std::ifstream in(argv[2], std::ios::binary);
+    if (!in) {
+        std::cerr << "无法打开输入文件：" << argv[2] << "\n";
+        return 1;
+    }
+    chr::compiled_expression program = chr::compiled_expression::compile_stream(in);
+    std::vector<double> slots(program.variables().size());
+    std::vector<bool> bound(slots.size());
+    chr::precision mode = chr::precision::exact;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--fast") {
+            mode = chr::precision::fast;
+            continue;
+        }
+        size_t eq = arg.find('=');
+        auto it = std::find(program.variables().begin(), program.variables().end(), arg.substr(0, eq));
+        if (eq == std::string::npos || it == program.variables().end()) {
+            std::cerr << "无法识别的变量绑定：" << arg << "\n";
+            return 2;
+        }
+        slots[it - program.variables().begin()] = std::stod(arg.substr(eq + 1));
+        bound[it - program.variables().begin()] = true;
+    }
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (!bound[i]) {
+            std::cerr << "变量 " << program.variables()[i] << " 未绑定\n";
+            return 2;
+        }
+    }
+    // 整数程序输出精确的整数结果（超过 2^53 也不丢失低位）
+    if (auto exact = program.evaluate_integer(slots)) {
+        std::cout << *exact << "\n";
+    }
+    else {
+        std::cout << program.evaluate(slots, mode) << "\n";
+    }
+    return 0;
+}
+
+// 保存镜像：Calculator --save <输入文件> <镜像文件>，每行一个表达式，编译后依次写入同一个镜像文件
+int run_save(int argc, char* argv[])
+{
+    if (argc != 4) {
+        std::cerr << "用法：Calculator --save <输入文件> <镜像文件>\n";
+        return 2;
+    }
+    std::ifstream in(argv[2], std::ios::binary);
+    if (!in) {
+        std::cerr << "无法打开输入文件：" << argv[2] << "\n";
+        return 1;
+    }
+    std::ofstream out(argv[3], std::ios::binary);
+    if (!out) {
+        std::cerr << "无法打开输出文件：" << argv[3] << "\n";
+        return 1;
+    }
+    std::string line;
+    size_t lines = 0, errors = 0;
+    while (std::getline(in, line)) {
+        lines++;
+        try {
+            chr::compiled_expression(chr::expression(line)).save(out);
+        }
+        catch (std::exception& e) {
+            errors++;
+            std::cerr << "第 " << lines << " 行：" << e.what() << "\n";
+        }
+    }
+    std::cerr << "共 " << lines << " 行，写入 " << lines - errors << " 个程序\n";
+    return errors == 0 ? 0 : 1;
+}
+
+// 加载镜像：Calculator --load <镜像文件> [--fast] [变量=值...]，映射文件后依次求值，每个程序输出一行
+int run_load(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cerr << "缺少镜像文件\n";
+        return 2;
+    }
+    std::vector<std::pair<std::string, double>> bindings;
+    chr::precision mode = chr::precision::exact;
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "--fast") {
+            mode = chr::precision::fast;
+            continue;
+        }
+        size_t eq = arg.find('=');
+        if (eq == std::string::npos) {
+            std::cerr << "无法识别的变量绑定：" << arg << "\n";
+            return 2;
+        }
+        bindings.emplace_back(arg.substr(0, eq), std::stod(arg.substr(eq + 1)));
+    }
+    chr::mapped_program_file file(argv[2]);
+    int status = 0;
+    for (const auto& image : file.images()) {
+        try {
+            std::vector<double> slots(image.variable_count());
+            for (size_t i = 0; i < slots.size(); i++) {
+                auto it = std::find_if(bindings.begin(), bindings.end(), [&](const auto& b) { return b.first == image.variable(i); });
+                if (it == bindings.end()) {
+                    throw std::runtime_error("变量 " + std::string(image.variable(i)) + " 未绑定");
+                }
+                slots[i] = it->second;
+            }
+            std::cout << image.evaluate(slots, mode) << "\n";
+        }
+        catch (std::exception& e) {
+            std::cout << "\n";
+            std::cerr << e.what() << "\n";
+            status = 1;
+        }
+    }
+    return status;
+}
+
+// 并行模式：Calculator --parallel <输入文件> [-j <线程数>] [变量=值...]
+// 输入文件为单个超大表达式，划分为子树任务后在工作窃取线程池上并行求值
+int run_parallel(int argc, char* argv[])
 {
+    if (argc < 3) {
+        std::cerr << "缺少输入文件\n";
+        return 2;
+    }
+    std::ifstream in(argv[2], std::ios::binary);
+    if (!in) {
+        std::cerr << "无法打开输入文件：" << argv[2] << "\n";
+        return 1;
+    }
+    std::string text((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    chr::expression expr(text);
+    size_t threads = 0;
+    std::vector<double> slots(expr.variables().size());
+    std::vector<bool> bound(slots.size());
+    for (int i = 3; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-j" && i + 1 < argc) {
+            threads = std::stoul(argv[++i]);
+            continue;
+        }
+        size_t eq = arg.find('=');
+        auto it = std::find(expr.variables().begin(), expr.variables().end(), arg.substr(0, eq));
+        if (eq == std::string::npos || it == expr.variables().end()) {
+            std::cerr << "无法识别的变量绑定：" << arg << "\n";
+            return 2;
+        }
+        slots[it - expr.variables().begin()] = std::stod(arg.substr(eq + 1));
+        bound[it - expr.variables().begin()] = true;
+    }
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (!bound[i]) {
+            std::cerr << "变量 " << expr.variables()[i] << " 未绑定\n";
+            return 2;
+        }
+    }
+    chr::thread_pool pool(threads);
+    chr::parallel_evaluator evaluator(expr);
+    std::cout << evaluator.evaluate(pool, slots) << "\n";
+    return 0;
+}
+
+// 精确模式：Calculator --exact [-r <进制>] <表达式> [变量=值...]
+// 按任意精度有理数求值（阶乘、乘方与组合数不受 double 范围与精度限制），结果按 2/8/10/16 进制输出
+int run_exact(int argc, char* argv[])
+{
+    int radix = 10;
+    std::string text;
+    std::vector<std::pair<std::string, chr::big_rational>> bindings;
+    for (int i = 2; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-r" && i + 1 < argc) {
+            radix = std::stoi(argv[++i]);
+            if (radix != 2 && radix != 8 && radix != 10 && radix != 16) {
+                std::cerr << "进制须为 2、8、10 或 16\n";
+                return 2;
+            }
+        }
+        else if (text.empty()) {
+            text = arg;
+        }
+        else if (size_t eq = arg.find('='); eq != std::string::npos) {
+            bindings.emplace_back(arg.substr(0, eq), chr::exact_expression::parse_literal(arg.substr(eq + 1)));
+        }
+        else {
+            std::cerr << "无法识别的参数：" << arg << "\n";
+            return 2;
+        }
+    }
+    if (text.empty()) {
+        std::cerr << "缺少表达式\n";
+        return 2;
+    }
+    chr::exact_expression expr(text);
+    std::vector<chr::big_rational> slots;
+    for (const auto& name : expr.variables()) {
+        auto it = std::find_if(bindings.begin(), bindings.end(), [&](const auto& b) { return b.first == name; });
+        if (it == bindings.end()) {
+            std::cerr << "变量 " << name << " 未绑定\n";
+            return 2;
+        }
+        slots.push_back(it->second);
+    }
+    std::cout << expr.evaluate(slots).to_string(radix) << "\n";
+    return 0;
+}
+
+// 解析 "exact 表达式"，按任意精度有理数求值，表达式中的变量依次读入取值（按字面量精确转换）
+void evaluate_exact(const std::string& line)
+{
+    chr::exact_expression expr(line.substr(6));
+    std::vector<chr::big_rational> slots;
+    for (const auto& name : expr.variables()) {
+        std::string value;
+        std::cout << "变量 " << name << " = ";
+        std::getline(std::cin, value);
+        slots.push_back(chr::exact_expression::parse_literal(value));
+    }
+    chr::big_rational result = expr.evaluate(slots);
+    std::cout << "精确结果：" << result.to_string() << "\n";
+    if (!result.is_integer()) {
+        std::cout << "近似值：" << result.to_double() << "\n";
+    }
+}
+
+// 解析 "def 名称(参数, ...) = 函数体" 并加入函数表
+void define_function(chr::function_table& functions, const std::string& line)
+{
+    size_t open = line.find('('), close = line.find(')'), eq = line.find('=');
+    if (open == std::string::npos || close == std::string::npos || eq == std::string::npos || !(open < close && close < eq)) {
+        throw std::runtime_error("定义格式应为：def 名称(参数, ...) = 函数体");
+    }
+    auto trim = [](std::string text) {
+        text.erase(0, text.find_first_not_of(" \t"));
+        text.erase(text.find_last_not_of(" \t") + 1);
+        return text;
+    };
+    std::vector<std::string> parameters;
+    std::string list = trim(line.substr(open + 1, close - open - 1));
+    for (size_t start = 0; !list.empty() && start <= list.size();) {
+        size_t comma = std::min(list.find(',', start), list.size());
+        parameters.push_back(trim(list.substr(start, comma - start)));
+        start = comma + 1;
+    }
+    std::string name = trim(line.substr(4, open - 4));
+    functions.define(name, parameters, line.substr(eq + 1));
+    std::cout << "已定义函数 " << name << "，共 " << parameters.size() << " 个参数\n";
+}
+
+// 解析 "solve 变量 初值 表达式"，表达式中的其他变量依次读入取值后求根
+void solve_equation(const chr::function_table& functions, const std::string& line)
+{
+    std::istringstream in(line.substr(6));
+    std::string variable;
+    double x0;
+    if (!(in >> variable >> x0)) {
+        throw std::runtime_error("求解格式应为：solve 变量 初值 表达式");
+    }
+    std::string text;
+    std::getline(in, text);
+    chr::expression expr(text, &functions);
+    std::vector<double> slots(expr.variables().size());
+    for (size_t i = 0; i < slots.size(); i++) {
+        if (expr.variables()[i] != variable) {
+            std::string value;
+            std::cout << "变量 " << expr.variables()[i] << " = ";
+            std::getline(std::cin, value);
+            slots[i] = std::stod(value);
+        }
+    }
+    std::cout << "求解结果：" << variable << " = " << chr::solve(expr, variable, x0, slots) << "\n";
+}
+
+int main(int argc, char* argv[])
+{
+    const std::string modes[] = { "--bulk", "--daemon", "--client", "--stream", "--save", "--load", "--parallel", "--exact" };
+    if (argc > 1 && std::find(std::begin(modes), std::end(modes), argv[1]) != std::end(modes)) {
+        try {
+            std::string mode = argv[1];
+            return mode == "--bulk" ? run_bulk(argc, argv) : mode == "--daemon" ? run_daemon(argc, argv)
+                : mode == "--client" ? run_client(argc, argv) : mode == "--stream" ? run_stream(argc, argv)
+                : mode == "--save" ? run_save(argc, argv) : mode == "--load" ? run_load(argc, argv)
+                : mode == "--parallel" ? run_parallel(argc, argv) : run_exact(argc, argv);
+        }
+        catch (std::exception& e) {
+            std::cerr << e.what() << std::endl;
+            return 1;
+        }
+    }
+    // REPL 中打开插桩，stats 命令输出上一个表达式的各阶段统计
+    chr::enable_instrumentation(true);
+    std::optional<chr::expression> last;
+    // 自定义函数：def 命令定义的函数在调用处内联；另预置几个多参数的原生函数
+    chr::function_table functions;
+    define_preset_functions(functions);
     std::string str;
     // 简单 REPL：读取行、解析、输出中缀/后缀并计算结果
     while (1) {
@@ -9,24 +417,61 @@ int main()
         {
             std::cout << "输入表达式：";
             std::getline(std::cin, str);
-            // 简易命令：exit 退出，clear 清屏（Windows）
+            // 简易命令：exit 退出，clear 清屏（Windows），def 定义函数，solve 求根，exact 精确求值
             if (str == "exit") {
                 return 0;
             }
             else if (str == "clear") {
                 system("cls");
             }
+            else if (str == "stats") {
+                std::cout << (last ? last->stats().to_string() : "尚未计算任何表达式\n");
+            }
+            else if (str.starts_with("def ")) {
+                define_function(functions, str);
+            }
+            else if (str.starts_with("solve ")) {
+                solve_equation(functions, str);
+            }
+            else if (str.starts_with("exact ")) {
+                evaluate_exact(str);
+            }
             else {
                 // 构造 expression（内部会校验表达式合法性，校验失败抛出异常）
-                chr::expression expr(str);
-                // 输出中缀表示（可读），后缀表示，以及两种计算方式的结果
+                const chr::expression& expr = last.emplace(str, &functions);
+                // 输出中缀表示（可读）与后缀表示，并按后缀计算一次
                 std::cout << "中缀解析：" << expr.infix_expression() << "\n";
                 std::cout << "后缀解析：" << expr.postfix_expression() << "\n";
-                std::cout << "中缀计算：" << expr.evaluate_from_infix() << "\n";
-                std::cout << "后缀计算：" << expr.evaluate_from_postfix() << "\n";
+                if (expr.optimizations().total() != 0) {
+                    std::cout << "后缀优化：\n" << expr.optimizations().to_string();
+                }
+                if (expr.variables().empty()) {
+                    // 只含整数运算时按 64 位整数精确求值，溢出时才按 double 计算
+                    if (auto exact = chr::compiled_expression(expr).evaluate_integer()) {
+                        std::cout << "计算结果：" << *exact << "\n";
+                    }
+                    else {
+                        std::cout << "计算结果：" << expr.evaluate_from_postfix() << "\n";
+                    }
+                }
+                else {
+                    // 含变量时依次读入各变量的值，按槽位顺序绑定后计算
+                    std::vector<double> slots;
+                    for (const auto& name : expr.variables()) {
+                        std::cout << "变量 " << name << " = ";
+                        std::getline(std::cin, str);
+                        slots.push_back(std::stod(str));
+                    }
+                    std::cout << "计算结果：" << expr.evaluate(slots) << "\n";
+                    // 前向自动微分一遍求出对各变量的偏导数
+                    chr::gradient_result gradient = chr::gradient_evaluator(expr, expr.variables()).evaluate(slots);
+                    for (size_t i = 0; i < gradient.gradient.size(); i++) {
+                        std::cout << "偏导数 d/d" << expr.variables()[i] << "：" << gradient.gradient[i] << "\n";
+                    }
+                }
             }
         }
-        catch (std::runtime_error& e)
+        catch (std::exception& e)
         {
             // 捕获并打印解析/计算时抛出的运行时错误（包含 tokenizer 提供的详细信息）
             std::cout << e.what() << std::endl;
@@ -0,0 +1,163 @@
+#include "parallel_evaluator.hpp"
+
+#include <atomic>
+#include <exception>
+
+namespace chr {
+
+	// һɨ׺ջм¼δĽﵽ grain Ϊ
+	// ֻ 0 㣻ֻʵһ飬Ϊʵ call ͬһջϣ
+	parallel_evaluator::parallel_evaluator(const expression& expr, size_t grain) :m_expression(expr) {
+		const std::vector<token>& postfix = expr.postfix();
+		if (postfix.empty()) {
+			throw std::runtime_error("ʱջֻһԪ");
+		}
+		grain = std::max<size_t>(grain, 1);
+		struct subtree {
+			size_t first;
+			size_t size;
+		};
+		std::vector<subtree> stack;
+		for (size_t i = 0; i < postfix.size(); i++) {
+			const token& tk = postfix[i];
+			subtree node{ i, 1 };
+			if (tk.is_operator()) {
+				size_t operand_num = tk.operator_operand_num();
+				if (operand_num == 0 || stack.size() < operand_num) {
+					throw std::runtime_error("ʱȱٲ");
+				}
+				for (size_t k = 0; k < operand_num; k++) {
+					node.first = stack.back().first;
+					node.size += stack.back().size;
+					stack.pop_back();
+				}
+			}
+			bool is_comma = tk.is_operator() && tk.operator_id() == op_t::comma;
+			if ((node.size >= grain && !is_comma) || i + 1 == postfix.size()) {
+				m_tasks.push_back({ node.first, i, 0, 0, npos });
+				node.size = 0;
+			}
+			stack.push_back(node);
+		}
+		if (stack.size() != 1) {
+			throw std::runtime_error("ʱջֻһԪ");
+		}
+		// ±δջ㲻ڵǰģڵǰڣΪֱ
+		std::vector<size_t> open;
+		for (size_t t = 0; t < m_tasks.size(); t++) {
+			size_t count = 0;
+			while (!open.empty() && m_tasks[open.back()].first >= m_tasks[t].first) {
+				m_tasks[open.back()].parent = t;
+				m_children.push_back(open.back());
+				open.pop_back();
+				count++;
+			}
+			std::reverse(m_children.end() - count, m_children.end());
+			m_tasks[t].child_begin = m_children.size() - count;
+			m_tasks[t].child_end = m_children.size();
+			open.push_back(t);
+		}
+	}
+
+	// ׺˳һʱѹ
+	// 㷽ʽ expression::evaluate ͬ
+	double parallel_evaluator::run_task(size_t index, std::span<const double> slots, const std::vector<double>& results) const {
+		const std::vector<token>& postfix = m_expression.postfix();
+		const native_list& natives = m_expression.natives();
+		const task& current = m_tasks[index];
+		fixed_stack<double> operands(current.last - current.first + 1);
+		size_t child = current.child_begin;
+		for (size_t i = current.first; i <= current.last; i++) {
+			if (child != current.child_end && m_tasks[m_children[child]].first == i) {
+				operands.push(results[m_children[child]]);
+				i = m_tasks[m_children[child]].last;
+				child++;
+				continue;
+			}
+			const token& tk = postfix[i];
+			if (tk.is_number()) {
+				operands.push(tk.number_value());
+			}
+			else if (tk.is_variable()) {
+				operands.push(slots[tk.variable_slot()]);
+			}
+			else if (tk.operator_id() == op_t::comma) {
+				// ʵջϣ call һȡ
+			}
+			else if (tk.operator_id() == op_t::call) {
+				const native_function& function = *natives[tk.variable_slot()];
+				double* args = &operands.top() + 1 - function.arity;
+				double result = function.callback({ args, function.arity });
+				for (size_t k = 1; k < function.arity; k++) {
+					operands.pop();
+				}
+				operands.top() = result;
+			}
+			else if (tk.operator_operand_num() == 1) {
+				operands.top() = tk.apply_operator(operands.top(), 0);
+			}
+			else {
+				double b = operands.top();
+				operands.pop();
+				operands.top() = tk.apply_operator(operands.top(), b);
+			}
+		}
+		return operands.top();
+	}
+
+	// ύҶÿɺѸδһ漴ύ
+	// µһ쳣ճɣټ㣩֤ǰûñ״̬
+	double parallel_evaluator::evaluate(thread_pool& pool, std::span<const double> slots) const {
+		if (slots.size() < m_expression.variables().size()) {
+			throw std::runtime_error("ʽδ󶨵ı");
+		}
+		std::vector<double> results(m_tasks.size());
+		if (m_tasks.size() == 1) {
+			return run_task(0, slots, results);
+		}
+		std::unique_ptr<std::atomic<size_t>[]> remaining(new std::atomic<size_t>[m_tasks.size()]);
+		for (size_t t = 0; t < m_tasks.size(); t++) {
+			remaining[t].store(m_tasks[t].child_end - m_tasks[t].child_begin, std::memory_order_relaxed);
+		}
+		std::atomic<bool> done(false);
+		std::atomic<bool> failed(false);
+		std::mutex error_mutex;
+		std::exception_ptr error;
+		std::function<void(size_t)> run = [&](size_t t) {
+			if (!failed.load(std::memory_order_relaxed)) {
+				try {
+					results[t] = run_task(t, slots, results);
+				}
+				catch (...) {
+					std::lock_guard<std::mutex> lock(error_mutex);
+					if (!error) {
+						error = std::current_exception();
+					}
+					failed.store(true, std::memory_order_relaxed);
+				}
+			}
+			size_t parent = m_tasks[t].parent;
+			if (parent == npos) {
+				done.store(true, std::memory_order_release);
+			}
+			else if (remaining[parent].fetch_sub(1, std::memory_order_acq_rel) == 1) {
+				pool.submit([&run, parent] { run(parent); });
+			}
+		};
+		for (size_t t = 0; t < m_tasks.size(); t++) {
+			if (m_tasks[t].child_begin == m_tasks[t].child_end) {
+				pool.submit([&run, t] { run(t); });
+			}
+		}
+		pool.wait_until([&] { return done.load(std::memory_order_acquire); });
+		if (error) {
+			std::rethrow_exception(error);
+		}
+		return results.back();
+	}
+
+	double parallel_evaluator::evaluate(thread_pool& pool, variable_binding bindings) const {
+		std::vector<double> slots = bind_variables(m_expression.variables(), bindings);
+		return evaluate(pool, slots);
+	}
+}
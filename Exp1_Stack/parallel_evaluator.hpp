@@ -0,0 +1,36 @@
+#ifndef PARALLEL_EVALUATOR_HPP
+#define PARALLEL_EVALUATOR_HPP
+
+#include "calculator.hpp"
+#include "thread_pool.hpp"
+
+namespace chr {
+
+	// ʽ fork-join ֵ׺ؽʽѹģС grain г
+	// ȫɺύ񣬸ȡĽ㡣
+	// ÿ԰׺ֵ˳ִУ evaluate λͬ
+	// ԭڶ߳ͬʱã
+	class parallel_evaluator {
+		struct task {
+			size_t first;        // ں׺еֹ±꣨ˣ
+			size_t last;
+			size_t child_begin;  // ֱ m_children е䣬 first 
+			size_t child_end;
+			size_t parent;       // ±꣬Ϊ npos
+		};
+		static constexpr size_t npos = SIZE_MAX;
+		const expression& m_expression;
+		std::vector<task> m_tasks;      // ±Уڸ֮ǰһǸ
+		std::vector<size_t> m_children;
+	private:
+		double run_task(size_t index, std::span<const double> slots, const std::vector<double>& results) const;
+	public:
+		// ֻһΣexpr ֵþãgrain ΪٰĽ
+		explicit parallel_evaluator(const expression& expr, size_t grain = size_t(1) << 14);
+		double evaluate(thread_pool& pool, std::span<const double> slots = {}) const;
+		double evaluate(thread_pool& pool, variable_binding bindings) const;
+		size_t task_count() const { return m_tasks.size(); }
+	};
+}
+
+#endif // !PARALLEL_EVALUATOR_HPP
@@ -0,0 +1,252 @@
+#include "program_image.hpp"
+
+#include <cstddef>
+#include <cstring>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace chr {
+	namespace {
+		struct image_header {
+			char magic[4];
+			std::uint16_t version;
+			std::uint16_t header_size;
+			std::uint32_t image_size;
+			std::uint32_t code_count;
+			std::uint32_t constant_count;
+			std::uint32_t variable_count;
+			std::uint32_t max_depth;
+			std::uint32_t temp_count;
+			std::uint32_t constant_offset;
+			std::uint32_t code_offset;
+			std::uint32_t name_offset;
+			std::uint32_t reserved;
+		};
+		static_assert(sizeof(image_header) == 48);
+		// ֱָӰ instruction ȡֱļʽһ
+		static_assert(sizeof(instruction) == 8 && offsetof(instruction, operand) == 4);
+		constexpr char image_magic[4] = { 'C', 'H', 'R', 'X' };
+
+		constexpr std::uint64_t align8(std::uint64_t n) {
+			return (n + 7) / 8 * 8;
+		}
+
+		void require_little_endian() {
+			if constexpr (std::endian::native != std::endian::little) {
+				throw std::runtime_error("ƾ֧Сƽ̨");
+			}
+		}
+
+		template <typename T>
+		void write_raw(std::ostream& out, const T& value) {
+			out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+	}
+
+	// ʽдͷءָ֮估ĩβ
+	void compiled_expression::save(std::ostream& out) const {
+		require_little_endian();
+		if (!m_natives.empty()) {
+			throw std::runtime_error("ԭĳ޷дƾ");
+		}
+		image_header header{};
+		std::memcpy(header.magic, image_magic, sizeof(image_magic));
+		header.version = program_image_version;
+		header.header_size = sizeof(image_header);
+		std::uint64_t names_size = 8ull * m_variables.size();
+		for (const auto& name : m_variables) {
+			names_size += name.size();
+		}
+		std::uint64_t constant_offset = sizeof(image_header);
+		std::uint64_t code_offset = constant_offset + 8ull * m_constants.size();
+		std::uint64_t name_offset = code_offset + 8ull * m_code.size();
+		std::uint64_t image_size = align8(name_offset + names_size);
+		if (image_size > UINT32_MAX) {
+			throw std::runtime_error("޷дƾ");
+		}
+		header.image_size = static_cast<std::uint32_t>(image_size);
+		header.code_count = static_cast<std::uint32_t>(m_code.size());
+		header.constant_count = static_cast<std::uint32_t>(m_constants.size());
+		header.variable_count = static_cast<std::uint32_t>(m_variables.size());
+		header.max_depth = static_cast<std::uint32_t>(m_max_depth);
+		header.temp_count = static_cast<std::uint32_t>(m_temp_count);
+		header.constant_offset = static_cast<std::uint32_t>(constant_offset);
+		header.code_offset = static_cast<std::uint32_t>(code_offset);
+		header.name_offset = static_cast<std::uint32_t>(name_offset);
+		write_raw(out, header);
+		out.write(reinterpret_cast<const char*>(m_constants.data()), static_cast<std::streamsize>(8 * m_constants.size()));
+		// дֽ֤Ϊ㣨ڴеֵֽȷ
+		for (const auto& ins : m_code) {
+			unsigned char bytes[8] = { static_cast<unsigned char>(ins.code) };
+			std::memcpy(bytes + 4, &ins.operand, 4);
+			out.write(reinterpret_cast<const char*>(bytes), 8);
+		}
+		std::uint32_t offset = static_cast<std::uint32_t>(name_offset + 8 * m_variables.size());
+		for (const auto& name : m_variables) {
+			std::uint32_t entry[2] = { offset, static_cast<std::uint32_t>(name.size()) };
+			write_raw(out, entry);
+			offset += entry[1];
+		}
+		for (const auto& name : m_variables) {
+			out.write(name.data(), static_cast<std::streamsize>(name.size()));
+		}
+		const char padding[8] = {};
+		out.write(padding, static_cast<std::streamsize>(image_size - name_offset - names_size));
+		if (!out) {
+			throw std::runtime_error("дƾʧ");
+		}
+	}
+
+	// ȼͷα߽硢룬ģִһֵָ֮κμ
+	program_image program_image::parse(std::span<const unsigned char> bytes) {
+		require_little_endian();
+		image_header header;
+		if (bytes.size() < sizeof(image_header)) {
+			throw std::runtime_error("ƾ");
+		}
+		if (reinterpret_cast<std::uintptr_t>(bytes.data()) % alignof(double) != 0) {
+			throw std::runtime_error("ƾδ 8 ֽڶ");
+		}
+		std::memcpy(&header, bytes.data(), sizeof(image_header));
+		if (std::memcmp(header.magic, image_magic, sizeof(image_magic)) != 0) {
+			throw std::runtime_error("Ƕƾ");
+		}
+		if (header.version != program_image_version || header.header_size != sizeof(image_header) || header.reserved != 0) {
+			throw std::runtime_error("ֵ֧Ķƾ汾 " + std::to_string(header.version));
+		}
+		if (header.image_size > bytes.size() || header.image_size % 8 != 0) {
+			throw std::runtime_error("ƾ");
+		}
+		auto check_section = [&](std::uint32_t offset, std::uint64_t size) {
+			if (offset % 8 != 0 || offset < sizeof(image_header) || offset + size > header.image_size) {
+				throw std::runtime_error("ƾĶԽ");
+			}
+		};
+		check_section(header.constant_offset, 8ull * header.constant_count);
+		check_section(header.code_offset, 8ull * header.code_count);
+		check_section(header.name_offset, 8ull * header.variable_count);
+		program_image image;
+		image.m_base = bytes.data();
+		image.m_size = header.image_size;
+		image.m_names = reinterpret_cast<const std::uint32_t*>(bytes.data() + header.name_offset);
+		for (size_t i = 0; i < header.variable_count; i++) {
+			if (static_cast<std::uint64_t>(image.m_names[2 * i]) + image.m_names[2 * i + 1] > header.image_size) {
+				throw std::runtime_error("ƾıԽ");
+			}
+		}
+		image.m_view = {
+			{ reinterpret_cast<const instruction*>(bytes.data() + header.code_offset), header.code_count },
+			{ reinterpret_cast<const double*>(bytes.data() + header.constant_offset), header.constant_count },
+			{}, header.variable_count, header.max_depth, header.temp_count
+		};
+		image.m_view.verify();
+		return image;
+	}
+
+	std::string_view program_image::variable(size_t slot) const {
+		if (slot >= m_view.variable_count) {
+			throw std::runtime_error("λԽ");
+		}
+		return { reinterpret_cast<const char*>(m_base + m_names[2 * slot]), m_names[2 * slot + 1] };
+	}
+
+	size_t program_image::slot(std::string_view name) const {
+		for (size_t i = 0; i < m_view.variable_count; i++) {
+			if (variable(i) == name) {
+				return i;
+			}
+		}
+		throw std::runtime_error("ʽвڱ " + std::string(name));
+	}
+
+	double program_image::evaluate(variable_binding bindings, precision mode) const {
+		std::vector<double> slots(m_view.variable_count);
+		std::vector<bool> bound(slots.size());
+		for (const auto& [name, value] : bindings) {
+			size_t index = slot(name);
+			slots[index] = value;
+			bound[index] = true;
+		}
+		for (size_t i = 0; i < slots.size(); i++) {
+			if (!bound[i]) {
+				throw std::runtime_error(" " + std::string(variable(i)) + " δ");
+			}
+		}
+		return m_view.evaluate(slots, mode);
+	}
+
+	// ֻӳļļӳ䣬Ϊ񣻽ʧʱȽӳ׳
+	mapped_program_file::mapped_program_file(const std::string& path) :m_data(nullptr), m_size(0) {
+#ifdef _WIN32
+		m_mapping = nullptr;
+		HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+		if (file == INVALID_HANDLE_VALUE) {
+			throw std::runtime_error("޷򿪾ļ" + path);
+		}
+		LARGE_INTEGER size;
+		GetFileSizeEx(file, &size);
+		m_size = static_cast<size_t>(size.QuadPart);
+		if (m_size != 0) {
+			m_mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+			m_data = m_mapping ? static_cast<const unsigned char*>(MapViewOfFile(m_mapping, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+		}
+		CloseHandle(file);
+		if (m_size != 0 && !m_data) {
+			if (m_mapping) {
+				CloseHandle(m_mapping);
+			}
+			throw std::runtime_error("޷ӳ侵ļ" + path);
+		}
+#else
+		int fd = ::open(path.c_str(), O_RDONLY);
+		if (fd < 0) {
+			throw std::runtime_error("޷򿪾ļ" + path);
+		}
+		struct stat st;
+		if (::fstat(fd, &st) == 0) {
+			m_size = static_cast<size_t>(st.st_size);
+		}
+		void* data = m_size != 0 ? ::mmap(nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0) : nullptr;
+		::close(fd);
+		if (data == MAP_FAILED) {
+			throw std::runtime_error("޷ӳ侵ļ" + path);
+		}
+		m_data = static_cast<const unsigned char*>(data);
+#endif
+		try {
+			for (size_t offset = 0; offset < m_size;) {
+				m_images.push_back(program_image::parse({ m_data + offset, m_size - offset }));
+				offset += m_images.back().size();
+			}
+		}
+		catch (...) {
+			unmap();
+			throw;
+		}
+	}
+
+	mapped_program_file::~mapped_program_file() {
+		unmap();
+	}
+
+	void mapped_program_file::unmap() {
+		if (!m_data) {
+			return;
+		}
+#ifdef _WIN32
+		UnmapViewOfFile(m_data);
+		CloseHandle(m_mapping);
+#else
+		::munmap(const_cast<unsigned char*>(m_data), m_size);
+#endif
+		m_data = nullptr;
+	}
+}
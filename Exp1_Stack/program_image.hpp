@@ -0,0 +1,58 @@
+#ifndef PROGRAM_IMAGE_HPP
+#define PROGRAM_IMAGE_HPP
+
+#include "compiler.hpp"
+
+namespace chr {
+
+	// ĶƾС򣩡ֻԾƫƣûָ룬ƻֱӳ䣺
+	//   ͷ 48 ֽڣmagic "CHRX" | uint16 汾 | uint16 ͷ | uint32 ܳ
+	//                 | uint32 ָ | uint32  | uint32  | uint32 ջ | uint32 ʱλ
+	//                 | uint32 ƫ | uint32 ָƫ | uint32 ƫ | uint32 Ϊ 0
+	//   أ double
+	//   ָÿ 8 ֽڣopcode1 ֽڣ+ 3 ֽ + uint32  instruction ڴ沼ͬ
+	//    { uint32 ƫ, uint32  }Ǹֽ
+	// ÿζ 8 ֽڱ߽翪ʼܳҲ뵽 8 ֽڣ˶βдͬһļ
+	constexpr std::uint16_t program_image_version = 1;
+
+	// һֻͼݣõڴ棨ͨ mapped_program_fileͼþ
+	class program_image {
+		const unsigned char* m_base;
+		std::uint32_t m_size;
+		program_view m_view;
+		const std::uint32_t* m_names; // 
+	private:
+		program_image() :m_base(nullptr), m_size(0), m_view{}, m_names(nullptr) {}
+	public:
+		//  bytes ͷһ飨汾߽硢롢ָϷԣϷʱ׳쳣
+		static program_image parse(std::span<const unsigned char> bytes);
+		std::uint32_t size() const { return m_size; } // ֽĩβ룩
+		const program_view& view() const { return m_view; }
+		size_t variable_count() const { return m_view.variable_count; }
+		std::string_view variable(size_t slot) const;
+		size_t slot(std::string_view name) const; // ӦĲλʱ׳쳣
+		double evaluate() const { return m_view.evaluate({}); }
+		double evaluate(std::span<const double> slots, precision mode = precision::exact) const { return m_view.evaluate(slots, mode); }
+		double evaluate(variable_binding bindings, precision mode = precision::exact) const;
+	};
+
+	// ļӳ䵽ڴ沢νеľֱֵӶȡӳҳ棬ʱκν
+	class mapped_program_file {
+		const unsigned char* m_data;
+		size_t m_size;
+#ifdef _WIN32
+		void* m_mapping;
+#endif
+		std::vector<program_image> m_images;
+	private:
+		void unmap();
+	public:
+		explicit mapped_program_file(const std::string& path);
+		~mapped_program_file();
+		mapped_program_file(const mapped_program_file&) = delete;
+		mapped_program_file& operator=(const mapped_program_file&) = delete;
+		const std::vector<program_image>& images() const { return m_images; }
+	};
+}
+
+#endif // !PROGRAM_IMAGE_HPP
@@ -0,0 +1,367 @@
+#ifndef SIMD_HPP
+#define SIMD_HPP
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+namespace chr {
+
+	// ˫ͣĿѡ AVX-5128 ·AVX24 ·1 ·ʵ
+	// MSVC ֻ /arch:AVX2/arch:AVX512 ¶꣬Ŀ Release ʹ /arch:AVX2
+	// ֵĸںֻṩͳһӿڣvfloat ΪͬһĴͨӱĵֻͣṩ
+#if defined(__AVX512F__)
+	struct vmask {
+		__mmask8 m;
+		friend vmask operator&(vmask a, vmask b) { return { static_cast<__mmask8>(a.m & b.m) }; }
+		friend vmask operator|(vmask a, vmask b) { return { static_cast<__mmask8>(a.m | b.m) }; }
+		friend vmask operator^(vmask a, vmask b) { return { static_cast<__mmask8>(a.m ^ b.m) }; }
+		friend vmask operator!(vmask a) { return { static_cast<__mmask8>(~a.m) }; }
+		bool any() const { return m != 0; }
+	};
+	struct vdouble {
+		__m512d v;
+		static constexpr size_t width = 8;
+		static vdouble load(const double* p) { return { _mm512_loadu_pd(p) }; }
+		static vdouble broadcast(double x) { return { _mm512_set1_pd(x) }; }
+		void store(double* p) const { _mm512_storeu_pd(p, v); }
+		friend vdouble operator+(vdouble a, vdouble b) { return { _mm512_add_pd(a.v, b.v) }; }
+		friend vdouble operator-(vdouble a, vdouble b) { return { _mm512_sub_pd(a.v, b.v) }; }
+		friend vdouble operator*(vdouble a, vdouble b) { return { _mm512_mul_pd(a.v, b.v) }; }
+		friend vdouble operator/(vdouble a, vdouble b) { return { _mm512_div_pd(a.v, b.v) }; }
+		friend vdouble operator-(vdouble a) {
+			return { _mm512_castsi512_pd(_mm512_xor_si512(_mm512_castpd_si512(a.v), _mm512_set1_epi64(INT64_MIN))) };
+		}
+		friend vmask operator<(vdouble a, vdouble b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LT_OQ) }; }
+		friend vmask operator<=(vdouble a, vdouble b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_LE_OQ) }; }
+		friend vmask operator==(vdouble a, vdouble b) { return { _mm512_cmp_pd_mask(a.v, b.v, _CMP_EQ_OQ) }; }
+		// a * b + c룩
+		friend vdouble fma(vdouble a, vdouble b, vdouble c) { return { _mm512_fmadd_pd(a.v, b.v, c.v) }; }
+		friend vdouble sqrt(vdouble a) { return { _mm512_sqrt_pd(a.v) }; }
+		friend vdouble abs(vdouble a) { return { _mm512_abs_pd(a.v) }; }
+		friend vdouble floor(vdouble a) { return { _mm512_roundscale_pd(a.v, _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC) }; }
+		friend vdouble select(vmask m, vdouble a, vdouble b) { return { _mm512_mask_blend_pd(m.m, b.v, a.v) }; }
+		// frexpa = mantissa * 2^exponentmantissa  [0.5, 1)Ĺ
+		friend vdouble frexp_mantissa(vdouble a) { return { _mm512_getmant_pd(a.v, _MM_MANT_NORM_p5_1, _MM_MANT_SIGN_src) }; }
+		friend vdouble frexp_exponent(vdouble a) { return { _mm512_add_pd(_mm512_getexp_pd(a.v), _mm512_set1_pd(1)) }; }
+		// a * 2^nn Ϊֵ
+		friend vdouble scale2(vdouble a, vdouble n) { return { _mm512_scalef_pd(a.v, n.v) }; }
+	};
+	struct vfloat {
+		__m512 v;
+		static constexpr size_t width = 16;
+		static vfloat load(const float* p) { return { _mm512_loadu_ps(p) }; }
+		static vfloat broadcast(float x) { return { _mm512_set1_ps(x) }; }
+		void store(float* p) const { _mm512_storeu_ps(p, v); }
+		friend vfloat operator+(vfloat a, vfloat b) { return { _mm512_add_ps(a.v, b.v) }; }
+		friend vfloat operator-(vfloat a, vfloat b) { return { _mm512_sub_ps(a.v, b.v) }; }
+		friend vfloat operator*(vfloat a, vfloat b) { return { _mm512_mul_ps(a.v, b.v) }; }
+		friend vfloat operator/(vfloat a, vfloat b) { return { _mm512_div_ps(a.v, b.v) }; }
+		friend vfloat operator-(vfloat a) {
+			return { _mm512_castsi512_ps(_mm512_xor_si512(_mm512_castps_si512(a.v), _mm512_set1_epi32(INT32_MIN))) };
+		}
+		friend vfloat fma(vfloat a, vfloat b, vfloat c) { return { _mm512_fmadd_ps(a.v, b.v, c.v) }; }
+		friend vfloat sqrt(vfloat a) { return { _mm512_sqrt_ps(a.v) }; }
+		// һΪ NaN ʱ b
+		friend vfloat min(vfloat a, vfloat b) { return { _mm512_min_ps(a.v, b.v) }; }
+		friend vfloat max(vfloat a, vfloat b) { return { _mm512_max_ps(a.v, b.v) }; }
+	};
+#elif defined(__AVX2__)
+	struct vmask {
+		__m256d m;
+		friend vmask operator&(vmask a, vmask b) { return { _mm256_and_pd(a.m, b.m) }; }
+		friend vmask operator|(vmask a, vmask b) { return { _mm256_or_pd(a.m, b.m) }; }
+		friend vmask operator^(vmask a, vmask b) { return { _mm256_xor_pd(a.m, b.m) }; }
+		friend vmask operator!(vmask a) { return { _mm256_xor_pd(a.m, _mm256_castsi256_pd(_mm256_set1_epi64x(-1))) }; }
+		bool any() const { return _mm256_movemask_pd(m) != 0; }
+	};
+	struct vdouble {
+		__m256d v;
+		static constexpr size_t width = 4;
+		static vdouble load(const double* p) { return { _mm256_loadu_pd(p) }; }
+		static vdouble broadcast(double x) { return { _mm256_set1_pd(x) }; }
+		void store(double* p) const { _mm256_storeu_pd(p, v); }
+		friend vdouble operator+(vdouble a, vdouble b) { return { _mm256_add_pd(a.v, b.v) }; }
+		friend vdouble operator-(vdouble a, vdouble b) { return { _mm256_sub_pd(a.v, b.v) }; }
+		friend vdouble operator*(vdouble a, vdouble b) { return { _mm256_mul_pd(a.v, b.v) }; }
+		friend vdouble operator/(vdouble a, vdouble b) { return { _mm256_div_pd(a.v, b.v) }; }
+		friend vdouble operator-(vdouble a) { return { _mm256_xor_pd(a.v, _mm256_set1_pd(-0.0)) }; }
+		friend vmask operator<(vdouble a, vdouble b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LT_OQ) }; }
+		friend vmask operator<=(vdouble a, vdouble b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_LE_OQ) }; }
+		friend vmask operator==(vdouble a, vdouble b) { return { _mm256_cmp_pd(a.v, b.v, _CMP_EQ_OQ) }; }
+		friend vdouble fma(vdouble a, vdouble b, vdouble c) { return { _mm256_fmadd_pd(a.v, b.v, c.v) }; }
+		friend vdouble sqrt(vdouble a) { return { _mm256_sqrt_pd(a.v) }; }
+		friend vdouble abs(vdouble a) { return { _mm256_andnot_pd(_mm256_set1_pd(-0.0), a.v) }; }
+		friend vdouble floor(vdouble a) { return { _mm256_floor_pd(a.v) }; }
+		friend vdouble select(vmask m, vdouble a, vdouble b) { return { _mm256_blendv_pd(b.v, a.v, m.m) }; }
+		friend vdouble frexp_mantissa(vdouble a) {
+			__m256i bits = _mm256_castpd_si256(a.v);
+			bits = _mm256_and_si256(bits, _mm256_set1_epi64x(0x800FFFFFFFFFFFFFll));
+			bits = _mm256_or_si256(bits, _mm256_set1_epi64x(0x3FE0000000000000ll));
+			return { _mm256_castsi256_pd(bits) };
+		}
+		friend vdouble frexp_exponent(vdouble a) {
+			// ȡƴ 2^52 βټȥ 2^52 õ両ֵ
+			__m256i bits = _mm256_srli_epi64(_mm256_castpd_si256(a.v), 52);
+			bits = _mm256_and_si256(bits, _mm256_set1_epi64x(0x7FF));
+			bits = _mm256_or_si256(bits, _mm256_set1_epi64x(0x4330000000000000ll));
+			return { _mm256_sub_pd(_mm256_castsi256_pd(bits), _mm256_set1_pd(4503599627370496.0 + 1022)) };
+		}
+		friend vdouble scale2(vdouble a, vdouble n) {
+			// ţʹ n  [-2044, 2046] ʱмĽ붼Ϸ
+			const __m256d magic = _mm256_set1_pd(6755399441055744.0); // 1.5 * 2^52
+			__m256d half = _mm256_floor_pd(_mm256_mul_pd(n.v, _mm256_set1_pd(0.5)));
+			__m256d rest = _mm256_sub_pd(n.v, half);
+			auto pow2 = [&](__m256d k) {
+				__m256i bits = _mm256_sub_epi64(_mm256_castpd_si256(_mm256_add_pd(k, magic)), _mm256_castpd_si256(magic));
+				return _mm256_castsi256_pd(_mm256_slli_epi64(_mm256_add_epi64(bits, _mm256_set1_epi64x(1023)), 52));
+			};
+			return { _mm256_mul_pd(_mm256_mul_pd(a.v, pow2(half)), pow2(rest)) };
+		}
+	};
+	struct vfloat {
+		__m256 v;
+		static constexpr size_t width = 8;
+		static vfloat load(const float* p) { return { _mm256_loadu_ps(p) }; }
+		static vfloat broadcast(float x) { return { _mm256_set1_ps(x) }; }
+		void store(float* p) const { _mm256_storeu_ps(p, v); }
+		friend vfloat operator+(vfloat a, vfloat b) { return { _mm256_add_ps(a.v, b.v) }; }
+		friend vfloat operator-(vfloat a, vfloat b) { return { _mm256_sub_ps(a.v, b.v) }; }
+		friend vfloat operator*(vfloat a, vfloat b) { return { _mm256_mul_ps(a.v, b.v) }; }
+		friend vfloat operator/(vfloat a, vfloat b) { return { _mm256_div_ps(a.v, b.v) }; }
+		friend vfloat operator-(vfloat a) { return { _mm256_xor_ps(a.v, _mm256_set1_ps(-0.0f)) }; }
+		friend vfloat fma(vfloat a, vfloat b, vfloat c) { return { _mm256_fmadd_ps(a.v, b.v, c.v) }; }
+		friend vfloat sqrt(vfloat a) { return { _mm256_sqrt_ps(a.v) }; }
+		// һΪ NaN ʱ b
+		friend vfloat min(vfloat a, vfloat b) { return { _mm256_min_ps(a.v, b.v) }; }
+		friend vfloat max(vfloat a, vfloat b) { return { _mm256_max_ps(a.v, b.v) }; }
+	};
+#else
+	struct vmask {
+		bool m;
+		friend vmask operator&(vmask a, vmask b) { return { a.m && b.m }; }
+		friend vmask operator|(vmask a, vmask b) { return { a.m || b.m }; }
+		friend vmask operator^(vmask a, vmask b) { return { a.m != b.m }; }
+		friend vmask operator!(vmask a) { return { !a.m }; }
+		bool any() const { return m; }
+	};
+	struct vdouble {
+		double v;
+		static constexpr size_t width = 1;
+		static vdouble load(const double* p) { return { *p }; }
+		static vdouble broadcast(double x) { return { x }; }
+		void store(double* p) const { *p = v; }
+		friend vdouble operator+(vdouble a, vdouble b) { return { a.v + b.v }; }
+		friend vdouble operator-(vdouble a, vdouble b) { return { a.v - b.v }; }
+		friend vdouble operator*(vdouble a, vdouble b) { return { a.v * b.v }; }
+		friend vdouble operator/(vdouble a, vdouble b) { return { a.v / b.v }; }
+		friend vdouble operator-(vdouble a) { return { -a.v }; }
+		friend vmask operator<(vdouble a, vdouble b) { return { a.v < b.v }; }
+		friend vmask operator<=(vdouble a, vdouble b) { return { a.v <= b.v }; }
+		friend vmask operator==(vdouble a, vdouble b) { return { a.v == b.v }; }
+		friend vdouble fma(vdouble a, vdouble b, vdouble c) { return { std::fma(a.v, b.v, c.v) }; }
+		friend vdouble sqrt(vdouble a) { return { std::sqrt(a.v) }; }
+		friend vdouble abs(vdouble a) { return { std::fabs(a.v) }; }
+		friend vdouble floor(vdouble a) { return { std::floor(a.v) }; }
+		friend vdouble select(vmask m, vdouble a, vdouble b) { return m.m ? a : b; }
+		friend vdouble frexp_mantissa(vdouble a) { int e; return { std::frexp(a.v, &e) }; }
+		friend vdouble frexp_exponent(vdouble a) { int e; std::frexp(a.v, &e); return { static_cast<double>(e) }; }
+		friend vdouble scale2(vdouble a, vdouble n) { return { std::ldexp(a.v, static_cast<int>(n.v)) }; }
+	};
+	struct vfloat {
+		float v;
+		static constexpr size_t width = 1;
+		static vfloat load(const float* p) { return { *p }; }
+		static vfloat broadcast(float x) { return { x }; }
+		void store(float* p) const { *p = v; }
+		friend vfloat operator+(vfloat a, vfloat b) { return { a.v + b.v }; }
+		friend vfloat operator-(vfloat a, vfloat b) { return { a.v - b.v }; }
+		friend vfloat operator*(vfloat a, vfloat b) { return { a.v * b.v }; }
+		friend vfloat operator/(vfloat a, vfloat b) { return { a.v / b.v }; }
+		friend vfloat operator-(vfloat a) { return { -a.v }; }
+		// ȳ˻˫ǾȷģֻһΣ FMA  2^-53
+		friend vfloat fma(vfloat a, vfloat b, vfloat c) {
+			return { static_cast<float>(static_cast<double>(a.v) * b.v + c.v) };
+		}
+		friend vfloat sqrt(vfloat a) { return { std::sqrt(a.v) }; }
+		// һΪ NaN ʱ b
+		friend vfloat min(vfloat a, vfloat b) { return { a.v < b.v ? a.v : b.v }; }
+		friend vfloat max(vfloat a, vfloat b) { return { a.v > b.v ? a.v : b.v }; }
+	};
+#endif
+
+	inline vdouble operator+(vdouble a, double b) { return a + vdouble::broadcast(b); }
+	inline vdouble operator-(vdouble a, double b) { return a - vdouble::broadcast(b); }
+	inline vdouble operator*(vdouble a, double b) { return a * vdouble::broadcast(b); }
+	inline vdouble operator*(double a, vdouble b) { return vdouble::broadcast(a) * b; }
+	inline vdouble operator/(vdouble a, double b) { return a / vdouble::broadcast(b); }
+	inline vdouble operator/(double a, vdouble b) { return vdouble::broadcast(a) / b; }
+
+	//  mask Ϊͨñ㣨ڳֵͨ
+	template <typename F>
+	vdouble fix_lanes(vdouble result, vmask bad, vdouble a, vdouble b, F func) {
+		if (!bad.any()) {
+			return result;
+		}
+		alignas(64) double r[vdouble::width], x[vdouble::width], y[vdouble::width], flag[vdouble::width];
+		result.store(r);
+		a.store(x);
+		b.store(y);
+		select(bad, vdouble::broadcast(1), vdouble::broadcast(0)).store(flag);
+		for (size_t i = 0; i < vdouble::width; i++) {
+			if (flag[i] != 0) {
+				r[i] = func(x[i], y[i]);
+			}
+		}
+		return vdouble::load(r);
+	}
+
+	// ʽֵHorner + FMAϵӸߴεʹ
+	template <size_t N>
+	vdouble polynomial(vdouble x, const double(&coef)[N]) {
+		vdouble r = vdouble::broadcast(coef[0]);
+		for (size_t i = 1; i < N; i++) {
+			r = fma(r, x, vdouble::broadcast(coef[i]));
+		}
+		return r;
+	}
+
+	// ΪȺ㷨ϵȡ Cephes ѧ⣨˫ȣsin/cos/ln/exp  2 ULP
+	// tan  3 ULPpow  |bln a|  pow_vector_limit ʱ 3 ULPֵͨ˵׼
+	namespace vmath {
+		constexpr double sin_coef[] = {
+			1.58962301576546568060E-10, -2.50507477628578072866E-8, 2.75573136213857245213E-6,
+			-1.98412698295895385996E-4, 8.33333333332211858878E-3, -1.66666666666666307295E-1,
+		};
+		constexpr double cos_coef[] = {
+			-1.13585365213876817300E-11, 2.08757008419747316778E-9, -2.75573141792967388112E-7,
+			2.48015872888517045348E-5, -1.38888888888730564116E-3, 4.16666666666665929218E-2,
+		};
+		constexpr double log_p[] = {
+			1.01875663804580931796E-4, 4.97494994976747001425E-1, 4.70579119878881725854E0,
+			1.44989225341610930846E1, 1.79368678507819816313E1, 7.70838733755885391666E0,
+		};
+		constexpr double log_q[] = {
+			1.0, 1.12873587189167450590E1, 4.52279145837532221105E1,
+			8.29875266912776603211E1, 7.11544750618563894466E1, 2.31251620126765340583E1,
+		};
+		constexpr double exp_p[] = {
+			1.26177193074810590878E-4, 3.02994407707441961300E-2, 9.99999999999999999910E-1,
+		};
+		constexpr double exp_q[] = {
+			3.00198505138664455042E-6, 2.52448340349684104192E-3, 2.27265548208155028766E-1, 2.00000000000000000009E0,
+		};
+		constexpr double sin_limit = 1.073741824e9; // ֵʱ Cody-Waite Լ򾫶Ȳ
+		constexpr double exp_limit = 708.0;
+
+		// ͬʱ sin  cosԼ򣩣x  |x| <= sin_limit
+		inline void sincos(vdouble x, vdouble& s, vdouble& c) {
+			vdouble ax = abs(x);
+			vdouble y = floor(ax * 1.27323954473516268615); // 4/
+			vdouble odd = y - floor(y * 0.5) * 2;
+			y = y + odd;
+			vdouble j = y - floor(y * 0.125) * 8; //  j  {0, 2, 4, 6}
+			vdouble z = fma(y, vdouble::broadcast(-7.85398125648498535156E-1), ax);
+			z = fma(y, vdouble::broadcast(-3.77489470793079817668E-8), z);
+			z = fma(y, vdouble::broadcast(-2.69515142907905952645E-15), z);
+			vdouble zz = z * z;
+			vdouble ps = fma(z * zz, polynomial(zz, sin_coef), z);
+			vdouble pc = fma(zz * zz, polynomial(zz, cos_coef), fma(zz, vdouble::broadcast(-0.5), vdouble::broadcast(1)));
+			vmask swap = (j == vdouble::broadcast(2)) | (j == vdouble::broadcast(6));
+			vmask upper = vdouble::broadcast(4) <= j;
+			vdouble sv = select(swap, pc, ps);
+			vdouble cv = select(swap, ps, pc);
+			// sin ķţx Ϊ j >= 4 תһΣcos ķţj  {2, 4} ʱΪ
+			vmask sin_negative = (x < vdouble::broadcast(0)) ^ upper;
+			vmask cos_negative = (j == vdouble::broadcast(2)) | (j == vdouble::broadcast(4));
+			s = select(sin_negative, -sv, sv);
+			c = select(cos_negative, -cv, cv);
+		}
+		inline vmask sincos_bad(vdouble x) {
+			return !(abs(x) <= vdouble::broadcast(sin_limit));
+		}
+		inline vdouble sin(vdouble x) {
+			vdouble s, c;
+			sincos(x, s, c);
+			s = select(x == vdouble::broadcast(0), x, s); //  -0 ķ
+			return fix_lanes(s, sincos_bad(x), x, x, [](double a, double) { return std::sin(a); });
+		}
+		inline vdouble cos(vdouble x) {
+			vdouble s, c;
+			sincos(x, s, c);
+			return fix_lanes(c, sincos_bad(x), x, x, [](double a, double) { return std::cos(a); });
+		}
+		inline vdouble tan(vdouble x) {
+			vdouble s, c;
+			sincos(x, s, c);
+			vdouble t = select(x == vdouble::broadcast(0), x, s / c);
+			return fix_lanes(t, sincos_bad(x), x, x, [](double a, double) { return std::tan(a); });
+		}
+
+		// Ȼ˫-˫Ƚ hi + lo pow ʹãx ΪĹ
+		inline void log_split(vdouble x, vdouble& hi, vdouble& lo) {
+			vdouble e = frexp_exponent(x);
+			vdouble m = frexp_mantissa(x);
+			vmask small = m < vdouble::broadcast(0.70710678118654752440);
+			e = select(small, e - 1, e);
+			vdouble t = select(small, m + m - 1, m - 1);
+			vdouble z = t * t;
+			vdouble y = t * (z * polynomial(t, log_p) / polynomial(t, log_q));
+			y = fma(e, vdouble::broadcast(-2.121944400546905827679e-4), y);
+			y = fma(z, vdouble::broadcast(-0.5), y);
+			// e * ln2_hi  t ȷ two-sum ϲټС
+			vdouble a = e * 0.693359375;
+			vdouble s = a + t;
+			vdouble bb = s - a;
+			vdouble err = (a - (s - bb)) + (t - bb);
+			hi = s + (err + y);
+			lo = (err + y) - (hi - s);
+		}
+		inline vmask log_bad(vdouble x) {
+			return (!(vdouble::broadcast(2.2250738585072014e-308) <= x)) | (!(x < vdouble::broadcast(INFINITY)));
+		}
+		inline vdouble log(vdouble x) {
+			vdouble hi, lo;
+			log_split(x, hi, lo);
+			return fix_lanes(hi + lo, log_bad(x), x, x, [](double a, double) { return std::log(a); });
+		}
+
+		// e^x|x| <= exp_limit
+		inline vdouble exp_core(vdouble x) {
+			vdouble n = floor(fma(x, vdouble::broadcast(1.4426950408889634073599), vdouble::broadcast(0.5)));
+			vdouble r = fma(n, vdouble::broadcast(-6.93145751953125E-1), x);
+			r = fma(n, vdouble::broadcast(-1.42860682030941723212E-6), r);
+			vdouble rr = r * r;
+			vdouble p = r * polynomial(rr, exp_p);
+			r = p / (polynomial(rr, exp_q) - p);
+			r = fma(r, vdouble::broadcast(2), vdouble::broadcast(1));
+			return scale2(r, n);
+		}
+		inline vdouble exp(vdouble x) {
+			return fix_lanes(exp_core(x), !(abs(x) <= vdouble::broadcast(exp_limit)), x, x,
+				[](double a, double) { return std::exp(a); });
+		}
+
+		// pow  |bln a| Լ 700 ʱɴ ULPܴʱپ % ŴԵľ
+		// ֵͨ std::pow
+		constexpr double pow_vector_limit = 16.0;
+		// a^b = exp(b * ln a)ln a ˫-˫Ȳ˷ԿŴ
+		// a ޻ |bln a|  pow_vector_limit ͨ˵ std::pow
+		inline vdouble pow(vdouble a, vdouble b) {
+			vdouble hi, lo;
+			log_split(a, hi, lo);
+			vdouble p = b * hi;
+			vdouble perr = fma(b, lo, fma(b, hi, -p));
+			vdouble r = exp_core(p);
+			r = fma(r, perr, r);
+			vmask bad = log_bad(a) | !(abs(p) <= vdouble::broadcast(pow_vector_limit)) | !(abs(b) < vdouble::broadcast(INFINITY));
+			return fix_lanes(r, bad, a, b, [](double x, double y) { return std::pow(x, y); });
+		}
+	}
+}
+
+#endif // !SIMD_HPP
@@ -0,0 +1,573 @@
+#ifndef STATIC_EXPRESSION_HPP
+#define STATIC_EXPRESSION_HPP
+
+#include "calculator.hpp"
+
+#include <bit>
+#include <concepts>
+#include <limits>
+
+namespace chr {
+
+	// ַΪģرʽı
+	template <size_t N>
+	struct fixed_string {
+		char text[N]{};
+		constexpr fixed_string(const char(&str)[N]) {
+			std::copy_n(str, N, text);
+		}
+		constexpr std::string_view view() const { return { text, N - 1 }; }
+	};
+
+	namespace static_detail {
+		// ڽʱã constexpr ֵＴʧܣϢд message
+		inline void error(const char* message) {
+			throw std::runtime_error(message);
+		}
+
+		// ַ𣬹 calculator.cpp еַһ
+		constexpr bool is_decimal(char c) { return c >= '0' && c <= '9'; }
+		constexpr bool is_digit_of(char c, int radix) {
+			int d = is_decimal(c) ? c - '0' : c >= 'A' && c <= 'F' ? c - 'A' + 10 : c >= 'a' && c <= 'f' ? c - 'a' + 10 : 99;
+			return d < radix;
+		}
+		constexpr int digit_value(char c) {
+			return c <= '9' ? c - '0' : c <= 'Z' ? c - 'A' + 10 : c - 'a' + 10;
+		}
+		constexpr bool is_word_head(char c) { return (c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || c == '_'; }
+		constexpr bool is_word(char c) { return is_word_head(c) || is_decimal(c); }
+		constexpr bool is_space(char c) { return c == ' ' || (c >= '\t' && c <= '\r'); }
+		constexpr bool is_operator_char(char c) { return std::string_view("+-*/^()!%,").find(c) != std::string_view::npos; }
+
+		// С 32 λֶΣֻṩʮת
+		class big_integer {
+			static constexpr size_t limbs = 128;
+			std::uint32_t m_limb[limbs]{};
+			size_t m_size = 0; // Ч߶η㣩
+		public:
+			constexpr bool is_zero() const { return m_size == 0; }
+			constexpr size_t bits() const {
+				return m_size == 0 ? 0 : 32 * (m_size - 1) + std::bit_width(m_limb[m_size - 1]);
+			}
+			constexpr bool bit(size_t i) const {
+				return i / 32 < m_size && (m_limb[i / 32] >> (i % 32) & 1);
+			}
+			// this = this * factor + addend
+			constexpr void multiply_add(std::uint32_t factor, std::uint32_t addend) {
+				std::uint64_t carry = addend;
+				for (size_t i = 0; i < m_size; i++) {
+					carry += static_cast<std::uint64_t>(m_limb[i]) * factor;
+					m_limb[i] = static_cast<std::uint32_t>(carry);
+					carry >>= 32;
+				}
+				if (carry != 0) {
+					if (m_size == limbs) {
+						error("ʮڽķΧ");
+					}
+					m_limb[m_size++] = static_cast<std::uint32_t>(carry);
+				}
+			}
+			constexpr void shift_left(size_t n) {
+				if (m_size == 0) {
+					return;
+				}
+				size_t whole = n / 32;
+				if (m_size + whole > limbs) {
+					error("ʮڽķΧ");
+				}
+				for (size_t i = m_size; i > 0; i--) {
+					m_limb[i - 1 + whole] = m_limb[i - 1];
+				}
+				for (size_t i = 0; i < whole; i++) {
+					m_limb[i] = 0;
+				}
+				m_size += whole;
+				if (n % 32 != 0) {
+					multiply_add(std::uint32_t(1) << (n % 32), 0);
+				}
+			}
+			constexpr int compare(const big_integer& other) const {
+				if (m_size != other.m_size) {
+					return m_size < other.m_size ? -1 : 1;
+				}
+				for (size_t i = m_size; i > 0; i--) {
+					if (m_limb[i - 1] != other.m_limb[i - 1]) {
+						return m_limb[i - 1] < other.m_limb[i - 1] ? -1 : 1;
+					}
+				}
+				return 0;
+			}
+			// this -= otherҪ this >= other
+			constexpr void subtract(const big_integer& other) {
+				std::int64_t borrow = 0;
+				for (size_t i = 0; i < m_size; i++) {
+					std::int64_t d = static_cast<std::int64_t>(m_limb[i]) - (i < other.m_size ? other.m_limb[i] : 0) - borrow;
+					borrow = d < 0;
+					m_limb[i] = static_cast<std::uint32_t>(d + (borrow << 32));
+				}
+				while (m_size > 0 && m_limb[m_size - 1] == 0) {
+					m_size--;
+				}
+			}
+		};
+
+		//  (q + ) * 2^exponent ͽ루ƽȡżתΪ doublesticky ʾ q ֮зĵλ
+		constexpr double assemble(std::uint64_t q, int exponent, bool sticky) {
+			if (q == 0) {
+				return 0;
+			}
+			int width = std::bit_width(q);
+			// λڹ񻯷Χʱ 53 λ򰴴λ 2^-1074 
+			int shift = exponent + width - 1 >= -1022 ? width - 53 : -1074 - exponent;
+			std::uint64_t m = 0;
+			if (shift <= 0) {
+				m = q << -shift;
+			}
+			else if (shift <= 64) {
+				std::uint64_t dropped = shift == 64 ? q : q & ((std::uint64_t(1) << shift) - 1);
+				std::uint64_t half = std::uint64_t(1) << (shift - 1);
+				m = shift == 64 ? 0 : q >> shift;
+				if (dropped > half || (dropped == half && (sticky || (m & 1)))) {
+					m++;
+				}
+			}
+			int e = exponent + shift;
+			if (m == std::uint64_t(1) << 53) {
+				m >>= 1;
+				e++;
+			}
+			if (m < std::uint64_t(1) << 52) {
+				return std::bit_cast<double>(m); // 㣩ʱ e == -1074
+			}
+			int biased = e + 52 + 1023;
+			if (biased >= 2047) {
+				return std::numeric_limits<double>::infinity();
+			}
+			return std::bit_cast<double>(static_cast<std::uint64_t>(biased) << 52 | (m - (std::uint64_t(1) << 52)));
+		}
+
+		// ʮת doubleȷ루ʱ from_chars ͬ
+		// Чֶɴ MֵΪ M * 10^ee >= 0 ʱȡ M * 10^e ĸ 64 λ
+		// e < 0 ʱ M Ƶǡ 63~64 λ㼴Ϊ sticky
+		constexpr double parse_decimal(std::string_view str) {
+			big_integer mantissa;
+			int exponent10 = 0;
+			int digits = 0;
+			bool fraction = false;
+			size_t i = 0;
+			for (; i < str.size() && str[i] != 'e' && str[i] != 'E'; i++) {
+				if (str[i] == '.') {
+					fraction = true;
+					continue;
+				}
+				if (!mantissa.is_zero() || str[i] != '0') {
+					mantissa.multiply_add(10, str[i] - '0');
+					digits++;
+				}
+				exponent10 -= fraction;
+			}
+			if (i < str.size()) {
+				bool negative = str[++i] == '-';
+				i += str[i] == '+' || str[i] == '-';
+				int value = 0;
+				for (; i < str.size(); i++) {
+					value = std::min(value * 10 + (str[i] - '0'), 100000);
+				}
+				exponent10 += negative ? -value : value;
+			}
+			if (mantissa.is_zero()) {
+				return 0;
+			}
+			// λЧֵʮָ double Χʱ 0from_chars Խ磩
+			// ֱӾܾ
+			int leading = exponent10 + digits - 1;
+			if (leading > 308) {
+				error("ʮ double ķΧ");
+			}
+			if (leading < -325) {
+				return 0;
+			}
+			if (exponent10 >= 0) {
+				for (int k = 0; k < exponent10; k++) {
+					mantissa.multiply_add(10, 0);
+				}
+				size_t width = mantissa.bits();
+				size_t shift = width > 64 ? width - 64 : 0;
+				std::uint64_t q = 0;
+				bool sticky = false;
+				for (size_t b = 0; b < width; b++) {
+					if (b < shift) {
+						sticky = sticky || mantissa.bit(b);
+					}
+					else if (mantissa.bit(b)) {
+						q |= std::uint64_t(1) << (b - shift);
+					}
+				}
+				double value = assemble(q, static_cast<int>(shift), sticky);
+				if (value == std::numeric_limits<double>::infinity()) {
+					error("ʮ double ķΧ");
+				}
+				return value;
+			}
+			big_integer divisor;
+			divisor.multiply_add(0, 1);
+			for (int k = 0; k < -exponent10; k++) {
+				divisor.multiply_add(10, 0);
+			}
+			int shift = 63 + static_cast<int>(divisor.bits()) - static_cast<int>(mantissa.bits());
+			if (shift >= 0) {
+				mantissa.shift_left(shift);
+			}
+			else {
+				divisor.shift_left(-shift);
+			}
+			// λ̲ 2^64
+			big_integer remainder;
+			std::uint64_t q = 0;
+			for (size_t b = mantissa.bits(); b > 0; b--) {
+				remainder.shift_left(1);
+				if (mantissa.bit(b - 1)) {
+					remainder.multiply_add(1, 1);
+				}
+				q <<= 1;
+				if (remainder.compare(divisor) >= 0) {
+					remainder.subtract(divisor);
+					q |= 1;
+				}
+			}
+			return assemble(q, -shift, !remainder.is_zero());
+		}
+
+		// //ʮǰ׺ token::parse_number ְͬλƴӵ 64 λ
+		//  64 λ double λۼӣСִӸλλλۼӣλȨض 2 ݣ
+		constexpr double parse_radix(std::string_view str, int radix) {
+			const size_t dot = std::min(str.find('.'), str.size());
+			const int bits = radix == 2 ? 1 : radix == 8 ? 3 : 4;
+			std::uint64_t mantissa = 0;
+			double value = 0;
+			bool wide = false;
+			for (size_t i = 0; i < dot; i++) {
+				if (!wide && mantissa >> (64 - bits) == 0) {
+					mantissa = mantissa << bits | digit_value(str[i]);
+					continue;
+				}
+				if (!wide) {
+					value = static_cast<double>(mantissa);
+					wide = true;
+				}
+				value = value * radix + digit_value(str[i]);
+			}
+			if (!wide) {
+				value = static_cast<double>(mantissa);
+			}
+			double weight = 1;
+			for (size_t i = dot + 1; i < str.size(); i++) {
+				weight /= radix;
+				value += weight * digit_value(str[i]);
+			}
+			return value;
+		}
+
+		// ʽĽ㣺ӽڸ֮ǰ
+		struct node {
+			enum kind_t : byte { number, variable, unary, binary } kind;
+			op_t op;
+			std::uint32_t left;
+			std::uint32_t right;
+			std::uint32_t slot;
+			double value;
+		};
+
+		// ڽĽı
+		template <size_t N>
+		struct program {
+			node nodes[N]{};
+			std::uint32_t node_count = 0;
+			std::uint32_t root = 0;
+			std::string_view variables[N]{};
+			std::uint32_t variable_count = 0;
+		};
+
+		//  Pratt ʷȼ expression Ľһ
+		// ͬϣpos/neg  ^  !壩֧Զ庯붺ţ
+		// ͬʱ۵ + - * / ȡ IEEE ʱͬʱ
+		template <size_t N>
+		class parser {
+			enum class kind : byte { end, decimal, radix, word, symbol };
+			std::string_view m_source;
+			size_t m_pos = 0;
+			kind m_kind = kind::end;
+			std::string_view m_text;
+			int m_radix = 10;
+			program<N> m_program;
+		public:
+			constexpr explicit parser(std::string_view source) :m_source(source) {}
+			constexpr program<N> parse() {
+				advance();
+				m_program.root = parse_expression(0);
+				if (m_kind != kind::end) {
+					error("ʽǷڶ token");
+				}
+				return m_program;
+			}
+		private:
+			constexpr size_t match_radix(size_t pos) {
+				for (int radix : { 2, 8, 16 }) {
+					char prefix = radix == 2 ? 'b' : radix == 8 ? 'o' : 'x';
+					if (pos + 2 < m_source.size() && m_source[pos] == '0' && m_source[pos + 1] == prefix && is_digit_of(m_source[pos + 2], radix)) {
+						size_t end = pos + 3;
+						while (end < m_source.size() && is_digit_of(m_source[end], radix)) {
+							end++;
+						}
+						if (end < m_source.size() && m_source[end] == '.') {
+							end++;
+							while (end < m_source.size() && is_digit_of(m_source[end], radix)) {
+								end++;
+							}
+						}
+						m_radix = radix;
+						return end - pos;
+					}
+				}
+				return 0;
+			}
+			constexpr size_t match_decimal(size_t pos) const {
+				size_t end = pos;
+				auto skip_digits = [&]() {
+					while (end < m_source.size() && is_decimal(m_source[end])) {
+						end++;
+					}
+				};
+				if (is_decimal(m_source[end])) {
+					skip_digits();
+					if (end < m_source.size() && m_source[end] == '.') {
+						end++;
+						skip_digits();
+					}
+				}
+				else if (m_source[end] == '.' && end + 1 < m_source.size() && is_decimal(m_source[end + 1])) {
+					end++;
+					skip_digits();
+				}
+				else {
+					return 0;
+				}
+				if (end < m_source.size() && (m_source[end] == 'e' || m_source[end] == 'E')) {
+					size_t exp = end + 1;
+					if (exp < m_source.size() && (m_source[exp] == '+' || m_source[exp] == '-')) {
+						exp++;
+					}
+					if (exp < m_source.size() && is_decimal(m_source[exp])) {
+						end = exp;
+						skip_digits();
+					}
+				}
+				return end - pos;
+			}
+			constexpr void advance() {
+				while (m_pos < m_source.size() && is_space(m_source[m_pos])) {
+					m_pos++;
+				}
+				if (m_pos >= m_source.size()) {
+					m_kind = kind::end;
+					m_text = {};
+					return;
+				}
+				size_t len = 0;
+				if ((len = match_radix(m_pos)) != 0) {
+					m_kind = kind::radix;
+				}
+				else if ((len = match_decimal(m_pos)) != 0) {
+					m_kind = kind::decimal;
+				}
+				else if (is_operator_char(m_source[m_pos])) {
+					m_kind = kind::symbol;
+					len = 1;
+				}
+				else if (is_word_head(m_source[m_pos])) {
+					m_kind = kind::word;
+					for (len = 1; m_pos + len < m_source.size() && is_word(m_source[m_pos + len]); len++) {
+					}
+				}
+				else {
+					error("ʽǷ޷ʶַ");
+				}
+				m_text = m_source.substr(m_pos, len);
+				m_pos += len;
+			}
+			constexpr std::uint32_t add(node n) {
+				m_program.nodes[m_program.node_count] = n;
+				return m_program.node_count++;
+			}
+			constexpr std::uint32_t number(double value) {
+				return add({ node::number, op_t::add, 0, 0, 0, value });
+			}
+			constexpr std::uint32_t unary(op_t op, std::uint32_t operand) {
+				const node& a = m_program.nodes[operand];
+				if (op == op_t::posite) {
+					return operand;
+				}
+				if (op == op_t::negate && a.kind == node::number) {
+					return number(-a.value);
+				}
+				return add({ node::unary, op, operand, 0, 0, 0 });
+			}
+			constexpr std::uint32_t binary(op_t op, std::uint32_t left, std::uint32_t right) {
+				const node& a = m_program.nodes[left];
+				const node& b = m_program.nodes[right];
+				if (a.kind == node::number && b.kind == node::number) {
+					switch (op) {
+					case op_t::add: return number(a.value + b.value);
+					case op_t::minus: return number(a.value - b.value);
+					case op_t::multiply: return number(a.value * b.value);
+					case op_t::divide: return number(a.value / b.value);
+					default: break;
+					}
+				}
+				return add({ node::binary, op, left, right, 0, 0 });
+			}
+			constexpr std::uint32_t variable(std::string_view name) {
+				std::uint32_t slot = 0;
+				while (slot < m_program.variable_count && m_program.variables[slot] != name) {
+					slot++;
+				}
+				if (slot == m_program.variable_count) {
+					m_program.variables[m_program.variable_count++] = name;
+				}
+				return add({ node::variable, op_t::add, 0, 0, slot, 0 });
+			}
+			// ıͬfunctions Ϊʱֻںв
+			static constexpr std::optional<op_t> find_operator(std::string_view text, bool functions) {
+				size_t first = functions ? static_cast<size_t>(op_t::sine) : 0;
+				size_t last = functions ? static_cast<size_t>(op_t::radian) : static_cast<size_t>(op_t::factorial);
+				for (size_t i = first; i <= last; i++) {
+					if (operator_table[i].symbol == text) {
+						return static_cast<op_t>(i);
+					}
+				}
+				return std::nullopt;
+			}
+			constexpr std::uint32_t parse_group() {
+				if (m_text != "(") {
+					error("ʽǷδ");
+				}
+				advance();
+				std::uint32_t inner = parse_expression(0);
+				if (m_text != ")") {
+					error("ʽǷڶ");
+				}
+				advance();
+				return inner;
+			}
+			constexpr std::uint32_t parse_prefix() {
+				std::string_view str = m_text;
+				switch (m_kind) {
+				case kind::end:
+					error("ʽǷʽβ");
+					return 0;
+				case kind::decimal:
+					advance();
+					return number(parse_decimal(str));
+				case kind::radix:
+					advance();
+					return number(parse_radix(str.substr(2), m_radix));
+				case kind::word:
+					advance();
+					if (auto function = find_operator(str, true)) {
+						return unary(*function, parse_group());
+					}
+					if (str == "PI" || str == "E" || str == "PHI") {
+						return number(str == "PI" ? CONSTANT_PI : str == "E" ? CONSTANT_E : CONSTANT_PHI);
+					}
+					return variable(str);
+				case kind::symbol:
+					if (str == "(") {
+						return parse_group();
+					}
+					if (str == "+" || str == "-") {
+						op_t sign = str == "+" ? op_t::posite : op_t::negate;
+						advance();
+						if (m_text == "+" || m_text == "-") {
+							error("ʽǷʽ");
+						}
+						return unary(sign, parse_expression(operator_info(sign).priority));
+					}
+					break;
+				}
+				error("ʽǷȱٲ");
+				return 0;
+			}
+			constexpr std::uint32_t parse_expression(byte min_priority) {
+				std::uint32_t left = parse_prefix();
+				while (m_kind == kind::symbol && m_text != "(" && m_text != ")") {
+					auto op = find_operator(m_text, false);
+					if (!op) {
+						error("ʽǷ̬ʽֶ֧");
+					}
+					const operator_data& info = operator_info(*op);
+					if (info.priority <= min_priority) {
+						break;
+					}
+					advance();
+					if (info.operand_num == 2) {
+						left = binary(*op, left, parse_expression(info.priority));
+					}
+					else {
+						//  expression_tokenizer::validate һ£׳ǰ֡ţ(3!)! ǺϷд
+						if (m_kind == kind::symbol && m_text == "!") {
+							error("ʽǷ׳ǰ֡ʽ");
+						}
+						left = unary(*op, left);
+					}
+				}
+				return left;
+			}
+		};
+
+		template <size_t N>
+		consteval program<N> parse(const fixed_string<N>& text) {
+			return parser<N>(text.view()).parse();
+		}
+	}
+
+	// ڱʽıڱɴʷ볣۵Ƿʽֱӱʧܣ
+	// ֵʽչΪͨãд C++ 뿪ͬ
+	// ״γֵ˳Ϊ operator() Ĳ
+	//   constexpr chr::static_expr<"2*sin(x)+y^2"> f;
+	//   double r = f(0.5, 3); // x = 0.5, y = 3
+	template <fixed_string Text>
+	class static_expr {
+		static constexpr auto m_program = static_detail::parse(Text);
+	private:
+		template <std::uint32_t Index>
+		static double evaluate_node(const double* slots) {
+			constexpr static_detail::node n = m_program.nodes[Index];
+			if constexpr (n.kind == static_detail::node::number) {
+				return n.value;
+			}
+			else if constexpr (n.kind == static_detail::node::variable) {
+				return slots[n.slot];
+			}
+			else if constexpr (n.kind == static_detail::node::unary) {
+				return apply_operator<n.op>(evaluate_node<n.left>(slots));
+			}
+			else {
+				double a = evaluate_node<n.left>(slots);
+				double b = evaluate_node<n.right>(slots);
+				return apply_operator<n.op>(a, b);
+			}
+		}
+	public:
+		static constexpr size_t variable_count = m_program.variable_count;
+		static constexpr std::string_view text() { return Text.view(); }
+		static constexpr std::string_view variable(size_t slot) { return m_program.variables[slot]; }
+		template <typename... Args>
+			requires (sizeof...(Args) == variable_count && (std::convertible_to<Args, double> && ...))
+		double operator()(Args... args) const {
+			const double slots[variable_count + 1] = { static_cast<double>(args)... };
+			return evaluate_node<m_program.root>(slots);
+		}
+	};
+}
+
+#endif // !STATIC_EXPRESSION_HPP
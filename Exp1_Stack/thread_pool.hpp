@@ -0,0 +1,140 @@
+#ifndef THREAD_POOL_HPP
+#define THREAD_POOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace chr {
+
+	// ȡ̳߳أÿ߳ԼУ߳ύԼеβ
+	// ⲿ߳ύָУ߳ȴԼеβȡȳڻУ
+	// ԼĶпٴеͷȡʱִʣ˳
+	class thread_pool {
+		struct task_queue {
+			std::mutex mutex;
+			std::deque<std::function<void()>> tasks;
+		};
+		std::vector<std::unique_ptr<task_queue>> m_queues; //  m_workers һһӦ
+		std::vector<std::thread> m_workers;
+		std::atomic<size_t> m_pending; // δȡ
+		std::atomic<size_t> m_next;    // ⲿύʱѡĶ
+		std::mutex m_mutex;            // ֻڿй̵߳뻽
+		std::condition_variable m_available;
+		bool m_stopping;
+		static constexpr size_t no_worker = SIZE_MAX;
+	private:
+		// ǰ߳ڱеḺ́߳ţǱصĹ߳ʱΪ no_worker
+		size_t current_worker() const {
+			return current().pool == this ? current().index : no_worker;
+		}
+		struct worker_identity {
+			const thread_pool* pool = nullptr;
+			size_t index = 0;
+		};
+		static worker_identity& current() {
+			static thread_local worker_identity identity;
+			return identity;
+		}
+		// ȡִһself Ϊ̱߳ʱȡԼеβٰ˳ȡеͷ
+		bool run_one(size_t self) {
+			std::function<void()> task;
+			if (self != no_worker) {
+				task_queue& own = *m_queues[self];
+				std::lock_guard<std::mutex> lock(own.mutex);
+				if (!own.tasks.empty()) {
+					task = std::move(own.tasks.back());
+					own.tasks.pop_back();
+				}
+			}
+			size_t first = self == no_worker ? 0 : self + 1;
+			for (size_t i = 0; !task && i < m_queues.size(); i++) {
+				task_queue& victim = *m_queues[(first + i) % m_queues.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.tasks.empty()) {
+					task = std::move(victim.tasks.front());
+					victim.tasks.pop_front();
+				}
+			}
+			if (!task) {
+				return false;
+			}
+			m_pending--;
+			task();
+			return true;
+		}
+		void work(size_t index) {
+			current() = { this, index };
+			while (true) {
+				if (run_one(index)) {
+					continue;
+				}
+				std::unique_lock<std::mutex> lock(m_mutex);
+				m_available.wait(lock, [this] { return m_stopping || m_pending > 0; });
+				if (m_stopping && m_pending == 0) {
+					return;
+				}
+			}
+		}
+	public:
+		// thread_count Ϊ 0 ʱȡӲ
+		explicit thread_pool(size_t thread_count = 0) :m_pending(0), m_next(0), m_stopping(false) {
+			if (thread_count == 0) {
+				thread_count = std::max(1u, std::thread::hardware_concurrency());
+			}
+			for (size_t i = 0; i < thread_count; i++) {
+				m_queues.push_back(std::make_unique<task_queue>());
+			}
+			m_workers.reserve(thread_count);
+			for (size_t i = 0; i < thread_count; i++) {
+				m_workers.emplace_back([this, i] { work(i); });
+			}
+		}
+		thread_pool(const thread_pool&) = delete;
+		thread_pool& operator=(const thread_pool&) = delete;
+		~thread_pool() {
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_stopping = true;
+			}
+			m_available.notify_all();
+			for (auto& worker : m_workers) {
+				worker.join();
+			}
+		}
+		void submit(std::function<void()> task) {
+			size_t self = current_worker();
+			task_queue& queue = *m_queues[self != no_worker ? self : m_next++ % m_queues.size()];
+			// ȼӣΪѱȡ߶
+			m_pending++;
+			{
+				std::lock_guard<std::mutex> lock(queue.mutex);
+				queue.tasks.push_back(std::move(task));
+			}
+			// ߵ߳ m_mutex ڼ֮ȡһ֪ͨͲ
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+			}
+			m_available.notify_one();
+		}
+		// ȴ done() ȴڼ䵱ǰ߳Ҳִге
+		// ˹߳ڲ fork-join Ϊй̶߳ڵȴ
+		template <typename Predicate>
+		void wait_until(Predicate done) {
+			size_t self = current_worker();
+			while (!done()) {
+				if (!run_one(self)) {
+					std::this_thread::yield();
+				}
+			}
+		}
+		size_t size() const { return m_workers.size(); }
+	};
+}
+
+#endif // !THREAD_POOL_HPP